@@ -0,0 +1,236 @@
+#ifndef MICROWAVE_CAPTURE_H
+#define MICROWAVE_CAPTURE_H
+
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveMessageDecoder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace MicrowaveMsgFormat {
+
+// Session capture file.
+//
+//   header: [magic "Mcap":4][version:4 big endian]
+//   record: [kind:1][size:1][time:8 big endian][payload:size]
+//
+// time is in microseconds since the capture started. Messages are stored
+// as 12-byte v1 wire frames whatever framing the link used, so a capture
+// replays the same on any host. Unknown record kinds are skipped, which
+// lets later versions add records without breaking older readers.
+//
+// Every CaptureSnapshotIntervalUs the writer adds a SNAPSHOT of the
+// protocol core, so a reader can start replay at the snapshot nearest to a
+// point of interest instead of at the first record.
+
+static const uint32_t CaptureMagic {0x4D636170}; // "Mcap"
+static const uint32_t CaptureVersion {1};
+static const size_t CaptureHeaderSize {8};
+static const size_t CaptureRecordHeaderSize {10};
+static const size_t CaptureMaxRecordSize {CaptureRecordHeaderSize + 0xFF};
+static const uint64_t CaptureSnapshotIntervalUs {10000000};
+
+enum class CaptureKind : uint8_t {
+    RX = 0x01,      // DEV->APP message
+    TX = 0x02,      // APP->DEV message
+    RX_RAW = 0x03,  // DEV->APP bytes as read from a stream link, before
+                    // framing; a read larger than 255 bytes spans records
+    SNAPSHOT = 0x04,    // ProtocolCore state after all earlier records
+                        // (ProtocolCore::saveSnapshot)
+    LINK_RESET = 0x05   // the link went down, no payload; what was
+                        // negotiated went with it (ProtocolCore::linkReset)
+};
+
+struct CaptureRecord
+{
+    CaptureKind kind;
+    uint8_t size;
+    uint64_t timeUs;
+    const char* payload;    // points into the capture buffer
+};
+
+inline void PutBigEndian(char* out, const uint64_t value, const size_t size)
+{
+    for(size_t i {0}; i < size; ++i) {
+        out[i] = static_cast<char>((value >> (8 * (size - 1 - i))) & 0xFF);
+    }
+}
+
+inline uint64_t GetBigEndian(const char* in, const size_t size)
+{
+    uint64_t value {0};
+    for(size_t i {0}; i < size; ++i) {
+        value = (value << 8) | static_cast<uint8_t>(in[i]);
+    }
+    return value;
+}
+
+// out must hold CaptureHeaderSize bytes
+inline size_t EncodeCaptureHeader(char* out)
+{
+    PutBigEndian(out, CaptureMagic, 4);
+    PutBigEndian(out + 4, CaptureVersion, 4);
+    return CaptureHeaderSize;
+}
+
+// out must hold CaptureRecordHeaderSize + size bytes
+inline size_t EncodeCaptureRecord(const CaptureKind kind, const uint64_t timeUs,
+                                  const char* payload, const uint8_t size, char* out)
+{
+    out[0] = static_cast<char>(kind);
+    out[1] = static_cast<char>(size);
+    PutBigEndian(out + 2, timeUs, 8);
+    memcpy(out + CaptureRecordHeaderSize, payload, size);
+    return CaptureRecordHeaderSize + size;
+}
+
+// msg in host byte order, out must hold CaptureRecordHeaderSize + WireMessageSize bytes
+inline size_t EncodeCaptureMessage(const CaptureKind kind, const uint64_t timeUs,
+                                   const Message& msg, char* out)
+{
+    const Message wire {ByteSwapMessage(msg)};
+    return EncodeCaptureRecord(kind, timeUs, reinterpret_cast<const char*>(&wire),
+                               static_cast<uint8_t>(WireMessageSize), out);
+}
+
+// Bounds-checked decode of the message held by an RX or TX record.
+inline bool DecodeCaptureMessage(const CaptureRecord& record, Message& msg)
+{
+    static const char appMagic[WireMagicSize] {'M', 'a', 'p', 'p'};
+    static const char devMagic[WireMagicSize] {'M', 'd', 'e', 'v'};
+    switch(record.kind) {
+    case CaptureKind::RX:
+        return DecodeWireMessage(record.payload, record.size, appMagic, msg);
+    case CaptureKind::TX:
+        return DecodeWireMessage(record.payload, record.size, devMagic, msg);
+    case CaptureKind::RX_RAW:
+    case CaptureKind::SNAPSHOT:
+    case CaptureKind::LINK_RESET:
+        break;
+    }
+    return false;
+}
+
+// Walks the records of a capture held in memory, never reading past size.
+class CaptureReader
+{
+public:
+    CaptureReader(const char* data, const size_t size)
+        : data{data}
+        , size{size}
+        , pos{CaptureHeaderSize}
+        , ok{size >= CaptureHeaderSize &&
+             CaptureMagic == GetBigEndian(data, 4) &&
+             CaptureVersion == GetBigEndian(data + 4, 4)}
+    {
+    }
+
+    // false for a missing or foreign header
+    bool isValid() const
+    {
+        return ok;
+    }
+
+    // false at the end of the capture or at a truncated record
+    bool next(CaptureRecord& record)
+    {
+        if(!ok || size - pos < CaptureRecordHeaderSize) {
+            return false;
+        }
+        const char* p {data + pos};
+        const uint8_t payloadSize {static_cast<uint8_t>(p[1])};
+        if(size - pos - CaptureRecordHeaderSize < payloadSize) {
+            return false;
+        }
+        record.kind = static_cast<CaptureKind>(p[0]);
+        record.size = payloadSize;
+        record.timeUs = GetBigEndian(p + 2, 8);
+        record.payload = p + CaptureRecordHeaderSize;
+        pos += CaptureRecordHeaderSize + payloadSize;
+        return true;
+    }
+
+    // offset of the next record, usable with seek()
+    size_t tell() const
+    {
+        return pos;
+    }
+
+    void seek(const size_t offset)
+    {
+        pos = offset < CaptureHeaderSize ? CaptureHeaderSize : offset;
+        if(pos > size) {
+            pos = size;
+        }
+    }
+
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+    bool ok;
+};
+
+// Offsets of the SNAPSHOT records of a capture. Built with one pass over
+// the record headers, after which finding the snapshot to start a replay
+// from is a binary search however long the capture is.
+class CaptureIndex
+{
+public:
+    explicit CaptureIndex(CaptureReader& reader)
+    {
+        const size_t start {reader.tell()};
+        reader.seek(0);
+        CaptureRecord record;
+        size_t offset {reader.tell()};
+        while(reader.next(record)) {
+            if(CaptureKind::SNAPSHOT == record.kind) {
+                snapshots.push_back(Entry{record.timeUs, offset});
+            }
+            offset = reader.tell();
+        }
+        reader.seek(start);
+    }
+
+    // Offset of the last snapshot taken at or before timeUs, or of the first
+    // record when there is none
+    size_t find(const uint64_t timeUs) const
+    {
+        const auto after {std::upper_bound(snapshots.begin(), snapshots.end(), timeUs,
+                                           [](const uint64_t time, const Entry& entry) {
+                                               return time < entry.timeUs;
+                                           })};
+        return snapshots.begin() == after ? CaptureHeaderSize : (after - 1)->offset;
+    }
+
+    // Offset of the snapshot before the one at offset, or of the first
+    // record when there is none
+    size_t previous(const size_t offset) const
+    {
+        const auto at {std::lower_bound(snapshots.begin(), snapshots.end(), offset,
+                                        [](const Entry& entry, const size_t value) {
+                                            return entry.offset < value;
+                                        })};
+        return snapshots.begin() == at ? CaptureHeaderSize : (at - 1)->offset;
+    }
+
+    size_t size() const
+    {
+        return snapshots.size();
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t timeUs;
+        size_t offset;
+    };
+    std::vector<Entry> snapshots;
+};
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_CAPTURE_H
@@ -0,0 +1,129 @@
+#ifndef MICROWAVE_DISPLAY_H
+#define MICROWAVE_DISPLAY_H
+
+#include "MicrowaveMessageFormat.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace MicrowaveMsgFormat {
+
+// The five display positions, left to right
+enum class Glyph : uint8_t {
+    LEFT_TENS = 0,
+    LEFT_ONES,
+    COLON,
+    RIGHT_TENS,
+    RIGHT_ONES,
+    COUNT
+};
+
+static const size_t GlyphCount {static_cast<size_t>(Glyph::COUNT)};
+static const char BlankGlyph {' '};
+
+// What the display shows, one character per position with BlankGlyph for an
+// empty one. The app pushes a frame to its labels, headless replay compares
+// frames directly.
+struct DisplayFrame
+{
+    char glyphs[GlyphCount];
+
+    char& operator[](const Glyph glyph)
+    {
+        return glyphs[static_cast<size_t>(glyph)];
+    }
+    char operator[](const Glyph glyph) const
+    {
+        return glyphs[static_cast<size_t>(glyph)];
+    }
+
+    bool operator==(const DisplayFrame& rhs) const
+    {
+        return 0 == memcmp(glyphs, rhs.glyphs, GlyphCount);
+    }
+    bool operator!=(const DisplayFrame& rhs) const
+    {
+        return 0 != memcmp(glyphs, rhs.glyphs, GlyphCount);
+    }
+};
+
+inline char DigitGlyph(const uint32_t digit)
+{
+    return static_cast<char>('0' + digit % 10);
+}
+
+inline void RenderBlank(DisplayFrame& frame)
+{
+    memset(frame.glyphs, BlankGlyph, GlyphCount);
+}
+
+// Startup contents of the display before anything has been received
+inline void RenderInitial(DisplayFrame& frame)
+{
+    frame[Glyph::LEFT_TENS] = '0';
+    frame[Glyph::LEFT_ONES] = '0';
+    frame[Glyph::COLON] = ':';
+    frame[Glyph::RIGHT_TENS] = '0';
+    frame[Glyph::RIGHT_ONES] = '0';
+}
+
+inline void RenderTime(const Time& time, DisplayFrame& frame)
+{
+    frame[Glyph::LEFT_TENS] = DigitGlyph(time.left_tens);
+    frame[Glyph::LEFT_ONES] = DigitGlyph(time.left_ones);
+    frame[Glyph::COLON] = ':';
+    frame[Glyph::RIGHT_TENS] = DigitGlyph(time.right_tens);
+    frame[Glyph::RIGHT_ONES] = DigitGlyph(time.right_ones);
+}
+
+// "PL" followed by the level, the tens digit only shows for 10
+inline void RenderPowerLevel(const uint32_t powerLevel, DisplayFrame& frame)
+{
+    frame[Glyph::LEFT_TENS] = 'P';
+    frame[Glyph::LEFT_ONES] = 'L';
+    frame[Glyph::COLON] = BlankGlyph;
+    frame[Glyph::RIGHT_TENS] = 1 == powerLevel / 10 ? '1' : BlankGlyph;
+    frame[Glyph::RIGHT_ONES] = DigitGlyph(powerLevel);
+}
+
+// Blink phase of a single position: the colon or one digit of time
+inline void RenderBlinkGlyph(const Glyph glyph, const bool on, const Time& time, DisplayFrame& frame)
+{
+    if(!on) {
+        frame[glyph] = BlankGlyph;
+        return;
+    }
+    switch(glyph) {
+    case Glyph::LEFT_TENS:
+        frame[glyph] = DigitGlyph(time.left_tens);
+        break;
+    case Glyph::LEFT_ONES:
+        frame[glyph] = DigitGlyph(time.left_ones);
+        break;
+    case Glyph::COLON:
+        frame[glyph] = ':';
+        break;
+    case Glyph::RIGHT_TENS:
+        frame[glyph] = DigitGlyph(time.right_tens);
+        break;
+    case Glyph::RIGHT_ONES:
+        frame[glyph] = DigitGlyph(time.right_ones);
+        break;
+    case Glyph::COUNT:
+        break;
+    }
+}
+
+inline void RenderBlinkPowerLevel(const bool on, const uint32_t powerLevel, DisplayFrame& frame)
+{
+    if(on) {
+        RenderPowerLevel(powerLevel, frame);
+    }
+    else {
+        RenderBlank(frame);
+    }
+}
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_DISPLAY_H
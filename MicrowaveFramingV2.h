@@ -0,0 +1,142 @@
+#ifndef MICROWAVE_FRAMING_V2_H
+#define MICROWAVE_FRAMING_V2_H
+
+#include "MicrowaveMessageFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MicrowaveMsgFormat {
+
+// Compact v2 framing (CAP_FRAMING_V2, protocol version 2).
+//
+// After the CAPABILITIES handshake each message is sent as
+//   [type:1][code:1][payload:varint]
+// where type is the Type byte, code is the value's offset from the Type's
+// NONE and payload is data[0..3] read as a little endian uint32 in LEB128
+// form. The Destination magic is implied by the direction of the link.
+// A signal or state takes 3 bytes instead of 12, a countdown delta 4.
+//
+// Several frames may be grouped behind a batch envelope
+//   [V2BatchType][count:varint] frame...
+// which lets a sender flush a burst with one header.
+
+static const uint8_t V2BatchType {0x70};
+static const size_t V2MaxVarintSize {5};
+static const size_t V2MaxFrameSize {2 + V2MaxVarintSize};
+
+enum class V2Result {
+    MESSAGE,    // a message was decoded
+    ENVELOPE,   // a batch header was consumed, no message
+    NEED_MORE,  // truncated, wait for more bytes
+    INVALID     // not a v2 frame at this position
+};
+
+inline size_t EncodeVarint(uint32_t value, char* out)
+{
+    size_t size {0};
+    while(value >= 0x80) {
+        out[size++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out[size++] = static_cast<char>(value);
+    return size;
+}
+
+// Bounds-checked LEB128 read of at most 5 bytes.
+inline V2Result DecodeVarint(const char* in, const size_t avail, uint32_t& value, size_t& used)
+{
+    value = 0;
+    for(size_t i {0}; i < V2MaxVarintSize; ++i) {
+        if(i >= avail) {
+            return V2Result::NEED_MORE;
+        }
+        const uint8_t byte {static_cast<uint8_t>(in[i])};
+        if(V2MaxVarintSize - 1 == i && byte > 0x0F) {
+            return V2Result::INVALID; //more than 32 bits
+        }
+        value |= static_cast<uint32_t>(byte & 0x7F) << (7 * i);
+        if(0 == (byte & 0x80)) {
+            used = i + 1;
+            return V2Result::MESSAGE;
+        }
+    }
+    return V2Result::INVALID;
+}
+
+// out must hold V2MaxFrameSize bytes, returns the encoded size.
+inline size_t EncodeV2(const Message& msg, char* out)
+{
+    const uint32_t value {static_cast<uint32_t>(msg.state)};
+    const uint32_t base {value & 0xFFFFFF00u};
+    //NONE of every Type ends in 0x30
+    const uint32_t none {base | 0x30u};
+    const uint8_t* data {reinterpret_cast<const uint8_t*>(msg.data)};
+    const uint32_t payload {static_cast<uint32_t>(data[0]) |
+                            (static_cast<uint32_t>(data[1]) <<  8) |
+                            (static_cast<uint32_t>(data[2]) << 16) |
+                            (static_cast<uint32_t>(data[3]) << 24)};
+
+    out[0] = static_cast<char>(value >> 24);
+    out[1] = static_cast<char>(value - none);
+    return 2 + EncodeVarint(payload, out + 2);
+}
+
+inline size_t EncodeV2BatchHeader(const uint32_t count, char* out)
+{
+    out[0] = static_cast<char>(V2BatchType);
+    return 1 + EncodeVarint(count, out + 1);
+}
+
+inline V2Result DecodeV2(const char* in, const size_t avail, const Destination dst, Message& msg, size_t& used)
+{
+    if(0 == avail) {
+        return V2Result::NEED_MORE;
+    }
+
+    const uint8_t type {static_cast<uint8_t>(in[0])};
+    if(V2BatchType == type) {
+        uint32_t count {};
+        size_t size {};
+        const V2Result result {DecodeVarint(in + 1, avail - 1, count, size)};
+        if(V2Result::MESSAGE != result) {
+            return result;
+        }
+        used = 1 + size;
+        return V2Result::ENVELOPE;
+    }
+
+    if(static_cast<uint8_t>(Type::STATE) != type &&
+       static_cast<uint8_t>(Type::SIGNAL) != type &&
+       static_cast<uint8_t>(Type::UPDATE) != type) {
+        return V2Result::INVALID;
+    }
+    if(avail < 2) {
+        return V2Result::NEED_MORE;
+    }
+
+    const uint32_t value {((static_cast<uint32_t>(type) << 24) | 0x004D3030u) + static_cast<uint8_t>(in[1])};
+    if(!IsValidValue(value) || (value & 0xFF000000u) != (static_cast<uint32_t>(type) << 24)) {
+        return V2Result::INVALID;
+    }
+
+    uint32_t payload {};
+    size_t size {};
+    const V2Result result {DecodeVarint(in + 2, avail - 2, payload, size)};
+    if(V2Result::MESSAGE != result) {
+        return result;
+    }
+
+    msg.dst = dst;
+    msg.state = static_cast<State>(value);
+    msg.data[0] = static_cast<char>( payload        & 0xFF);
+    msg.data[1] = static_cast<char>((payload >>  8) & 0xFF);
+    msg.data[2] = static_cast<char>((payload >> 16) & 0xFF);
+    msg.data[3] = static_cast<char>((payload >> 24) & 0xFF);
+    used = 2 + size;
+    return V2Result::MESSAGE;
+}
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_FRAMING_V2_H
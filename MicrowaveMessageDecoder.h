@@ -0,0 +1,274 @@
+#ifndef MICROWAVE_MESSAGE_DECODER_H
+#define MICROWAVE_MESSAGE_DECODER_H
+
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveFramingV2.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace MicrowaveMsgFormat {
+
+// Frame layout on the wire (network byte order):
+//   [0..3] Destination magic ("Mapp" / "Mdev")
+//   [4]    Type byte (top byte of the State/Signal/Update value)
+//   [5..7] remaining bytes of the State/Signal/Update value ("M0" + code)
+//   [8..11] data
+static const size_t WireMessageSize {sizeof(Message)};
+static const size_t WireMagicSize {sizeof(Destination)};
+
+// Cheap validity filter run on a candidate header before it is accepted.
+// Rejects anything whose Type byte or enum value is out of range, which is
+// what lets the decoder tell a real header from a stray magic in junk.
+inline bool IsValidWireHeader(const char* frame)
+{
+    const uint8_t* p {reinterpret_cast<const uint8_t*>(frame)};
+    return IsValidValue((static_cast<uint32_t>(p[4]) << 24) |
+                        (static_cast<uint32_t>(p[5]) << 16) |
+                        (static_cast<uint32_t>(p[6]) <<  8) |
+                         static_cast<uint32_t>(p[7]));
+}
+
+// Bounds-checked decode of one v1 frame at in. Never reads past avail and
+// only accepts the expected destination magic followed by a valid header.
+inline bool DecodeWireMessage(const char* in, const size_t avail, const char (&magic)[WireMagicSize], Message& msg)
+{
+    if(avail < WireMessageSize || 0 != memcmp(in, magic, WireMagicSize) || !IsValidWireHeader(in)) {
+        return false;
+    }
+    Message wire;
+    memcpy(&wire, in, WireMessageSize);
+    msg = ByteSwapMessage(wire);
+    return true;
+}
+
+// Incremental decoder for a byte stream of wire messages.
+//
+// Bytes are appended as they arrive; next() hands back one host byte order
+// Message at a time. When the stream is corrupted or misaligned the decoder
+// drops only the bytes in front of the next valid header, so alignment is
+// recovered within one message.
+//
+// With v2 framing enabled both formats are accepted: a v1 frame always
+// starts with the destination magic and a v2 frame with a Type byte, so the
+// first byte tells them apart and frames sent around the switch-over decode
+// either way.
+class MessageDecoder
+{
+public:
+    struct Stats {
+        uint64_t bytesIn;           // total bytes appended
+        uint64_t messages;          // frames handed out by next()
+        uint64_t resyncs;           // times alignment had to be recovered
+        uint64_t bytesDiscarded;    // bytes dropped while resyncing
+        uint64_t rejectedHeaders;   // magic matches that failed validation
+    };
+
+    explicit MessageDecoder(const Destination dst = Destination::APP)
+        : buf{}
+        , pos{0}
+        , stat{}
+        , aligned{true}
+        , dst{dst}
+        , framingV2{false}
+    {
+        // magic is matched in wire (big endian) byte order
+        const uint32_t value {static_cast<uint32_t>(dst)};
+        magic[0] = static_cast<char>((value >> 24) & 0xFF);
+        magic[1] = static_cast<char>((value >> 16) & 0xFF);
+        magic[2] = static_cast<char>((value >>  8) & 0xFF);
+        magic[3] = static_cast<char>( value        & 0xFF);
+    }
+
+    ~MessageDecoder() = default;
+
+    MessageDecoder(const MessageDecoder&) = default;
+    MessageDecoder& operator=(const MessageDecoder&) = default;
+
+    MessageDecoder(MessageDecoder&&) = default;
+    MessageDecoder& operator=(MessageDecoder&&) = default;
+
+    void append(const char* data, const size_t size)
+    {
+        if(0 == size) {
+            return;
+        }
+        compact();
+        buf.insert(buf.end(), data, data + size);
+        stat.bytesIn += size;
+    }
+
+    // Decode the next message into msg. Returns false when no complete
+    // message is buffered; the partial tail is kept for the next append().
+    bool next(Message& msg)
+    {
+        if(framingV2) {
+            return nextMixed(msg);
+        }
+        while(buf.size() - pos >= WireMessageSize) {
+            const char* begin {buf.data() + pos};
+            const char* end {buf.data() + buf.size()};
+
+            //fast path, an aligned stream has a header right here
+            if(DecodeWireMessage(begin, WireMessageSize, magic, msg)) {
+                pos += WireMessageSize;
+                aligned = true;
+                ++stat.messages;
+                return true;
+            }
+
+            const char* match {find(begin, end)};
+
+            if(!match) {
+                //keep the last 3 bytes, a truncated header might be there
+                const size_t keep {WireMagicSize - 1};
+                discard(static_cast<size_t>(end - begin) - keep);
+                return false;
+            }
+
+            discard(static_cast<size_t>(match - begin));
+            if(static_cast<size_t>(end - match) < WireMessageSize) {
+                return false;
+            }
+
+            if(!DecodeWireMessage(match, WireMessageSize, magic, msg)) {
+                ++stat.rejectedHeaders;
+                discard(1);
+                continue;
+            }
+
+            pos += WireMessageSize;
+            aligned = true;
+            ++stat.messages;
+            return true;
+        }
+        return false;
+    }
+
+    void setFramingV2(const bool enabled)
+    {
+        framingV2 = enabled;
+    }
+
+    bool isFramingV2() const
+    {
+        return framingV2;
+    }
+
+    void reset()
+    {
+        buf.clear();
+        pos = 0;
+        aligned = true;
+        framingV2 = false;
+    }
+
+    size_t buffered() const
+    {
+        return buf.size() - pos;
+    }
+
+    const Stats& stats() const
+    {
+        return stat;
+    }
+
+private:
+    std::vector<char> buf;
+    size_t pos;
+    Stats stat;
+    bool aligned;
+    Destination dst;
+    bool framingV2;
+    char magic[WireMagicSize];
+
+    // Byte-at-a-time decoding used once v2 framing is on. Frames are
+    // self-delimiting, so anything that is neither a valid v1 header nor a
+    // valid v2 frame is dropped one byte at a time until one lines up.
+    bool nextMixed(Message& msg)
+    {
+        while(buf.size() > pos) {
+            const char* p {buf.data() + pos};
+            const size_t avail {buf.size() - pos};
+
+            if(magic[0] == *p) {
+                if(avail < WireMessageSize) {
+                    return false;
+                }
+                if(DecodeWireMessage(p, avail, magic, msg)) {
+                    pos += WireMessageSize;
+                    aligned = true;
+                    ++stat.messages;
+                    return true;
+                }
+                ++stat.rejectedHeaders;
+                discard(1);
+                continue;
+            }
+
+            size_t used {};
+            switch(DecodeV2(p, avail, dst, msg, used)) {
+            case V2Result::MESSAGE:
+                pos += used;
+                aligned = true;
+                ++stat.messages;
+                return true;
+            case V2Result::ENVELOPE:
+                pos += used;
+                break;
+            case V2Result::NEED_MORE:
+                return false;
+            case V2Result::INVALID:
+                ++stat.rejectedHeaders;
+                discard(1);
+                break;
+            }
+        }
+        return false;
+    }
+
+    const char* find(const char* begin, const char* end) const
+    {
+        const char* p {begin};
+        while(static_cast<size_t>(end - p) >= WireMagicSize) {
+            p = static_cast<const char*>(memchr(p, magic[0], static_cast<size_t>(end - p) - (WireMagicSize - 1)));
+            if(!p) {
+                return nullptr;
+            }
+            if(0 == memcmp(p, magic, WireMagicSize)) {
+                return p;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    void discard(const size_t count)
+    {
+        if(0 == count) {
+            return;
+        }
+        if(aligned) {
+            //first dropped byte after a good frame starts a resync event
+            ++stat.resyncs;
+            aligned = false;
+        }
+        stat.bytesDiscarded += count;
+        pos += count;
+    }
+
+    void compact()
+    {
+        if(0 == pos) {
+            return;
+        }
+        buf.erase(buf.begin(), buf.begin() + static_cast<std::ptrdiff_t>(pos));
+        pos = 0;
+    }
+};
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_MESSAGE_DECODER_H
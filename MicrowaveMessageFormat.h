@@ -57,7 +57,36 @@ enum class Signal : uint32_t {
     MOD_LEFT_ONES,  // DEV->APP
     MOD_RIGHT_TENS, // DEV->APP
     MOD_RIGHT_ONES, // DEV->APP
-    STATE_REQUEST   // APP->DEV
+    STATE_REQUEST,  // APP->DEV
+    CAPABILITIES    // APP<->DEV
+};
+
+// A device answers STATE_REQUEST within this many milliseconds or the
+// request is taken as lost. It is a little under the app's 500 ms poll, so
+// the poll that follows a lost reply always goes out; senders that merge or
+// suppress repeated requests must give up on a reply within this window.
+static const uint32_t StateReplyWindowMs {450};
+
+// Capability bits carried in data[0] of a Signal::CAPABILITIES message, with
+// the sender's protocol version in data[1]. The app offers every bit it
+// supports and ProtocolVersion once connected, the device echoes back the
+// subset it enables and the version it speaks. Firmware without
+// CAPABILITIES support ignores the offer, which leaves the link on the
+// original protocol (version 1). With CAP_TIMER_SYNC the offer's data[2]
+// carries the longest timer sync interval the app accepts, in seconds, and
+// the reply's data[2] the interval the device uses, which is never longer.
+static const uint8_t ProtocolVersion {2};
+
+enum Capability : uint8_t {
+    CAP_LOCAL_BLINK = 0x01, // device stops sending BLINK_ON/BLINK_OFF, the
+                            // app generates the blink phase itself
+    CAP_BINARY_TIME = 0x02, // clock/timer streams use the *_SECONDS and
+                            // *_DELTA updates (see MicrowaveTimeDelta.h)
+    CAP_FRAMING_V2  = 0x04, // compact framing after the handshake, needs
+                            // version 2 (see MicrowaveFramingV2.h)
+    CAP_TIMER_SYNC  = 0x08  // during a countdown the device sends the timer
+                            // when it starts or jumps and then only every
+                            // sync interval, the app ticks in between
 };
 
 enum class Update : uint32_t {
@@ -65,8 +94,29 @@ enum class Update : uint32_t {
     CLOCK,          // DEV->APP
     DISPLAY_TIMER,  // DEV->APP
     POWER_LEVEL,    // DEV->APP
+    CLOCK_SECONDS,          // DEV->APP, CAP_BINARY_TIME only
+    DISPLAY_TIMER_SECONDS,  // DEV->APP, CAP_BINARY_TIME only
+    CLOCK_DELTA,            // DEV->APP, CAP_BINARY_TIME only
+    DISPLAY_TIMER_DELTA,    // DEV->APP, CAP_BINARY_TIME only
 };
 
+// True when value is a defined State/Signal/Update of the Type in its top byte
+inline bool IsValidValue(const uint32_t value)
+{
+    switch(static_cast<Type>(value >> 24)) {
+    case Type::STATE:
+        return value >= static_cast<uint32_t>(State::NONE) &&
+               value <= static_cast<uint32_t>(State::DISPLAY_TIMER);
+    case Type::SIGNAL:
+        return value >= static_cast<uint32_t>(Signal::NONE) &&
+               value <= static_cast<uint32_t>(Signal::CAPABILITIES);
+    case Type::UPDATE:
+        return value >= static_cast<uint32_t>(Update::NONE) &&
+               value <= static_cast<uint32_t>(Update::DISPLAY_TIMER_DELTA);
+    }
+    return false;
+}
+
 class Time {
 public:
     Time() = default;
@@ -103,6 +153,8 @@ class Message
 {
 public:
     Message() = default;
+    //rxData must hold sizeof(Message) readable bytes, use
+    // DecodeWireMessage() (MicrowaveMessageDecoder.h) on untrusted input
     Message(const char* rxData)
         : data{}
     {
@@ -0,0 +1,346 @@
+#ifndef MICROWAVE_PERF_COUNTERS_H
+#define MICROWAVE_PERF_COUNTERS_H
+
+#include "MicrowaveMessageFormat.h"
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace MicrowaveMsgFormat {
+
+// Hot sections of the receive path. Sections nest: DISPATCH includes the
+// DISPLAY work a message causes.
+enum class PerfSection : uint8_t {
+    READ = 0,   // taking messages off the transport
+    DISPATCH,   // one message through the State/Signal/Update switches
+    DISPLAY,    // rendering the time and pushing it to the display
+    COUNT
+};
+
+enum class PerfCounter : uint8_t {
+    CYCLES = 0,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    CACHE_MISSES,
+    COUNT
+};
+
+static const size_t PerfSectionCount {static_cast<size_t>(PerfSection::COUNT)};
+static const size_t PerfCounterCount {static_cast<size_t>(PerfCounter::COUNT)};
+
+// Samples are kept per message Type, plus one slot for work not tied to a
+// single message
+static const size_t PerfTypeCount {4};
+static const size_t PerfNoType {3};
+
+inline size_t PerfTypeOf(const Message& msg)
+{
+    switch(static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
+    case Type::STATE:
+        return 0;
+    case Type::SIGNAL:
+        return 1;
+    case Type::UPDATE:
+        return 2;
+    }
+    return PerfNoType;
+}
+
+struct PerfReading
+{
+    uint64_t ns;
+    uint64_t values[PerfCounterCount];
+};
+
+// Hardware counters of the calling thread.
+//
+// User space only, which the default perf_event_paranoid of 2 allows. The
+// counters form one group, so they are scheduled together and read with a
+// single read(). A counter the CPU or hypervisor does not offer stays
+// unavailable and reads as 0; with no counters at all, as in most VMs or
+// off Linux, only the clock is read.
+class PerfCounters
+{
+public:
+    PerfCounters()
+        : fds{-1, -1, -1, -1}
+        , ids{}
+    {
+#ifdef __linux__
+        const uint64_t configs[PerfCounterCount] {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_BRANCH_MISSES,
+            PERF_COUNT_HW_CACHE_MISSES,
+        };
+        for(size_t i {0}; i < PerfCounterCount; ++i) {
+            perf_event_attr attr {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = -1 == leader() ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+            fds[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader(), 0));
+            if(-1 != fds[i]) {
+                ioctl(fds[i], PERF_EVENT_IOC_ID, &ids[i]);
+            }
+        }
+        if(-1 != leader()) {
+            ioctl(leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for(const int fd : fds) {
+            if(-1 != fd) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool isAvailable(const PerfCounter counter) const
+    {
+        return -1 != fds[static_cast<size_t>(counter)];
+    }
+
+    void read(PerfReading& reading) const
+    {
+        timespec now {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        reading.ns = static_cast<uint64_t>(now.tv_sec) * 1000000000u + static_cast<uint64_t>(now.tv_nsec);
+        for(uint64_t& value : reading.values) {
+            value = 0;
+        }
+#ifdef __linux__
+        if(-1 == leader()) {
+            return;
+        }
+        //{nr, {value, id} * nr}
+        uint64_t group[1 + 2 * PerfCounterCount];
+        if(::read(leader(), group, sizeof(group)) <= 0) {
+            return;
+        }
+        for(uint64_t i {0}; i < group[0] && i < PerfCounterCount; ++i) {
+            for(size_t j {0}; j < PerfCounterCount; ++j) {
+                if(-1 != fds[j] && ids[j] == group[2 + 2 * i]) {
+                    reading.values[j] = group[1 + 2 * i];
+                }
+            }
+        }
+#endif
+    }
+
+private:
+    int fds[PerfCounterCount];
+    uint64_t ids[PerfCounterCount];
+
+    //the first counter that opened leads the group
+    int leader() const
+    {
+        for(const int fd : fds) {
+            if(-1 != fd) {
+                return fd;
+            }
+        }
+        return -1;
+    }
+};
+
+// Counter deltas summed per section and message type.
+//
+// Reading the counters costs a syscall, which lands in the measured
+// section. calibrate() measures empty sections and report() takes that
+// cost back out of every call.
+class PerfProfile
+{
+public:
+    PerfProfile()
+        : counters{}
+        , cells{}
+        , overhead{}
+    {
+    }
+
+    void begin(PerfReading& start) const
+    {
+        counters.read(start);
+    }
+
+    void end(const PerfSection section, const size_t type, const PerfReading& start)
+    {
+        PerfReading now;
+        counters.read(now);
+        Cell& cell {cells[static_cast<size_t>(section)][type < PerfTypeCount ? type : PerfNoType]};
+        ++cell.calls;
+        cell.ns += now.ns - start.ns;
+        for(size_t i {0}; i < PerfCounterCount; ++i) {
+            cell.values[i] += now.values[i] - start.values[i];
+        }
+    }
+
+    void calibrate(const size_t rounds = 1000)
+    {
+        Cell empty {};
+        for(size_t i {0}; i < rounds; ++i) {
+            PerfReading start;
+            PerfReading now;
+            counters.read(start);
+            counters.read(now);
+            empty.ns += now.ns - start.ns;
+            for(size_t j {0}; j < PerfCounterCount; ++j) {
+                empty.values[j] += now.values[j] - start.values[j];
+            }
+        }
+        overhead.ns = empty.ns / rounds;
+        for(size_t j {0}; j < PerfCounterCount; ++j) {
+            overhead.values[j] = empty.values[j] / rounds;
+        }
+    }
+
+    void reset()
+    {
+        for(auto& row : cells) {
+            for(Cell& cell : row) {
+                cell = Cell{};
+            }
+        }
+    }
+
+    bool hasCounters() const
+    {
+        for(size_t i {0}; i < PerfCounterCount; ++i) {
+            if(counters.isAvailable(static_cast<PerfCounter>(i))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // One line per section and type that ran, with per call averages
+    std::string report() const
+    {
+        static const char* const SECTION_NAMES[PerfSectionCount] {"read", "dispatch", "display"};
+        static const char* const TYPE_NAMES[PerfTypeCount] {"State", "Signal", "Update", "-"};
+
+        std::string text;
+        char line[192];
+        snprintf(line, sizeof(line), "%-9s %-7s %10s %9s %9s %9s %6s %9s %9s\n", "section", "type",
+                 "calls", "ns", "cycles", "instr", "IPC", "br-miss", "cache-miss");
+        text += line;
+        for(size_t s {0}; s < PerfSectionCount; ++s) {
+            for(size_t t {0}; t < PerfTypeCount; ++t) {
+                const Cell& cell {cells[s][t]};
+                if(0 == cell.calls) {
+                    continue;
+                }
+                double perCall[PerfCounterCount];
+                for(size_t i {0}; i < PerfCounterCount; ++i) {
+                    perCall[i] = average(cell.values[i], overhead.values[i], cell.calls);
+                }
+                const size_t cycles {static_cast<size_t>(PerfCounter::CYCLES)};
+                const size_t instructions {static_cast<size_t>(PerfCounter::INSTRUCTIONS)};
+                snprintf(line, sizeof(line), "%-9s %-7s %10" PRIu64 " %9.1f %9s %9s %6s %9s %9s\n",
+                         SECTION_NAMES[s], TYPE_NAMES[t], cell.calls,
+                         average(cell.ns, overhead.ns, cell.calls),
+                         column(PerfCounter::CYCLES, perCall[cycles], "%.1f").c_str(),
+                         column(PerfCounter::INSTRUCTIONS, perCall[instructions], "%.1f").c_str(),
+                         counters.isAvailable(PerfCounter::CYCLES) && perCall[cycles] > 0 ?
+                             column(PerfCounter::INSTRUCTIONS, perCall[instructions] / perCall[cycles], "%.2f").c_str() :
+                             "n/a",
+                         column(PerfCounter::BRANCH_MISSES,
+                                perCall[static_cast<size_t>(PerfCounter::BRANCH_MISSES)], "%.2f").c_str(),
+                         column(PerfCounter::CACHE_MISSES,
+                                perCall[static_cast<size_t>(PerfCounter::CACHE_MISSES)], "%.2f").c_str());
+                text += line;
+            }
+        }
+        if(!hasCounters()) {
+            text += "hardware counters unavailable, clock only\n";
+        }
+        return text;
+    }
+
+private:
+    struct Cell
+    {
+        uint64_t calls;
+        uint64_t ns;
+        uint64_t values[PerfCounterCount];
+    };
+
+    PerfCounters counters;
+    Cell cells[PerfSectionCount][PerfTypeCount];
+    Cell overhead;              // of one empty section
+
+    static double average(const uint64_t total, const uint64_t overhead, const uint64_t calls)
+    {
+        const double value {static_cast<double>(total) / static_cast<double>(calls) - static_cast<double>(overhead)};
+        return value > 0 ? value : 0;
+    }
+
+    std::string column(const PerfCounter counter, const double value, const char* format) const
+    {
+        if(!counters.isAvailable(counter)) {
+            return "n/a";
+        }
+        char text[32];
+        snprintf(text, sizeof(text), format, value);
+        return text;
+    }
+};
+
+// Measures the enclosing block as one call of section. Does nothing for a
+// null profile, so instrumented code pays one branch when profiling is off.
+class PerfScope
+{
+public:
+    PerfScope(PerfProfile* profile, const PerfSection section, const size_t type = PerfNoType)
+        : profile{profile}
+        , section{section}
+        , type{type}
+        , start{}
+    {
+        if(profile) {
+            profile->begin(start);
+        }
+    }
+
+    ~PerfScope()
+    {
+        if(profile) {
+            profile->end(section, type, start);
+        }
+    }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfProfile* profile;
+    PerfSection section;
+    size_t type;
+    PerfReading start;
+};
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_PERF_COUNTERS_H
@@ -0,0 +1,1005 @@
+#ifndef MICROWAVE_PROTOCOL_CORE_H
+#define MICROWAVE_PROTOCOL_CORE_H
+
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveDisplay.h"
+#include "MicrowaveTimeDelta.h"
+#include "MicrowaveCapture.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+namespace MicrowaveMsgFormat {
+
+// Leaf states of the app's state machine, with the composite states of the
+// display hierarchy they belong to.
+enum class CoreState : uint8_t {
+    INITIAL = 0,
+    DISPLAY_CLOCK,              // DisplayClock/DisplayClockInit
+    SET_CLOCK,                  // DisplayClock/SetClock/SetClockInit
+    CLOCK_SELECT_HOUR_TENS,     // DisplayClock/SetClock/...
+    CLOCK_SELECT_HOUR_ONES,
+    CLOCK_SELECT_MINUTE_TENS,
+    CLOCK_SELECT_MINUTE_ONES,
+    SET_COOK_TIMER,
+    SET_POWER_LEVEL,
+    SET_KITCHEN_TIMER,          // SetKitchenTimer/SetKitchenTimerInit
+    KITCHEN_SELECT_MINUTE_TENS, // SetKitchenTimer/...
+    KITCHEN_SELECT_MINUTE_ONES,
+    KITCHEN_SELECT_SECOND_TENS,
+    KITCHEN_SELECT_SECOND_ONES,
+    DISPLAY_TIMER,
+    COUNT
+};
+
+static const size_t CoreStateCount {static_cast<size_t>(CoreState::COUNT)};
+
+// Name of a leaf state, for logs and reports
+inline const char* CoreStateName(const CoreState state)
+{
+    static const char* const names[CoreStateCount] {
+        "InitialState",
+        "DisplayClock",
+        "SetClock",
+        "ClockSelectHourTens",
+        "ClockSelectHourOnes",
+        "ClockSelectMinuteTens",
+        "ClockSelectMinuteOnes",
+        "SetCookTimer",
+        "SetPowerLevel",
+        "SetKitchenTimer",
+        "KitchenSelectMinuteTens",
+        "KitchenSelectMinuteOnes",
+        "KitchenSelectSecondTens",
+        "KitchenSelectSecondOnes",
+        "DisplayTimer",
+    };
+    return static_cast<size_t>(state) < CoreStateCount ? names[static_cast<size_t>(state)] : "?";
+}
+
+// Display gating, see ProtocolCore::gating()
+enum CoreGating : uint8_t {
+    GATING_CLOCK_DISABLED       = 0x01, // disableClockDisplay
+    GATING_TIMER_DISABLED       = 0x02, // disableDisplayTimer
+    GATING_POWER_LEVEL_DISABLED = 0x04, // disablePowerLevel
+    GATING_OVERLAY_ARMED        = 0x08, // POWER_LEVEL would start the overlay
+    GATING_OVERLAY_ACTIVE       = 0x10  // the power level overlay is shown
+};
+
+// Everything the app offers in its CAPABILITIES message
+static const uint8_t CoreCapabilities {CAP_LOCAL_BLINK | CAP_BINARY_TIME | CAP_FRAMING_V2 | CAP_TIMER_SYNC};
+
+// How long a POWER_LEVEL press shows the level over a running timer
+static const uint64_t PowerLevelOverlayMs {2000};
+
+// Blink half period of the device and, with CAP_LOCAL_BLINK, of the app
+static const uint64_t BlinkHalfPeriodMs {500};
+
+// The countdown between CAP_TIMER_SYNC syncs, see ProtocolCore::sync()
+static const uint8_t TimerSyncOfferS {10};      // longest interval offered
+static const uint32_t CountdownTickMs {1000};   // nominal device second
+static const uint32_t CountdownMinTickMs {950}; // measured seconds outside
+static const uint32_t CountdownMaxTickMs {1050};// these are jitter
+static const uint32_t CountdownMissedSyncs {2}; // intervals before it holds
+
+// Serialized ProtocolCore state, see ProtocolCore::saveSnapshot
+//
+//   [version:1][state:1][flags:1][power level:1][time digits:4][frame:5]
+//   [clock seconds:4][timer seconds:4][overlay expiry ms:8]
+//
+// and since version 2 the countdown between timer syncs
+//
+//   [sync interval s:1][countdown flags:1][tick ms:2][last sync ms:8]
+//   [last sync seconds:4][anchor ms:8][anchor seconds:4][shown seconds:4]
+//   [next tick ms:8]
+//
+// and since version 3 the blink phase generated with CAP_LOCAL_BLINK
+//
+//   [blink flags:1][blink anchor ms:8][next blink ms:8]
+//
+// Multi-byte fields are big endian. Older snapshots still load, as a link
+// without the capabilities added since.
+static const uint8_t CoreSnapshotVersion {3};
+static const size_t CoreSnapshotSizeV1 {29};
+static const size_t CoreSnapshotSizeV2 {69};
+static const size_t CoreSnapshotSize {86};
+
+// The app's display logic, without Qt.
+//
+// Holds the state machine of the Microwave window: its transitions, the
+// display gating set up on entry and exit, the power level overlay, the
+// countdown between CAP_TIMER_SYNC syncs and the blink phase, which with
+// CAP_LOCAL_BLINK is generated here instead of by the device. The result is
+// kept in a DisplayFrame. The app feeds every DEV->APP message in and
+// pushes the frame to its labels, replay, the simulator and the explorer
+// run the same code headless. Time is supplied by the caller, which makes
+// replay deterministic, and so are the timeouts, through nextTimeout() and
+// advance().
+//
+// The app smooths the device's blink frames in its BlinkEngine and passes
+// the resulting phase to blink(); headless, process() takes the frames
+// straight, so the phase changes when a frame arrives.
+class ProtocolCore
+{
+public:
+    // App side hooks, called from inside process() and the other calls
+    // that change the core
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+
+        //after a transition, the display already updated
+        virtual void stateChanged(const CoreState from, const CoreState to) = 0;
+        //a clock or timer value arrived. shown is the time the display is
+        // drawn from and is the listener's to set; without a listener it
+        // becomes received
+        virtual void timeReceived(const Time& received, const TimeStream stream, Time& shown) = 0;
+    };
+
+    ProtocolCore()
+        : listener{nullptr}
+    {
+        reset();
+    }
+
+    void setListener(Listener* listener)
+    {
+        this->listener = listener;
+    }
+
+    void reset()
+    {
+        current = CoreState::INITIAL;
+        time.clear();
+        timeDecoder.reset();
+        level = 0;
+        disableClockDisplay = false;
+        disableDisplayTimer = false;
+        disablePowerLevel = false;
+        blinkOn = true;
+        overlayArmed = false;
+        overlayActive = false;
+        overlayExpiryMs = 0;
+        syncIntervalS = 1;
+        tickMs = CountdownTickMs;
+        clearCountdown();
+        localBlink = false;
+        blinkAnchorMs = 0;
+        blinkAnchorOn = true;
+        nextBlinkMs = 0;
+        invalidCount = 0;
+        RenderInitial(display);
+    }
+
+    // Handles one DEV->APP message received at nowMs (any monotonic
+    // millisecond clock). Returns true when the display changed.
+    bool process(const Message& msg, const uint64_t nowMs)
+    {
+        const DisplayFrame before {display};
+        advance(nowMs);
+        switch(static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
+        case Type::STATE:
+            handleState(msg.state);
+            break;
+        case Type::SIGNAL:
+            if(Signal::CAPABILITIES == msg.signal) {
+                negotiate(msg, nowMs);
+            }
+            else if(!handleSignal(msg.signal, nowMs)) {
+                ++invalidCount;
+            }
+            break;
+        case Type::UPDATE:
+            handleUpdate(msg, nowMs);
+            break;
+        }
+        return before != display;
+    }
+
+    // Runs the timeouts due at nowMs. Returns true when the display changed.
+    bool advance(const uint64_t nowMs)
+    {
+        const DisplayFrame before {display};
+        if(tickPending && nowMs >= nextTickMs) {
+            tick(nowMs);
+        }
+        if(overlayActive && nowMs >= overlayExpiryMs) {
+            overlayActive = false;
+            disableDisplayTimer = false;
+            disablePowerLevel = true;
+            RenderTime(displayedTime(), display);
+            overlayArmed = true;
+        }
+        if(localBlink && nowMs >= nextBlinkMs) {
+            //derive the phase from the anchor, a late call must not invert it
+            const uint64_t edges {(nowMs - blinkAnchorMs) / BlinkHalfPeriodMs};
+            setBlink(0 == (edges & 1) ? blinkAnchorOn : !blinkAnchorOn);
+            nextBlinkMs = blinkAnchorMs + (edges + 1) * BlinkHalfPeriodMs;
+        }
+        return before != display;
+    }
+
+    // When the next timeout falls due, false when none is pending
+    bool nextTimeout(uint64_t& whenMs) const
+    {
+        const uint64_t due[] {overlayActive ? overlayExpiryMs : UINT64_MAX,
+                              tickPending ? nextTickMs : UINT64_MAX,
+                              localBlink ? nextBlinkMs : UINT64_MAX};
+        whenMs = *std::min_element(std::begin(due), std::end(due));
+        return UINT64_MAX != whenMs;
+    }
+
+    // A blink edge at nowMs, from the device or from the app's BlinkEngine.
+    // With local blink it re-anchors the local phase. Returns true when the
+    // display changed.
+    bool blink(const bool on, const uint64_t nowMs)
+    {
+        const DisplayFrame before {display};
+        if(localBlink) {
+            anchorBlink(on, nowMs);
+        }
+        else {
+            setBlink(on);
+        }
+        return before != display;
+    }
+
+    // Replaces the time the display is drawn from, for the app's local
+    // echo of digit keys. Redrawn unless the power level is on display.
+    void showTime(const Time& shown)
+    {
+        time = shown;
+        if(CoreState::SET_POWER_LEVEL != current && !overlayActive) {
+            RenderTime(displayedTime(), display);
+        }
+    }
+
+    // Shows values kept from an earlier session until the device reports,
+    // the power level instead of the time when showLevel is set
+    void restore(const Time& cached, const uint32_t cachedLevel, const bool showLevel)
+    {
+        time = cached;
+        level = cachedLevel;
+        if(showLevel) {
+            RenderPowerLevel(level, display);
+        }
+        else {
+            RenderTime(time, display);
+        }
+    }
+
+    // The link went down. What was negotiated and the time streams go with
+    // it, the blink stops lit and a countdown holds where it was. The state
+    // stays, the display keeps showing it until the device is back. Returns
+    // true when the display changed.
+    bool linkReset()
+    {
+        const DisplayFrame before {display};
+        syncIntervalS = 1;
+        clearCountdown();
+        timeDecoder.reset();
+        localBlink = false;
+        if(!blinkOn) {
+            setBlink(true);
+        }
+        return before != display;
+    }
+
+    CoreState state() const
+    {
+        return current;
+    }
+
+    const DisplayFrame& frame() const
+    {
+        return display;
+    }
+
+    // The time shown, between timer syncs the local countdown's
+    const Time& displayedTime() const
+    {
+        return anchored ? countdownTime : time;
+    }
+
+    // The device's time with the app's digit echo on top, see showTime()
+    const Time& currentTime() const
+    {
+        return time;
+    }
+
+    // Seconds between CAP_TIMER_SYNC syncs, 1 on the original protocol
+    uint32_t syncInterval() const
+    {
+        return syncIntervalS;
+    }
+
+    // True once the device has agreed to CAP_LOCAL_BLINK
+    bool isLocalBlink() const
+    {
+        return localBlink;
+    }
+
+    uint32_t powerLevel() const
+    {
+        return level;
+    }
+
+    // CoreGating bits currently set
+    uint8_t gating() const
+    {
+        return static_cast<uint8_t>((disableClockDisplay ? GATING_CLOCK_DISABLED : 0) |
+                                    (disableDisplayTimer ? GATING_TIMER_DISABLED : 0) |
+                                    (disablePowerLevel ? GATING_POWER_LEVEL_DISABLED : 0) |
+                                    (overlayArmed ? GATING_OVERLAY_ARMED : 0) |
+                                    (overlayActive ? GATING_OVERLAY_ACTIVE : 0));
+    }
+
+    // Key and mode signals that arrived in a state without a transition for them
+    uint64_t invalidTransitions() const
+    {
+        return invalidCount;
+    }
+
+    // Everything process() depends on, out must hold CoreSnapshotSize bytes.
+    // The invalid transition count is a statistic and not part of it.
+    size_t saveSnapshot(char* out) const
+    {
+        const uint8_t flags {static_cast<uint8_t>((disableClockDisplay ? SNAPSHOT_DISABLE_CLOCK : 0) |
+                                                  (disableDisplayTimer ? SNAPSHOT_DISABLE_TIMER : 0) |
+                                                  (disablePowerLevel ? SNAPSHOT_DISABLE_POWER_LEVEL : 0) |
+                                                  (blinkOn ? SNAPSHOT_BLINK_ON : 0) |
+                                                  (overlayArmed ? SNAPSHOT_OVERLAY_ARMED : 0) |
+                                                  (overlayActive ? SNAPSHOT_OVERLAY_ACTIVE : 0))};
+        uint32_t clockSeconds {};
+        uint32_t timerSeconds {};
+        const bool clockValid {timeDecoder.value(TimeStream::CLOCK, clockSeconds)};
+        const bool timerValid {timeDecoder.value(TimeStream::DISPLAY_TIMER, timerSeconds)};
+
+        out[0] = static_cast<char>(CoreSnapshotVersion);
+        out[1] = static_cast<char>(current);
+        out[2] = static_cast<char>(flags | (clockValid ? SNAPSHOT_CLOCK_VALID : 0) |
+                                   (timerValid ? SNAPSHOT_TIMER_VALID : 0));
+        out[3] = static_cast<char>(level);
+        out[4] = static_cast<char>(time.left_tens);
+        out[5] = static_cast<char>(time.left_ones);
+        out[6] = static_cast<char>(time.right_tens);
+        out[7] = static_cast<char>(time.right_ones);
+        memcpy(out + 8, display.glyphs, GlyphCount);
+        PutBigEndian(out + 13, clockSeconds, 4);
+        PutBigEndian(out + 17, timerSeconds, 4);
+        PutBigEndian(out + 21, overlayExpiryMs, 8);
+        out[29] = static_cast<char>(syncIntervalS);
+        out[30] = static_cast<char>((anchored ? COUNTDOWN_ANCHORED : 0) |
+                                    (tickPending ? COUNTDOWN_TICK_PENDING : 0) |
+                                    (lastSyncValid ? COUNTDOWN_LAST_SYNC_VALID : 0));
+        PutBigEndian(out + 31, tickMs, 2);
+        PutBigEndian(out + 33, lastSyncMs, 8);
+        PutBigEndian(out + 41, lastSyncSeconds, 4);
+        PutBigEndian(out + 45, anchorMs, 8);
+        PutBigEndian(out + 53, anchorSeconds, 4);
+        PutBigEndian(out + 57, shownSeconds, 4);
+        PutBigEndian(out + 61, nextTickMs, 8);
+        out[69] = static_cast<char>((localBlink ? BLINK_LOCAL : 0) | (blinkAnchorOn ? BLINK_ANCHOR_ON : 0));
+        PutBigEndian(out + 70, blinkAnchorMs, 8);
+        PutBigEndian(out + 78, nextBlinkMs, 8);
+        return CoreSnapshotSize;
+    }
+
+    // Replaces the current state with a saved one. Returns false, leaving
+    // the core untouched, for a snapshot that is truncated, of an unknown
+    // version or out of range.
+    bool loadSnapshot(const char* in, const size_t size)
+    {
+        static const size_t sizes[CoreSnapshotVersion + 1] {0, CoreSnapshotSizeV1, CoreSnapshotSizeV2,
+                                                            CoreSnapshotSize};
+        const uint8_t version {size > 0 ? static_cast<uint8_t>(in[0]) : uint8_t{0}};
+        if(version < 1 || version > CoreSnapshotVersion || size < sizes[version] ||
+           static_cast<uint8_t>(in[1]) >= CoreStateCount || static_cast<uint8_t>(in[3]) > 99) {
+            return false;
+        }
+        for(size_t i {4}; i < 8; ++i) {
+            if(static_cast<uint8_t>(in[i]) > 9) {
+                return false;
+            }
+        }
+        const uint8_t interval {version > 1 ? static_cast<uint8_t>(in[29]) : uint8_t{1}};
+        const uint32_t tick {version > 1 ? static_cast<uint32_t>(GetBigEndian(in + 31, 2)) : CountdownTickMs};
+        if(interval < 1 || interval > TimerSyncOfferS || tick < CountdownMinTickMs || tick > CountdownMaxTickMs) {
+            return false;
+        }
+
+        const uint8_t flags {static_cast<uint8_t>(in[2])};
+        current = static_cast<CoreState>(in[1]);
+        level = static_cast<uint8_t>(in[3]);
+        time.left_tens = static_cast<uint8_t>(in[4]);
+        time.left_ones = static_cast<uint8_t>(in[5]);
+        time.right_tens = static_cast<uint8_t>(in[6]);
+        time.right_ones = static_cast<uint8_t>(in[7]);
+        memcpy(display.glyphs, in + 8, GlyphCount);
+        timeDecoder.setValue(TimeStream::CLOCK, static_cast<uint32_t>(GetBigEndian(in + 13, 4)),
+                             flags & SNAPSHOT_CLOCK_VALID);
+        timeDecoder.setValue(TimeStream::DISPLAY_TIMER, static_cast<uint32_t>(GetBigEndian(in + 17, 4)),
+                             flags & SNAPSHOT_TIMER_VALID);
+        overlayExpiryMs = GetBigEndian(in + 21, 8);
+        disableClockDisplay = flags & SNAPSHOT_DISABLE_CLOCK;
+        disableDisplayTimer = flags & SNAPSHOT_DISABLE_TIMER;
+        disablePowerLevel = flags & SNAPSHOT_DISABLE_POWER_LEVEL;
+        blinkOn = flags & SNAPSHOT_BLINK_ON;
+        overlayArmed = flags & SNAPSHOT_OVERLAY_ARMED;
+        overlayActive = flags & SNAPSHOT_OVERLAY_ACTIVE;
+
+        clearCountdown();
+        syncIntervalS = interval;
+        tickMs = tick;
+        if(version > 1) {
+            const uint8_t countdown {static_cast<uint8_t>(in[30])};
+            anchored = countdown & COUNTDOWN_ANCHORED;
+            tickPending = countdown & COUNTDOWN_TICK_PENDING;
+            lastSyncValid = countdown & COUNTDOWN_LAST_SYNC_VALID;
+            lastSyncMs = GetBigEndian(in + 33, 8);
+            lastSyncSeconds = static_cast<uint32_t>(GetBigEndian(in + 41, 4));
+            anchorMs = GetBigEndian(in + 45, 8);
+            anchorSeconds = static_cast<uint32_t>(GetBigEndian(in + 53, 4));
+            shownSeconds = static_cast<uint32_t>(GetBigEndian(in + 57, 4));
+            nextTickMs = GetBigEndian(in + 61, 8);
+            SecondsToTime(TimeStream::DISPLAY_TIMER, shownSeconds, countdownTime);
+        }
+        localBlink = false;
+        blinkAnchorMs = 0;
+        blinkAnchorOn = true;
+        nextBlinkMs = 0;
+        if(version > 2) {
+            const uint8_t blinkFlags {static_cast<uint8_t>(in[69])};
+            localBlink = blinkFlags & BLINK_LOCAL;
+            blinkAnchorOn = blinkFlags & BLINK_ANCHOR_ON;
+            blinkAnchorMs = GetBigEndian(in + 70, 8);
+            nextBlinkMs = GetBigEndian(in + 78, 8);
+        }
+        return true;
+    }
+
+private:
+    //bits of the snapshot flags byte
+    static const uint8_t SNAPSHOT_DISABLE_CLOCK {0x01};
+    static const uint8_t SNAPSHOT_DISABLE_TIMER {0x02};
+    static const uint8_t SNAPSHOT_DISABLE_POWER_LEVEL {0x04};
+    static const uint8_t SNAPSHOT_BLINK_ON {0x08};
+    static const uint8_t SNAPSHOT_OVERLAY_ARMED {0x10};
+    static const uint8_t SNAPSHOT_OVERLAY_ACTIVE {0x20};
+    static const uint8_t SNAPSHOT_CLOCK_VALID {0x40};
+    static const uint8_t SNAPSHOT_TIMER_VALID {0x80};
+    //bits of the countdown flags byte
+    static const uint8_t COUNTDOWN_ANCHORED {0x01};
+    static const uint8_t COUNTDOWN_TICK_PENDING {0x02};
+    static const uint8_t COUNTDOWN_LAST_SYNC_VALID {0x04};
+    //bits of the blink flags byte
+    static const uint8_t BLINK_LOCAL {0x01};
+    static const uint8_t BLINK_ANCHOR_ON {0x02};
+
+    Listener* listener;
+    CoreState current;
+    Time time;
+    TimeDeltaDecoder timeDecoder;
+    uint32_t level;
+    bool disableClockDisplay;
+    bool disableDisplayTimer;
+    bool disablePowerLevel;
+    bool blinkOn;
+    bool overlayArmed;          // a POWER_LEVEL press shows the overlay
+    bool overlayActive;
+    uint64_t overlayExpiryMs;
+    //the countdown, only ever active with a sync interval above 1
+    uint32_t syncIntervalS;
+    uint32_t tickMs;
+    bool lastSyncValid;
+    uint64_t lastSyncMs;
+    uint32_t lastSyncSeconds;
+    bool anchored;              // the countdown, not the device, has the display
+    uint64_t anchorMs;
+    uint32_t anchorSeconds;
+    uint32_t shownSeconds;
+    Time countdownTime;
+    bool tickPending;
+    uint64_t nextTickMs;
+    //CAP_LOCAL_BLINK, the phase follows from the anchor
+    bool localBlink;
+    uint64_t blinkAnchorMs;
+    bool blinkAnchorOn;
+    uint64_t nextBlinkMs;
+    uint64_t invalidCount;
+    DisplayFrame display;
+
+    static bool isDigits(const char* data, const int count)
+    {
+        for(int i {0}; i < count; ++i) {
+            if(data[i] < '0' || data[i] > '9') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool inSetClock() const
+    {
+        return current >= CoreState::SET_CLOCK && current <= CoreState::CLOCK_SELECT_MINUTE_ONES;
+    }
+
+    bool inSetKitchenTimer() const
+    {
+        return current >= CoreState::SET_KITCHEN_TIMER && current <= CoreState::KITCHEN_SELECT_SECOND_ONES;
+    }
+
+    void transition(const CoreState target)
+    {
+        const CoreState from {current};
+        exitState(current);
+        current = target;
+        enterState(target);
+        if(listener) {
+            listener->stateChanged(from, target);
+        }
+    }
+
+    void exitState(const CoreState state)
+    {
+        switch(state) {
+        case CoreState::CLOCK_SELECT_HOUR_TENS:
+        case CoreState::CLOCK_SELECT_HOUR_ONES:
+        case CoreState::CLOCK_SELECT_MINUTE_TENS:
+        case CoreState::CLOCK_SELECT_MINUTE_ONES:
+            RenderTime(time, display);
+            break;
+        case CoreState::SET_COOK_TIMER:
+            disableClockDisplay = false;
+            disablePowerLevel = false;
+            break;
+        case CoreState::SET_POWER_LEVEL:
+            disableClockDisplay = false;
+            break;
+        case CoreState::DISPLAY_TIMER:
+            clearCountdown();
+            overlayArmed = false;
+            if(overlayActive) {
+                overlayActive = false;
+                disableDisplayTimer = false;
+            }
+            disableClockDisplay = false;
+            disablePowerLevel = false;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void enterState(const CoreState state)
+    {
+        switch(state) {
+        case CoreState::SET_COOK_TIMER:
+            disableClockDisplay = true;
+            disablePowerLevel = true;
+            RenderTime(time, display);
+            break;
+        case CoreState::SET_POWER_LEVEL:
+            disableClockDisplay = true;
+            RenderPowerLevel(level, display);
+            break;
+        case CoreState::DISPLAY_TIMER:
+            clearCountdown();
+            overlayArmed = true;
+            disableClockDisplay = true;
+            disablePowerLevel = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    // State replies only move the machine out of InitialState
+    void handleState(const State state)
+    {
+        if(CoreState::INITIAL != current) {
+            return;
+        }
+        switch(state) {
+        case State::DISPLAY_CLOCK:
+            transition(CoreState::DISPLAY_CLOCK);
+            break;
+        case State::CLOCK_SELECT_HOUR_TENS:
+            transition(CoreState::CLOCK_SELECT_HOUR_TENS);
+            break;
+        case State::CLOCK_SELECT_HOUR_ONES:
+            transition(CoreState::CLOCK_SELECT_HOUR_ONES);
+            break;
+        case State::CLOCK_SELECT_MINUTE_TENS:
+            transition(CoreState::CLOCK_SELECT_MINUTE_TENS);
+            break;
+        case State::CLOCK_SELECT_MINUTE_ONES:
+            transition(CoreState::CLOCK_SELECT_MINUTE_ONES);
+            break;
+        case State::SET_COOK_TIMER:
+            transition(CoreState::SET_COOK_TIMER);
+            break;
+        case State::SET_POWER_LEVEL:
+            transition(CoreState::SET_POWER_LEVEL);
+            break;
+        case State::KITCHEN_SELECT_HOUR_TENS:
+            transition(CoreState::KITCHEN_SELECT_MINUTE_TENS);
+            break;
+        case State::KITCHEN_SELECT_HOUR_ONES:
+            transition(CoreState::KITCHEN_SELECT_MINUTE_ONES);
+            break;
+        case State::KITCHEN_SELECT_MINUTE_TENS:
+            transition(CoreState::KITCHEN_SELECT_SECOND_TENS);
+            break;
+        case State::KITCHEN_SELECT_MINUTE_ONES:
+            transition(CoreState::KITCHEN_SELECT_SECOND_ONES);
+            break;
+        case State::DISPLAY_TIMER:
+            transition(CoreState::DISPLAY_TIMER);
+            break;
+        case State::NONE:
+            break;
+        }
+    }
+
+    // Returns false for a key or mode signal the current state has no
+    // transition for, which the app silently drops
+    bool handleSignal(const Signal signal, const uint64_t nowMs)
+    {
+        switch(signal) {
+        case Signal::CLOCK:
+            if(CoreState::DISPLAY_CLOCK == current) {
+                transition(CoreState::SET_CLOCK);
+                return true;
+            }
+            else if(inSetClock() || CoreState::DISPLAY_TIMER == current) {
+                transition(CoreState::DISPLAY_CLOCK);
+                return true;
+            }
+            break;
+        case Signal::COOK_TIME:
+            if(CoreState::DISPLAY_CLOCK == current || CoreState::SET_POWER_LEVEL == current) {
+                transition(CoreState::SET_COOK_TIMER);
+                return true;
+            }
+            break;
+        case Signal::POWER_LEVEL:
+            if(CoreState::SET_COOK_TIMER == current) {
+                transition(CoreState::SET_POWER_LEVEL);
+                return true;
+            }
+            else if(CoreState::DISPLAY_TIMER == current && overlayArmed) {
+                overlayArmed = false;
+                overlayActive = true;
+                overlayExpiryMs = nowMs + PowerLevelOverlayMs;
+                disableDisplayTimer = true;
+                disablePowerLevel = false;
+                RenderPowerLevel(level, display);
+                return true;
+            }
+            break;
+        case Signal::KITCHEN_TIMER:
+            if(CoreState::DISPLAY_CLOCK == current) {
+                transition(CoreState::SET_KITCHEN_TIMER);
+                return true;
+            }
+            break;
+        case Signal::STOP:
+            if(inSetClock() || inSetKitchenTimer() ||
+               CoreState::SET_COOK_TIMER == current ||
+               CoreState::SET_POWER_LEVEL == current ||
+               CoreState::DISPLAY_TIMER == current) {
+                transition(CoreState::DISPLAY_CLOCK);
+                return true;
+            }
+            break;
+        case Signal::START:
+            if(CoreState::DISPLAY_CLOCK == current || inSetKitchenTimer() ||
+               CoreState::SET_COOK_TIMER == current ||
+               CoreState::SET_POWER_LEVEL == current) {
+                transition(CoreState::DISPLAY_TIMER);
+                return true;
+            }
+            break;
+        case Signal::BLINK_ON:
+        case Signal::BLINK_OFF:
+            blink(Signal::BLINK_ON == signal, nowMs);
+            return true;
+        case Signal::MOD_LEFT_TENS:
+            if(CoreState::SET_CLOCK == current || CoreState::CLOCK_SELECT_MINUTE_ONES == current) {
+                transition(CoreState::CLOCK_SELECT_HOUR_TENS);
+                return true;
+            }
+            else if(CoreState::SET_KITCHEN_TIMER == current || CoreState::KITCHEN_SELECT_SECOND_ONES == current) {
+                transition(CoreState::KITCHEN_SELECT_MINUTE_TENS);
+                return true;
+            }
+            break;
+        case Signal::MOD_LEFT_ONES:
+            if(CoreState::CLOCK_SELECT_HOUR_TENS == current) {
+                transition(CoreState::CLOCK_SELECT_HOUR_ONES);
+                return true;
+            }
+            else if(CoreState::KITCHEN_SELECT_MINUTE_TENS == current) {
+                transition(CoreState::KITCHEN_SELECT_MINUTE_ONES);
+                return true;
+            }
+            break;
+        case Signal::MOD_RIGHT_TENS:
+            if(CoreState::CLOCK_SELECT_HOUR_ONES == current) {
+                transition(CoreState::CLOCK_SELECT_MINUTE_TENS);
+                return true;
+            }
+            else if(CoreState::KITCHEN_SELECT_MINUTE_ONES == current) {
+                transition(CoreState::KITCHEN_SELECT_SECOND_TENS);
+                return true;
+            }
+            break;
+        case Signal::MOD_RIGHT_ONES:
+            if(CoreState::CLOCK_SELECT_MINUTE_TENS == current) {
+                transition(CoreState::CLOCK_SELECT_MINUTE_ONES);
+                return true;
+            }
+            else if(CoreState::KITCHEN_SELECT_SECOND_TENS == current) {
+                transition(CoreState::KITCHEN_SELECT_SECOND_ONES);
+                return true;
+            }
+            break;
+        default:
+            return true;
+        }
+        return false;
+    }
+
+    void setBlink(const bool on)
+    {
+        blinkOn = on;
+        renderBlink();
+    }
+
+    void anchorBlink(const bool on, const uint64_t nowMs)
+    {
+        blinkAnchorMs = nowMs;
+        blinkAnchorOn = on;
+        nextBlinkMs = nowMs + BlinkHalfPeriodMs;
+        setBlink(on);
+    }
+
+    // Blinks what the current state has blinking, if anything
+    void renderBlink()
+    {
+        switch(current) {
+        case CoreState::DISPLAY_CLOCK:
+            RenderBlinkGlyph(Glyph::COLON, blinkOn, time, display);
+            break;
+        case CoreState::CLOCK_SELECT_HOUR_TENS:
+        case CoreState::KITCHEN_SELECT_MINUTE_TENS:
+            RenderBlinkGlyph(Glyph::LEFT_TENS, blinkOn, time, display);
+            break;
+        case CoreState::CLOCK_SELECT_HOUR_ONES:
+        case CoreState::KITCHEN_SELECT_MINUTE_ONES:
+            RenderBlinkGlyph(Glyph::LEFT_ONES, blinkOn, time, display);
+            break;
+        case CoreState::CLOCK_SELECT_MINUTE_TENS:
+        case CoreState::KITCHEN_SELECT_SECOND_TENS:
+            RenderBlinkGlyph(Glyph::RIGHT_TENS, blinkOn, time, display);
+            break;
+        case CoreState::CLOCK_SELECT_MINUTE_ONES:
+        case CoreState::KITCHEN_SELECT_SECOND_ONES:
+            RenderBlinkGlyph(Glyph::RIGHT_ONES, blinkOn, time, display);
+            break;
+        case CoreState::SET_POWER_LEVEL:
+            RenderBlinkPowerLevel(blinkOn, level, display);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // The device's CAPABILITIES reply, the part of CoreCapabilities it
+    // enabled
+    void negotiate(const Message& msg, const uint64_t nowMs)
+    {
+        const uint8_t enabled {static_cast<uint8_t>(static_cast<uint8_t>(msg.data[0]) & CoreCapabilities)};
+        uint32_t interval {1};
+        if(enabled & CAP_TIMER_SYNC) {
+            //the device may sync more often than offered, never less
+            interval = static_cast<uint8_t>(msg.data[2]);
+            interval = interval < 1 ? 1 : interval > TimerSyncOfferS ? TimerSyncOfferS : interval;
+        }
+        syncIntervalS = interval;
+        localBlink = enabled & CAP_LOCAL_BLINK;
+        if(localBlink) {
+            //no more blink frames come, run from the lit phase
+            anchorBlink(true, nowMs);
+        }
+    }
+
+    void clearCountdown()
+    {
+        lastSyncValid = false;
+        lastSyncMs = 0;
+        lastSyncSeconds = 0;
+        anchored = false;
+        anchorMs = 0;
+        anchorSeconds = 0;
+        shownSeconds = 0;
+        countdownTime.clear();
+        tickPending = false;
+        nextTickMs = 0;
+    }
+
+    // A device timer value during a countdown. Re-anchors the local
+    // countdown and measures the device second across plain ticks, a jump
+    // (time added or entered) says nothing about it.
+    void sync(const uint32_t seconds, const uint64_t nowMs)
+    {
+        if(CoreState::DISPLAY_TIMER != current || syncIntervalS < 2) {
+            return;
+        }
+        if(lastSyncValid && seconds < lastSyncSeconds && lastSyncSeconds - seconds <= syncIntervalS &&
+           nowMs >= lastSyncMs) {
+            const uint64_t gap {(nowMs - lastSyncMs) / (lastSyncSeconds - seconds)};
+            if(gap >= CountdownMinTickMs && gap <= CountdownMaxTickMs) {
+                tickMs = static_cast<uint32_t>((3 * tickMs + gap) / 4);
+            }
+        }
+        lastSyncValid = true;
+        lastSyncMs = nowMs;
+        lastSyncSeconds = seconds;
+
+        anchored = true;
+        anchorMs = nowMs;
+        anchorSeconds = seconds;
+        shownSeconds = seconds;
+        SecondsToTime(TimeStream::DISPLAY_TIMER, seconds, countdownTime);
+        scheduleTick(nowMs);
+    }
+
+    // Ticks hold when done or out of touch, the device's done signal or
+    // next sync decides then
+    void scheduleTick(const uint64_t nowMs)
+    {
+        const uint64_t ticks {(nowMs - anchorMs) / tickMs + 1};
+        tickPending = 0 != shownSeconds && ticks <= CountdownMissedSyncs * syncIntervalS;
+        nextTickMs = tickPending ? anchorMs + ticks * tickMs : 0;
+    }
+
+    // A local countdown tick, the value is derived from the anchor so a
+    // late call never skips a second. The display follows unless overlaid.
+    void tick(const uint64_t nowMs)
+    {
+        const uint64_t ticks {(nowMs - anchorMs) / tickMs};
+        const uint32_t seconds {ticks < anchorSeconds ? anchorSeconds - static_cast<uint32_t>(ticks) : 0};
+        if(seconds != shownSeconds) {
+            shownSeconds = seconds;
+            SecondsToTime(TimeStream::DISPLAY_TIMER, seconds, countdownTime);
+            if(!disableDisplayTimer) {
+                RenderTime(countdownTime, display);
+            }
+        }
+        scheduleTick(nowMs);
+    }
+
+    void receiveTime(const Time& received, const TimeStream stream, const uint64_t nowMs)
+    {
+        if(listener) {
+            listener->timeReceived(received, stream, time);
+        }
+        else {
+            time = received;
+        }
+        const bool timer {TimeStream::DISPLAY_TIMER == stream};
+        if(timer) {
+            //re-anchor first, the display is drawn from the countdown's value
+            sync(TimeToSeconds(TimeStream::DISPLAY_TIMER, received), nowMs);
+        }
+        if(timer ? !disableDisplayTimer : !disableClockDisplay) {
+            RenderTime(displayedTime(), display);
+        }
+    }
+
+    void handleUpdate(const Message& msg, const uint64_t nowMs)
+    {
+        Time received;
+        switch(msg.update) {
+        case Update::CLOCK:
+        case Update::DISPLAY_TIMER:
+            if(!isDigits(msg.data, 4)) {
+                break;
+            }
+            received.left_tens = static_cast<uint32_t>(msg.data[0] - '0');
+            received.left_ones = static_cast<uint32_t>(msg.data[1] - '0');
+            received.right_tens = static_cast<uint32_t>(msg.data[2] - '0');
+            received.right_ones = static_cast<uint32_t>(msg.data[3] - '0');
+            receiveTime(received, Update::CLOCK == msg.update ? TimeStream::CLOCK : TimeStream::DISPLAY_TIMER, nowMs);
+            break;
+        case Update::POWER_LEVEL:
+            if(!isDigits(msg.data, 2)) {
+                break;
+            }
+            level = static_cast<uint32_t>(((msg.data[0] - '0') * 10) + (msg.data[1] - '0'));
+            if(!disablePowerLevel) {
+                RenderPowerLevel(level, display);
+            }
+            break;
+        case Update::CLOCK_SECONDS:
+        case Update::CLOCK_DELTA:
+            if(timeDecoder.apply(msg, received)) {
+                receiveTime(received, TimeStream::CLOCK, nowMs);
+            }
+            break;
+        case Update::DISPLAY_TIMER_SECONDS:
+        case Update::DISPLAY_TIMER_DELTA:
+            if(timeDecoder.apply(msg, received)) {
+                receiveTime(received, TimeStream::DISPLAY_TIMER, nowMs);
+            }
+            break;
+        case Update::NONE:
+            break;
+        }
+    }
+};
+
+// Brings core to the state it had at timeUs into the capture: loads the
+// nearest earlier snapshot and replays only the RX and LINK_RESET records
+// after it. A snapshot that does not load, truncated or from a newer build,
+// sends the replay back to the snapshot before it, down to the start of the
+// capture. The reader is left at the first record past timeUs, so replay
+// can go on from there. Returns false for an unreadable capture.
+inline bool SeekCapture(CaptureReader& reader, const CaptureIndex& index,
+                        const uint64_t timeUs, ProtocolCore& core)
+{
+    if(!reader.isValid()) {
+        return false;
+    }
+    CaptureRecord record;
+    size_t from {index.find(timeUs)};
+    for(;;) {
+        core.reset();
+        reader.seek(from);
+        if(CaptureHeaderSize == from ||
+           (reader.next(record) && CaptureKind::SNAPSHOT == record.kind &&
+            core.loadSnapshot(record.payload, record.size))) {
+            break;
+        }
+        from = index.previous(from);
+    }
+
+    Message msg;
+    uint64_t due {};
+    size_t offset {reader.tell()};
+    while(reader.next(record)) {
+        if(record.timeUs > timeUs) {
+            reader.seek(offset);
+            break;
+        }
+        offset = reader.tell();
+        if(CaptureKind::SNAPSHOT == record.kind) {
+            //the replay already holds this state, a snapshot that does not
+            // load leaves it untouched
+            core.loadSnapshot(record.payload, record.size);
+        }
+        else if(CaptureKind::LINK_RESET == record.kind ||
+                (CaptureKind::RX == record.kind && DecodeCaptureMessage(record, msg))) {
+            const uint64_t nowMs {record.timeUs / 1000};
+            while(core.nextTimeout(due) && due <= nowMs) {
+                core.advance(due);
+            }
+            if(CaptureKind::LINK_RESET == record.kind) {
+                core.linkReset();
+            }
+            else {
+                core.process(msg, nowMs);
+            }
+        }
+    }
+    core.advance(timeUs / 1000);
+    return true;
+}
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_PROTOCOL_CORE_H
@@ -0,0 +1,205 @@
+#ifndef MICROWAVE_SHM_RING_H
+#define MICROWAVE_SHM_RING_H
+
+#include "MicrowaveMessageFormat.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace MicrowaveMsgFormat {
+
+// Shared-memory transport for an app and a device (or simulator) running on
+// the same host.
+//
+// The device side owns the region: it creates a memfd sized for ShmRegion and
+// two eventfds, then hands all three to the app over a unix domain socket with
+// SendShmFds(). Each direction is a single-producer/single-consumer ring of
+// Message records kept in host byte order, so records are handed over without
+// any serialization. A producer only kicks the eventfd when the consumer may
+// have gone idle, which keeps syscalls off the hot path under load.
+
+static const uint32_t ShmMagic {0x4D73686D}; // "Mshm"
+static const uint32_t ShmVersion {1};
+static const uint32_t ShmRingCapacity {4096}; // records, power of two
+
+class ShmRing
+{
+public:
+    // Producer side: claim the next free slot, fill it in place, publish().
+    Message* claim()
+    {
+        const uint32_t h {head.load(std::memory_order_relaxed)};
+        if(h - producerTail >= ShmRingCapacity) {
+            producerTail = tail.load(std::memory_order_acquire);
+            if(h - producerTail >= ShmRingCapacity) {
+                return nullptr; //full
+            }
+        }
+        return &records[h & (ShmRingCapacity - 1)];
+    }
+
+    // Returns true when the consumer may be idle and has to be notified.
+    bool publish()
+    {
+        const uint32_t h {head.load(std::memory_order_relaxed)};
+        head.store(h + 1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return tail.load(std::memory_order_relaxed) == h;
+    }
+
+    // Consumer side: peek at the oldest record in place, then pop() it.
+    const Message* front()
+    {
+        const uint32_t t {tail.load(std::memory_order_relaxed)};
+        if(t == consumerHead) {
+            consumerHead = head.load(std::memory_order_acquire);
+            if(t == consumerHead) {
+                //pairs with the fence in publish() before reporting empty
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                consumerHead = head.load(std::memory_order_acquire);
+                if(t == consumerHead) {
+                    return nullptr; //empty
+                }
+            }
+        }
+        return &records[t & (ShmRingCapacity - 1)];
+    }
+
+    void pop()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint32_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    void clear()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        producerTail = 0;
+        consumerHead = 0;
+    }
+
+private:
+    //each side's index and its cached copy of the other side's index share a
+    // cache line, so the lines only bounce when a cached copy runs out
+    alignas(64) std::atomic<uint32_t> head;
+    uint32_t producerTail;
+    alignas(64) std::atomic<uint32_t> tail;
+    uint32_t consumerHead;
+    alignas(64) Message records[ShmRingCapacity];
+};
+
+struct ShmRegion
+{
+    uint32_t magic;
+    uint32_t version;
+    ShmRing toApp; // DEV->APP
+    ShmRing toDev; // APP->DEV
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "shared-memory rings need address-free atomics");
+
+// Indices of the descriptors passed by SendShmFds()/ReceiveShmFds()
+enum ShmFd {
+    SHM_FD_MEMORY = 0,  // memfd holding the ShmRegion
+    SHM_FD_TO_APP,      // eventfd kicked by the device
+    SHM_FD_TO_DEV,      // eventfd kicked by the app
+    SHM_FD_COUNT
+};
+
+// Device side: create and initialize the region and its eventfds.
+inline bool CreateShmRegion(int (&fds)[SHM_FD_COUNT])
+{
+    fds[SHM_FD_MEMORY] = memfd_create("microwave-shm", MFD_CLOEXEC);
+    if(-1 == fds[SHM_FD_MEMORY] || -1 == ftruncate(fds[SHM_FD_MEMORY], sizeof(ShmRegion))) {
+        return false;
+    }
+    void* addr {mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fds[SHM_FD_MEMORY], 0)};
+    if(MAP_FAILED == addr) {
+        return false;
+    }
+    ShmRegion* region {static_cast<ShmRegion*>(addr)};
+    region->toApp.clear();
+    region->toDev.clear();
+    region->version = ShmVersion;
+    region->magic = ShmMagic;
+    munmap(addr, sizeof(ShmRegion));
+
+    fds[SHM_FD_TO_APP] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    fds[SHM_FD_TO_DEV] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    return -1 != fds[SHM_FD_TO_APP] && -1 != fds[SHM_FD_TO_DEV];
+}
+
+inline bool SendShmFds(const int sock, const int (&fds)[SHM_FD_COUNT])
+{
+    char byte {'M'};
+    iovec iov {&byte, sizeof(byte)};
+    char control[CMSG_SPACE(sizeof(fds))] {};
+
+    msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg {CMSG_FIRSTHDR(&msg)};
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(byte));
+}
+
+inline bool ReceiveShmFds(const int sock, int (&fds)[SHM_FD_COUNT])
+{
+    char byte {};
+    iovec iov {&byte, sizeof(byte)};
+    char control[CMSG_SPACE(sizeof(fds))] {};
+
+    msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if(recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(byte))) {
+        return false;
+    }
+    cmsghdr* cmsg {CMSG_FIRSTHDR(&msg)};
+    if(!cmsg || SOL_SOCKET != cmsg->cmsg_level || SCM_RIGHTS != cmsg->cmsg_type ||
+       cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    return true;
+}
+
+inline void KickEventFd(const int fd)
+{
+    const uint64_t one {1};
+    const ssize_t ret {write(fd, &one, sizeof(one))};
+    (void)ret; //counter saturation just means a wakeup is already pending
+}
+
+inline void DrainEventFd(const int fd)
+{
+    uint64_t count {};
+    const ssize_t ret {read(fd, &count, sizeof(count))};
+    (void)ret;
+}
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_SHM_RING_H
@@ -0,0 +1,198 @@
+#ifndef MICROWAVE_TIME_DELTA_H
+#define MICROWAVE_TIME_DELTA_H
+
+#include "MicrowaveMessageFormat.h"
+
+#include <cstdint>
+
+namespace MicrowaveMsgFormat {
+
+// Binary clock and timer streams (CAP_BINARY_TIME).
+//
+// Instead of four ASCII digits per frame, a stream starts with a full
+// *_SECONDS update carrying the value as a big endian uint32 in data, then
+// sends *_DELTA updates whose data[0] is a signed step in seconds (-1 for a
+// countdown tick). The encoder repeats a full frame every KeyFrameInterval
+// frames so a receiver that joins late, or lost a frame, recovers.
+//
+// The clock stream carries seconds since midnight and is shown as HH:MM,
+// the timer stream carries the remaining seconds and is shown as MM:SS.
+
+static const uint32_t KeyFrameInterval {30};
+
+enum class TimeStream : uint8_t {
+    CLOCK = 0,
+    DISPLAY_TIMER,
+    COUNT
+};
+
+inline void PackSeconds(Message& msg, const uint32_t seconds)
+{
+    msg.data[0] = static_cast<char>((seconds >> 24) & 0xFF);
+    msg.data[1] = static_cast<char>((seconds >> 16) & 0xFF);
+    msg.data[2] = static_cast<char>((seconds >>  8) & 0xFF);
+    msg.data[3] = static_cast<char>( seconds        & 0xFF);
+}
+
+inline uint32_t UnpackSeconds(const Message& msg)
+{
+    const uint8_t* p {reinterpret_cast<const uint8_t*>(msg.data)};
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) <<  8) |
+            static_cast<uint32_t>(p[3]);
+}
+
+inline void SecondsToTime(const TimeStream stream, const uint32_t seconds, Time& time)
+{
+    const uint32_t left {TimeStream::CLOCK == stream ? (seconds / 3600) % 100 : (seconds / 60) % 100};
+    const uint32_t right {TimeStream::CLOCK == stream ? (seconds / 60) % 60 : seconds % 60};
+    time.left_tens = left / 10;
+    time.left_ones = left % 10;
+    time.right_tens = right / 10;
+    time.right_ones = right % 10;
+}
+
+inline uint32_t TimeToSeconds(const TimeStream stream, const Time& time)
+{
+    const uint32_t left {time.left_tens * 10 + time.left_ones};
+    const uint32_t right {time.right_tens * 10 + time.right_ones};
+    return TimeStream::CLOCK == stream ? left * 3600 + right * 60 : left * 60 + right;
+}
+
+// App side: applies full and delta frames incrementally.
+class TimeDeltaDecoder
+{
+public:
+    TimeDeltaDecoder()
+        : seconds{}
+        , valid{}
+    {
+    }
+
+    // Returns true and fills time when msg moved one of the streams.
+    // Deltas that arrive before any full frame are ignored.
+    bool apply(const Message& msg, Time& time)
+    {
+        TimeStream stream;
+        bool full;
+        switch(msg.update) {
+        case Update::CLOCK_SECONDS:
+            stream = TimeStream::CLOCK;
+            full = true;
+            break;
+        case Update::DISPLAY_TIMER_SECONDS:
+            stream = TimeStream::DISPLAY_TIMER;
+            full = true;
+            break;
+        case Update::CLOCK_DELTA:
+            stream = TimeStream::CLOCK;
+            full = false;
+            break;
+        case Update::DISPLAY_TIMER_DELTA:
+            stream = TimeStream::DISPLAY_TIMER;
+            full = false;
+            break;
+        default:
+            return false;
+        }
+
+        const size_t index {static_cast<size_t>(stream)};
+        if(full) {
+            seconds[index] = UnpackSeconds(msg);
+            valid[index] = true;
+        }
+        else if(valid[index]) {
+            const int32_t step {static_cast<int8_t>(msg.data[0])};
+            const int64_t next {static_cast<int64_t>(seconds[index]) + step};
+            seconds[index] = next > 0 ? static_cast<uint32_t>(next) : 0;
+        }
+        else {
+            return false;
+        }
+
+        SecondsToTime(stream, seconds[index], time);
+        return true;
+    }
+
+    void reset()
+    {
+        for(size_t i {0}; i < static_cast<size_t>(TimeStream::COUNT); ++i) {
+            seconds[i] = 0;
+            valid[i] = false;
+        }
+    }
+
+    // Current value of stream, false until its first full frame
+    bool value(const TimeStream stream, uint32_t& value) const
+    {
+        value = seconds[static_cast<size_t>(stream)];
+        return valid[static_cast<size_t>(stream)];
+    }
+
+    // Restores a value previously read with value()
+    void setValue(const TimeStream stream, const uint32_t value, const bool isValid)
+    {
+        seconds[static_cast<size_t>(stream)] = value;
+        valid[static_cast<size_t>(stream)] = isValid;
+    }
+
+private:
+    uint32_t seconds[static_cast<size_t>(TimeStream::COUNT)];
+    bool valid[static_cast<size_t>(TimeStream::COUNT)];
+};
+
+// Device side: turns a stream of absolute values into full and delta frames.
+class TimeDeltaEncoder
+{
+public:
+    TimeDeltaEncoder()
+        : last{}
+        , sinceKeyFrame{}
+        , started{}
+    {
+    }
+
+    // Builds the next update for stream into msg (destination and data are
+    // overwritten).
+    void encode(const TimeStream stream, const uint32_t seconds, Message& msg)
+    {
+        const size_t index {static_cast<size_t>(stream)};
+        const int64_t step {static_cast<int64_t>(seconds) - static_cast<int64_t>(last[index])};
+
+        msg.dst = Destination::APP;
+        if(!started[index] || step < INT8_MIN || step > INT8_MAX ||
+           ++sinceKeyFrame[index] >= KeyFrameInterval) {
+            msg.update = TimeStream::CLOCK == stream ? Update::CLOCK_SECONDS : Update::DISPLAY_TIMER_SECONDS;
+            PackSeconds(msg, seconds);
+            sinceKeyFrame[index] = 0;
+            started[index] = true;
+        }
+        else {
+            msg.update = TimeStream::CLOCK == stream ? Update::CLOCK_DELTA : Update::DISPLAY_TIMER_DELTA;
+            msg.data[0] = static_cast<char>(static_cast<int8_t>(step));
+            msg.data[1] = 0;
+            msg.data[2] = 0;
+            msg.data[3] = 0;
+        }
+        last[index] = seconds;
+    }
+
+    void reset()
+    {
+        for(size_t i {0}; i < static_cast<size_t>(TimeStream::COUNT); ++i) {
+            last[i] = 0;
+            sinceKeyFrame[i] = 0;
+            started[i] = false;
+        }
+    }
+
+private:
+    uint32_t last[static_cast<size_t>(TimeStream::COUNT)];
+    uint32_t sinceKeyFrame[static_cast<size_t>(TimeStream::COUNT)];
+    bool started[static_cast<size_t>(TimeStream::COUNT)];
+};
+
+} // namespace MicrowaveMsgFormat
+
+#endif // MICROWAVE_TIME_DELTA_H
@@ -0,0 +1,516 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveMessageDecoder.h"
+#include "MicrowaveCapture.h"
+#include "MicrowaveProtocolCore.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Offline analyzer for fleets of session captures.
+//
+//   Microwave_analyzer [-j workers] capture...
+//
+// Every capture is run through the frame decoder (when it holds raw link
+// bytes) and the protocol core, collecting state dwell times, invalid
+// transitions, resync events and key-to-display latencies. A latency sample
+// runs from a key sent to the first display change a device message makes
+// in answer to it; blinks, minute clock updates and countdown ticks change
+// the display on their own and do not end a sample. A key that gets no
+// answer before the next one is sent, or before the capture ends, is
+// counted as unanswered. Captures are sharded across worker threads that
+// steal from each other once their own share runs out; each worker keeps
+// its own statistics, which are summed after the workers have been joined.
+
+namespace {
+
+using namespace MicrowaveMsgFormat;
+
+// Bucket i counts latencies below 2^i microseconds, the last one the rest
+const size_t LATENCY_BUCKETS {26};
+
+const char* const STATE_NAMES[CoreStateCount] {
+    "InitialState",
+    "DisplayClock",
+    "SetClock",
+    "ClockSelectHourTens",
+    "ClockSelectHourOnes",
+    "ClockSelectMinuteTens",
+    "ClockSelectMinuteOnes",
+    "SetCookTimer",
+    "SetPowerLevel",
+    "SetKitchenTimer",
+    "KitchenSelectMinuteTens",
+    "KitchenSelectMinuteOnes",
+    "KitchenSelectSecondTens",
+    "KitchenSelectSecondOnes",
+    "DisplayTimer",
+};
+
+//one per worker, aligned so workers never share a cache line
+struct alignas(64) Stats
+{
+    uint64_t sessions;
+    uint64_t unreadable;
+    uint64_t messages;
+    uint64_t dwellUs[CoreStateCount];
+    uint64_t entries[CoreStateCount];
+    uint64_t invalidTransitions;
+    uint64_t resyncs;
+    uint64_t bytesDiscarded;
+    uint64_t rejectedHeaders;
+    uint64_t latencies;
+    uint64_t latencySumUs;
+    uint64_t latencyMaxUs;
+    uint64_t latencyBuckets[LATENCY_BUCKETS];
+    uint64_t unansweredKeys;
+
+    void merge(const Stats& other)
+    {
+        sessions += other.sessions;
+        unreadable += other.unreadable;
+        messages += other.messages;
+        for(size_t i {0}; i < CoreStateCount; ++i) {
+            dwellUs[i] += other.dwellUs[i];
+            entries[i] += other.entries[i];
+        }
+        invalidTransitions += other.invalidTransitions;
+        resyncs += other.resyncs;
+        bytesDiscarded += other.bytesDiscarded;
+        rejectedHeaders += other.rejectedHeaders;
+        latencies += other.latencies;
+        latencySumUs += other.latencySumUs;
+        if(other.latencyMaxUs > latencyMaxUs) {
+            latencyMaxUs = other.latencyMaxUs;
+        }
+        for(size_t i {0}; i < LATENCY_BUCKETS; ++i) {
+            latencyBuckets[i] += other.latencyBuckets[i];
+        }
+        unansweredKeys += other.unansweredKeys;
+    }
+};
+
+bool isKey(const Signal signal)
+{
+    switch(signal) {
+    case Signal::CLOCK:
+    case Signal::COOK_TIME:
+    case Signal::POWER_LEVEL:
+    case Signal::KITCHEN_TIMER:
+    case Signal::STOP:
+    case Signal::START:
+        return true;
+    default:
+        return signal >= Signal::DIGIT_0 && signal <= Signal::DIGIT_9;
+    }
+}
+
+bool isClockUpdate(const Update update)
+{
+    return Update::CLOCK == update || Update::CLOCK_SECONDS == update || Update::CLOCK_DELTA == update;
+}
+
+bool isTimerUpdate(const Update update)
+{
+    return Update::DISPLAY_TIMER == update || Update::DISPLAY_TIMER_SECONDS == update ||
+           Update::DISPLAY_TIMER_DELTA == update;
+}
+
+// Whether a display change msg made in state before can answer a key
+bool answersKey(const Message& msg, const CoreState before)
+{
+    switch(static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
+    case Type::SIGNAL:
+        return Signal::BLINK_ON != msg.signal && Signal::BLINK_OFF != msg.signal;
+    case Type::UPDATE:
+        //the minute clock and the countdown tick whatever was pressed, while
+        // editing the same updates echo the digits
+        if(CoreState::DISPLAY_CLOCK == before && isClockUpdate(msg.update)) {
+            return false;
+        }
+        return !(CoreState::DISPLAY_TIMER == before && isTimerUpdate(msg.update));
+    default:
+        return true;
+    }
+}
+
+// Read-only mapping of one capture file
+class MappedFile
+{
+public:
+    explicit MappedFile(const char* path)
+        : data{nullptr}
+        , size{0}
+    {
+        const int fd {open(path, O_RDONLY | O_CLOEXEC)};
+        if(-1 == fd) {
+            return;
+        }
+        struct stat st {};
+        if(0 == fstat(fd, &st) && st.st_size > 0) {
+            void* addr {mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0)};
+            if(MAP_FAILED != addr) {
+                data = static_cast<const char*>(addr);
+                size = static_cast<size_t>(st.st_size);
+                madvise(addr, size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if(data) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data;
+    size_t size;
+};
+
+// Replays one capture into stats
+class SessionAnalyzer
+{
+public:
+    explicit SessionAnalyzer(Stats& stats)
+        : stats{stats}
+        , decoder{Destination::APP}
+        , state{CoreState::INITIAL}
+        , enteredUs{0}
+        , lastUs{0}
+        , keyPending{false}
+        , keyUs{0}
+    {
+    }
+
+    void run(const char* data, const size_t size)
+    {
+        CaptureReader reader(data, size);
+        if(!reader.isValid()) {
+            ++stats.unreadable;
+            return;
+        }
+
+        //raw link bytes, when recorded, go through the decoder and replace
+        // the already decoded RX records
+        CaptureRecord record;
+        bool raw {false};
+        while(!raw && reader.next(record)) {
+            raw = CaptureKind::RX_RAW == record.kind;
+        }
+        reader.seek(0);
+
+        ++stats.sessions;
+        ++stats.entries[static_cast<size_t>(state)];
+
+        Message msg;
+        while(reader.next(record)) {
+            lastUs = record.timeUs;
+            switch(record.kind) {
+            case CaptureKind::RX:
+                if(!raw && DecodeCaptureMessage(record, msg)) {
+                    feed(msg, record.timeUs);
+                }
+                break;
+            case CaptureKind::RX_RAW:
+                decoder.append(record.payload, record.size);
+                while(decoder.next(msg)) {
+                    feed(msg, record.timeUs);
+                    //same switch-over as negotiateCapabilities()
+                    if(Signal::CAPABILITIES == msg.signal && (msg.data[0] & CAP_FRAMING_V2) &&
+                       static_cast<uint8_t>(msg.data[1]) >= 2) {
+                        decoder.setFramingV2(true);
+                    }
+                }
+                break;
+            case CaptureKind::LINK_RESET:
+                //a new connection starts over on v1 framing
+                decoder.reset();
+                drain(record.timeUs);
+                core.linkReset();
+                break;
+            case CaptureKind::TX:
+                if(DecodeCaptureMessage(record, msg) && isKey(msg.signal)) {
+                    if(keyPending) {
+                        ++stats.unansweredKeys;
+                    }
+                    keyPending = true;
+                    keyUs = record.timeUs;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        if(keyPending) {
+            ++stats.unansweredKeys;
+        }
+        stats.dwellUs[static_cast<size_t>(state)] += lastUs - enteredUs;
+        stats.invalidTransitions += core.invalidTransitions();
+        const MessageDecoder::Stats& link {decoder.stats()};
+        stats.resyncs += link.resyncs;
+        stats.bytesDiscarded += link.bytesDiscarded;
+        stats.rejectedHeaders += link.rejectedHeaders;
+    }
+
+private:
+    Stats& stats;
+    ProtocolCore core;
+    MessageDecoder decoder;
+    CoreState state;
+    uint64_t enteredUs;
+    uint64_t lastUs;
+    bool keyPending;
+    uint64_t keyUs;
+
+    void feed(const Message& msg, const uint64_t timeUs)
+    {
+        ++stats.messages;
+        drain(timeUs);
+        const CoreState before {core.state()};
+        if(core.process(msg, timeUs / 1000) && answersKey(msg, before)) {
+            keyAnswered(timeUs);
+        }
+        if(core.state() != state) {
+            stats.dwellUs[static_cast<size_t>(state)] += timeUs - enteredUs;
+            state = core.state();
+            ++stats.entries[static_cast<size_t>(state)];
+            enteredUs = timeUs;
+        }
+    }
+
+    //timeouts are the app's own, a change they make answers no key
+    void drain(const uint64_t timeUs)
+    {
+        uint64_t dueMs {};
+        while(core.nextTimeout(dueMs) && dueMs * 1000 <= timeUs) {
+            core.advance(dueMs);
+        }
+    }
+
+    void keyAnswered(const uint64_t timeUs)
+    {
+        if(!keyPending) {
+            return;
+        }
+        keyPending = false;
+        const uint64_t latency {timeUs > keyUs ? timeUs - keyUs : 0};
+        size_t bucket {0};
+        while(bucket < LATENCY_BUCKETS - 1 && latency >= (uint64_t{1} << bucket)) {
+            ++bucket;
+        }
+        ++stats.latencyBuckets[bucket];
+        ++stats.latencies;
+        stats.latencySumUs += latency;
+        if(latency > stats.latencyMaxUs) {
+            stats.latencyMaxUs = latency;
+        }
+    }
+};
+
+// Range of capture indices owned by one worker, packed as begin/end halves
+// of one atomic so the owner (taking from the front) and thieves (taking
+// the back half) agree through a single compare-and-swap.
+class alignas(64) WorkRange
+{
+public:
+    WorkRange()
+        : range{0}
+    {
+    }
+
+    void assign(const uint32_t begin, const uint32_t end)
+    {
+        range.store(pack(begin, end), std::memory_order_release);
+    }
+
+    bool take(uint32_t& index)
+    {
+        uint64_t current {range.load(std::memory_order_acquire)};
+        while(begin(current) < end(current)) {
+            if(range.compare_exchange_weak(current, pack(begin(current) + 1, end(current)),
+                                           std::memory_order_acq_rel)) {
+                index = begin(current);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves the back half of this range into thief, which must be empty
+    bool stealInto(WorkRange& thief)
+    {
+        uint64_t current {range.load(std::memory_order_acquire)};
+        while(begin(current) < end(current)) {
+            const uint32_t count {end(current) - begin(current)};
+            const uint32_t split {end(current) - (count + 1) / 2};
+            if(range.compare_exchange_weak(current, pack(begin(current), split),
+                                           std::memory_order_acq_rel)) {
+                thief.assign(split, end(current));
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::atomic<uint64_t> range;
+
+    static uint64_t pack(const uint32_t begin, const uint32_t end)
+    {
+        return (static_cast<uint64_t>(begin) << 32) | end;
+    }
+    static uint32_t begin(const uint64_t value)
+    {
+        return static_cast<uint32_t>(value >> 32);
+    }
+    static uint32_t end(const uint64_t value)
+    {
+        return static_cast<uint32_t>(value);
+    }
+};
+
+void worker(const size_t self, const std::vector<const char*>& captures,
+            std::vector<WorkRange>& ranges, Stats& stats)
+{
+    const size_t workers {ranges.size()};
+    uint32_t index {};
+    for(;;) {
+        while(ranges[self].take(index)) {
+            MappedFile file(captures[index]);
+            if(!file.data) {
+                ++stats.unreadable;
+                continue;
+            }
+            SessionAnalyzer(stats).run(file.data, file.size);
+        }
+
+        bool stolen {false};
+        for(size_t i {1}; i < workers && !stolen; ++i) {
+            stolen = ranges[(self + i) % workers].stealInto(ranges[self]);
+        }
+        if(!stolen) {
+            return;
+        }
+    }
+}
+
+// Upper bound of the bucket holding the given percentile
+double percentileMs(const Stats& stats, const double percentile)
+{
+    const uint64_t rank {static_cast<uint64_t>(percentile * static_cast<double>(stats.latencies))};
+    uint64_t seen {0};
+    for(size_t i {0}; i < LATENCY_BUCKETS; ++i) {
+        seen += stats.latencyBuckets[i];
+        if(seen > rank) {
+            return static_cast<double>(uint64_t{1} << i) / 1000.0;
+        }
+    }
+    return static_cast<double>(stats.latencyMaxUs) / 1000.0;
+}
+
+void report(const Stats& stats, const size_t workers, const double seconds)
+{
+    printf("%" PRIu64 " sessions (%" PRIu64 " unreadable), %" PRIu64 " messages, "
+           "%zu workers, %.2f s, %.0f sessions/s\n",
+           stats.sessions, stats.unreadable, stats.messages, workers, seconds,
+           seconds > 0 ? static_cast<double>(stats.sessions) / seconds : 0.0);
+
+    uint64_t totalUs {0};
+    for(size_t i {0}; i < CoreStateCount; ++i) {
+        totalUs += stats.dwellUs[i];
+    }
+    printf("\n%-26s %10s %14s %7s\n", "state", "entries", "dwell s", "share");
+    for(size_t i {0}; i < CoreStateCount; ++i) {
+        printf("%-26s %10" PRIu64 " %14.1f %6.2f%%\n", STATE_NAMES[i], stats.entries[i],
+               static_cast<double>(stats.dwellUs[i]) / 1e6,
+               totalUs ? 100.0 * static_cast<double>(stats.dwellUs[i]) / static_cast<double>(totalUs) : 0.0);
+    }
+
+    printf("\ninvalid transitions: %" PRIu64 "\n", stats.invalidTransitions);
+    printf("link: %" PRIu64 " resyncs, %" PRIu64 " bytes discarded, %" PRIu64 " headers rejected\n",
+           stats.resyncs, stats.bytesDiscarded, stats.rejectedHeaders);
+
+    if(0 == stats.latencies) {
+        printf("key-to-display latency: no samples, %" PRIu64 " keys unanswered\n", stats.unansweredKeys);
+        return;
+    }
+    printf("key-to-display latency: %" PRIu64 " samples, mean %.2f ms, "
+           "p50 < %.3f ms, p90 < %.3f ms, p99 < %.3f ms, max %.2f ms, %" PRIu64 " keys unanswered\n",
+           stats.latencies,
+           static_cast<double>(stats.latencySumUs) / static_cast<double>(stats.latencies) / 1000.0,
+           percentileMs(stats, 0.50), percentileMs(stats, 0.90), percentileMs(stats, 0.99),
+           static_cast<double>(stats.latencyMaxUs) / 1000.0, stats.unansweredKeys);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    size_t workers {std::thread::hardware_concurrency()};
+    std::vector<const char*> captures;
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "-j") && i + 1 < argc) {
+            workers = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            captures.push_back(argv[i]);
+        }
+    }
+    if(captures.empty() || captures.size() > UINT32_MAX) {
+        fprintf(stderr, "usage: %s [-j workers] capture...\n", argv[0]);
+        return 2;
+    }
+    if(0 == workers) {
+        workers = 1;
+    }
+    if(workers > captures.size()) {
+        workers = captures.size();
+    }
+
+    const auto start {std::chrono::steady_clock::now()};
+
+    //contiguous shares keep each worker on neighbouring files until it steals
+    std::vector<WorkRange> ranges(workers);
+    std::vector<Stats> stats(workers, Stats{});
+    const size_t share {captures.size() / workers};
+    for(size_t i {0}; i < workers; ++i) {
+        const size_t begin {i * share};
+        const size_t end {i + 1 == workers ? captures.size() : begin + share};
+        ranges[i].assign(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+    }
+
+    std::vector<std::thread> threads;
+    for(size_t i {1}; i < workers; ++i) {
+        threads.emplace_back(worker, i, std::cref(captures), std::ref(ranges), std::ref(stats[i]));
+    }
+    worker(0, captures, ranges, stats[0]);
+    for(std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Stats total {};
+    for(const Stats& s : stats) {
+        total.merge(s);
+    }
+
+    const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    report(total, workers, seconds);
+    return 0;
+}
@@ -2,7 +2,10 @@ QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets network
 
-CONFIG += c++11
+CONFIG += c++2a
+
+# C++20 coroutines (DeviceSession)
+gcc:!clang: QMAKE_CXXFLAGS += -fcoroutines
 
 # The following define makes your compiler emit warnings if you use
 # any Qt feature that has been marked deprecated (the exact warnings
@@ -16,12 +19,44 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    blinkengine.cpp \
+    capturewriter.cpp \
+    devicesession.cpp \
+    digitpredictor.cpp \
     main.cpp \
-    microwave.cpp
+    microwave.cpp \
+    shmtransport.cpp \
+    startupprofiler.cpp \
+    statecache.cpp \
+    tcptransport.cpp \
+    timerservice.cpp \
+    timingwheel.cpp \
+    transport.cpp \
+    txscheduler.cpp
 
 HEADERS += \
+    blinkengine.h \
+    capturewriter.h \
+    devicesession.h \
+    digitpredictor.h \
     microwave.h \
-    ../MicrowaveMessageFormat.h
+    shmtransport.h \
+    startupprofiler.h \
+    statecache.h \
+    tcptransport.h \
+    timerservice.h \
+    timingwheel.h \
+    transport.h \
+    txscheduler.h \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveMessageDecoder.h \
+    ../MicrowaveFramingV2.h \
+    ../MicrowaveShmRing.h \
+    ../MicrowaveTimeDelta.h \
+    ../MicrowaveDisplay.h \
+    ../MicrowaveCapture.h \
+    ../MicrowaveProtocolCore.h \
+    ../MicrowavePerfCounters.h
 
 FORMS += \
     microwave.ui
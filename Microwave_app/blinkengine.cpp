@@ -0,0 +1,149 @@
+#include "blinkengine.h"
+#include "timerservice.h"
+
+#include <QDebug>
+
+namespace {
+
+const int DEFAULT_HALF_PERIOD_MS {500};
+const int MIN_HALF_PERIOD_MS {100};
+const int MAX_HALF_PERIOD_MS {2000};
+//device edges further than this from a local edge count as drift
+const int DRIFT_BOUND_MS {120};
+const int MAX_DRIFT_FAULTS {3};
+//half periods without a device frame before blinking is considered over
+const int SILENCE_HALF_PERIODS {3};
+
+}
+
+BlinkEngine::BlinkEngine(QObject *parent)
+    : QObject(parent)
+    , mode{Mode::IDLE}
+    , output{true}
+    , anchorMs{0}
+    , anchorPhase{true}
+    , lastDeviceMs{-1}
+    , halfPeriodMs{DEFAULT_HALF_PERIOD_MS}
+    , driftFaults{0}
+    , deviceFrameCount{0}
+    , localEdgeCount{0}
+    , toggleTimer{}
+    , silenceTimer{}
+{
+}
+
+void BlinkEngine::onDeviceBlink(const bool on)
+{
+    TimerService* timers {TimerService::instance()};
+    const qint64 now {timers->elapsed()};
+    ++deviceFrameCount;
+
+    //track the device cadence from consecutive frames
+    if(lastDeviceMs >= 0) {
+        const qint64 gap {now - lastDeviceMs};
+        if(gap > 0 && gap < 4 * halfPeriodMs) {
+            halfPeriodMs = qBound(MIN_HALF_PERIOD_MS, static_cast<int>((3 * halfPeriodMs + gap) / 4), MAX_HALF_PERIOD_MS);
+        }
+    }
+    lastDeviceMs = now;
+
+    timers->start(silenceTimer, SILENCE_HALF_PERIODS * halfPeriodMs, [this]() {
+        onSilence();
+    });
+
+    switch(mode) {
+    case Mode::IDLE:
+        mode = Mode::LOCKED;
+        driftFaults = 0;
+        anchor(now, on);
+        break;
+    case Mode::LOCKED: {
+        //distance to the nearest local edge and the phase it produced
+        const qint64 since {now - anchorMs};
+        const qint64 edges {(since + halfPeriodMs / 2) / halfPeriodMs};
+        const qint64 drift {qAbs(since - edges * halfPeriodMs)};
+        const bool predicted {(0 == (edges & 1)) ? anchorPhase : !anchorPhase};
+
+        driftFaults = (drift > DRIFT_BOUND_MS || predicted != on) ? driftFaults + 1 : 0;
+        if(driftFaults > MAX_DRIFT_FAULTS) {
+            qDebug() << "blink drift exceeded" << DRIFT_BOUND_MS << "ms, following device frames";
+            mode = Mode::FOLLOW;
+            timers->stop(toggleTimer);
+            setOutput(on);
+            break;
+        }
+        anchor(now, on);
+        break;
+    }
+    case Mode::FOLLOW:
+        setOutput(on);
+        break;
+    }
+}
+
+void BlinkEngine::stop()
+{
+    TimerService::instance()->stop(toggleTimer);
+    TimerService::instance()->stop(silenceTimer);
+    mode = Mode::IDLE;
+    lastDeviceMs = -1;
+    //never leave a blinking digit blanked
+    setOutput(true);
+}
+
+bool BlinkEngine::isFreeRunning() const
+{
+    return Mode::LOCKED == mode;
+}
+
+quint64 BlinkEngine::deviceFrames() const
+{
+    return deviceFrameCount;
+}
+
+quint64 BlinkEngine::localEdges() const
+{
+    return localEdgeCount;
+}
+
+void BlinkEngine::setOutput(const bool on)
+{
+    if(output != on) {
+        output = on;
+        emit blink(on);
+    }
+}
+
+void BlinkEngine::anchor(const qint64 nowMs, const bool phase)
+{
+    anchorMs = nowMs;
+    anchorPhase = phase;
+    setOutput(phase);
+    scheduleToggle();
+}
+
+void BlinkEngine::scheduleToggle()
+{
+    //edges are placed relative to the anchor so timer latency never accumulates
+    TimerService* timers {TimerService::instance()};
+    const qint64 now {timers->elapsed()};
+    const qint64 edges {(now - anchorMs) / halfPeriodMs + 1};
+    const qint64 due {anchorMs + edges * halfPeriodMs};
+    timers->start(toggleTimer, static_cast<int>(due - now), [this]() {
+        onToggle();
+    });
+}
+
+void BlinkEngine::onToggle()
+{
+    //derive the phase from the anchor, a late wakeup must not invert it
+    const qint64 edges {(TimerService::instance()->elapsed() - anchorMs) / halfPeriodMs};
+    ++localEdgeCount;
+    setOutput((0 == (edges & 1)) ? anchorPhase : !anchorPhase);
+    scheduleToggle();
+}
+
+void BlinkEngine::onSilence()
+{
+    stop();
+}
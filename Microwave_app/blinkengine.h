@@ -0,0 +1,62 @@
+#ifndef BLINKENGINE_H
+#define BLINKENGINE_H
+
+#include "timingwheel.h"
+
+#include <QObject>
+
+// App-side generator for the blink phase.
+//
+// The first BLINK_ON/BLINK_OFF from the device starts a free-running local
+// clock, later device frames only re-anchor its phase. If the device edges
+// drift from the local ones beyond a bound, the engine falls back to
+// following the device frames one by one. Once the device has agreed to
+// CAP_LOCAL_BLINK it stops sending blinks, the ProtocolCore then generates
+// the phase itself and the engine stays idle.
+class BlinkEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BlinkEngine(QObject *parent = nullptr);
+
+    void onDeviceBlink(const bool on);
+
+    void stop();
+
+    bool isFreeRunning() const;
+
+    quint64 deviceFrames() const;
+    quint64 localEdges() const;
+
+signals:
+    void blink(bool on);
+
+private:
+    enum class Mode {
+        IDLE,       // no blinking
+        LOCKED,     // free-running, phase-locked to device frames
+        FOLLOW      // drifted too far, device frames drive the output
+    };
+
+    Mode mode;
+    bool output;
+    qint64 anchorMs;
+    bool anchorPhase;
+    qint64 lastDeviceMs;
+    int halfPeriodMs;
+    int driftFaults;
+    quint64 deviceFrameCount;
+    quint64 localEdgeCount;
+
+    TimingWheel::Timer toggleTimer;
+    TimingWheel::Timer silenceTimer;
+
+    void setOutput(const bool on);
+    void anchor(const qint64 nowMs, const bool phase);
+    void scheduleToggle();
+    void onToggle();
+    void onSilence();
+};
+
+#endif // BLINKENGINE_H
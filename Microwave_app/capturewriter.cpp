@@ -0,0 +1,127 @@
+#include "capturewriter.h"
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveCapture.h"
+#include "MicrowaveProtocolCore.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QScopedPointer>
+
+namespace {
+
+//path of the capture file to record this session to
+const char* const CAPTURE_ENV {"MICROWAVE_CAPTURE"};
+
+}
+
+CaptureWriter::CaptureWriter(const QString &path)
+    : file{new QFile(path)}
+    , clock{}
+    , core{new MicrowaveMsgFormat::ProtocolCore}
+    , lastSnapshotUs{0}
+{
+    if(!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "capture unavailable:" << file->errorString();
+        return;
+    }
+    char header[MicrowaveMsgFormat::CaptureHeaderSize];
+    file->write(header, static_cast<qint64>(MicrowaveMsgFormat::EncodeCaptureHeader(header)));
+    clock.start();
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    delete file;
+    delete core;
+}
+
+CaptureWriter* CaptureWriter::instance()
+{
+    //closed, and so flushed, at exit
+    static QScopedPointer<CaptureWriter> writer {qEnvironmentVariableIsSet(CAPTURE_ENV) ?
+                                                 new CaptureWriter(qEnvironmentVariable(CAPTURE_ENV)) :
+                                                 Q_NULLPTR};
+    return writer.data();
+}
+
+bool CaptureWriter::isOpen() const
+{
+    return file->isOpen();
+}
+
+void CaptureWriter::writeRx(const MicrowaveMsgFormat::Message &msg)
+{
+    write(true, msg);
+}
+
+void CaptureWriter::writeTx(const MicrowaveMsgFormat::Message &msg)
+{
+    write(false, msg);
+}
+
+void CaptureWriter::write(const bool rx, const MicrowaveMsgFormat::Message &msg)
+{
+    using namespace MicrowaveMsgFormat;
+
+    if(!file->isOpen()) {
+        return;
+    }
+    const quint64 now {timestamp()};
+    if(rx && now - lastSnapshotUs >= CaptureSnapshotIntervalUs) {
+        writeSnapshot(now);
+    }
+    char record[CaptureRecordHeaderSize + WireMessageSize];
+    const size_t size {EncodeCaptureMessage(rx ? CaptureKind::RX : CaptureKind::TX, now, msg, record)};
+    file->write(record, static_cast<qint64>(size));
+    if(rx) {
+        core->process(msg, now / 1000);
+    }
+}
+
+void CaptureWriter::writeSnapshot(const quint64 now)
+{
+    using namespace MicrowaveMsgFormat;
+
+    char snapshot[CoreSnapshotSize];
+    char record[CaptureRecordHeaderSize + CoreSnapshotSize];
+    const uint8_t size {static_cast<uint8_t>(core->saveSnapshot(snapshot))};
+    file->write(record, static_cast<qint64>(EncodeCaptureRecord(CaptureKind::SNAPSHOT, now, snapshot, size, record)));
+    lastSnapshotUs = now;
+}
+
+void CaptureWriter::writeRaw(const char *data, qint64 size)
+{
+    using namespace MicrowaveMsgFormat;
+
+    if(!file->isOpen()) {
+        return;
+    }
+    const quint64 now {timestamp()};
+    char record[CaptureMaxRecordSize];
+    while(size > 0) {
+        const uint8_t chunk {static_cast<uint8_t>(qMin<qint64>(size, 0xFF))};
+        file->write(record, static_cast<qint64>(EncodeCaptureRecord(CaptureKind::RX_RAW, now, data, chunk, record)));
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+void CaptureWriter::writeLinkReset()
+{
+    using namespace MicrowaveMsgFormat;
+
+    if(!file->isOpen()) {
+        return;
+    }
+    const quint64 now {timestamp()};
+    char record[CaptureRecordHeaderSize];
+    file->write(record, static_cast<qint64>(EncodeCaptureRecord(CaptureKind::LINK_RESET, now, "", 0, record)));
+    //the countdown holds at what it showed when the link went
+    core->advance(now / 1000);
+    core->linkReset();
+}
+
+quint64 CaptureWriter::timestamp() const
+{
+    return static_cast<quint64>(clock.nsecsElapsed() / 1000);
+}
@@ -0,0 +1,49 @@
+#ifndef CAPTUREWRITER_H
+#define CAPTUREWRITER_H
+
+#include <QElapsedTimer>
+#include <QString>
+
+class QFile;
+
+namespace MicrowaveMsgFormat {
+class Message;
+class ProtocolCore;
+}
+
+// Records the messages of a session to a capture file (MicrowaveCapture.h)
+// for offline replay. Writes are buffered by QFile and flushed on close.
+// Received messages and link drops also drive a ProtocolCore whose state
+// is written out as a snapshot every CaptureSnapshotIntervalUs, for
+// seeking.
+class CaptureWriter
+{
+public:
+    explicit CaptureWriter(const QString& path);
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    //the capture configured for this process, Q_NULLPTR when none is
+    static CaptureWriter* instance();
+
+    bool isOpen() const;
+
+    void writeRx(const MicrowaveMsgFormat::Message& msg);
+    void writeTx(const MicrowaveMsgFormat::Message& msg);
+    void writeRaw(const char* data, const qint64 size);
+    void writeLinkReset();
+
+private:
+    QFile* file;
+    QElapsedTimer clock;
+    MicrowaveMsgFormat::ProtocolCore* core;
+    quint64 lastSnapshotUs;
+
+    quint64 timestamp() const;
+    void writeSnapshot(const quint64 now);
+    void write(const bool rx, const MicrowaveMsgFormat::Message& msg);
+};
+
+#endif // CAPTUREWRITER_H
@@ -0,0 +1,196 @@
+#include "devicesession.h"
+#include "timerservice.h"
+#include "txscheduler.h"
+
+#include <cstring>
+
+DeviceSession::Awaiter::Awaiter(DeviceSession* session, const Match match, const MicrowaveMsgFormat::Type type,
+                                const uint32_t value, const int timeoutMs,
+                                const MicrowaveMsgFormat::Message* txMessage)
+    : session{session}
+    , match{match}
+    , type{type}
+    , value{value}
+    , timeoutMs{timeoutMs}
+    , transmit{nullptr != txMessage}
+    , txMessage{txMessage ? *txMessage : MicrowaveMsgFormat::Message{}}
+    , result{}
+    , handle{}
+    , timer{}
+    , prev{nullptr}
+    , next{nullptr}
+{
+}
+
+DeviceSession::Awaiter::~Awaiter()
+{
+    if(handle) {
+        session->unlink(*this);
+    }
+}
+
+void DeviceSession::Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    this->handle = handle;
+    session->link(*this);
+    if(timeoutMs >= 0) {
+        TimerService::instance()->start(timer, timeoutMs, [this]() {
+            std::coroutine_handle<> resume {this->handle};
+            session->unlink(*this);
+            this->handle = nullptr;
+            resume.resume();
+        });
+    }
+    if(transmit) {
+        session->scheduler->send(txMessage);
+    }
+}
+
+bool DeviceSession::Awaiter::matches(const MicrowaveMsgFormat::Message& msg) const
+{
+    using namespace MicrowaveMsgFormat;
+    const uint32_t rxValue {static_cast<uint32_t>(msg.state)};
+    switch(match) {
+    case Match::TYPE:
+        return static_cast<Type>(rxValue >> 24) == type;
+    case Match::VALUE:
+        return rxValue == value;
+    case Match::NOTHING:
+        break;
+    }
+    return false;
+}
+
+DeviceSession::DeviceSession(TxScheduler* scheduler, QObject *parent)
+    : QObject(parent)
+    , scheduler{scheduler}
+    , waiters{nullptr}
+    , waiterCount{0}
+{
+}
+
+DeviceSession::~DeviceSession()
+{
+    //flows still waiting on this session can never complete, drop them
+    while(waiters) {
+        Awaiter& awaiter {*waiters};
+        std::coroutine_handle<> handle {awaiter.handle};
+        unlink(awaiter);
+        awaiter.handle = nullptr;
+        TimerService::instance()->stop(awaiter.timer);
+        handle.destroy();
+    }
+}
+
+DeviceSession::Awaiter DeviceSession::request(const MicrowaveMsgFormat::Signal signal, const int timeoutMs)
+{
+    using namespace MicrowaveMsgFormat;
+    Message msg;
+    msg.dst = Destination::DEV;
+    msg.signal = signal;
+    memset(msg.data, 0, sizeof(msg.data));
+    return request(msg, timeoutMs);
+}
+
+DeviceSession::Awaiter DeviceSession::request(const MicrowaveMsgFormat::Message& msg, const int timeoutMs)
+{
+    using namespace MicrowaveMsgFormat;
+    const bool stateRequest {Signal::STATE_REQUEST == msg.signal};
+    return Awaiter{this,
+                   stateRequest ? Awaiter::Match::TYPE : Awaiter::Match::VALUE,
+                   stateRequest ? Type::STATE : Type::SIGNAL,
+                   static_cast<uint32_t>(msg.signal),
+                   timeoutMs,
+                   &msg};
+}
+
+DeviceSession::Awaiter DeviceSession::waitFor(const MicrowaveMsgFormat::State state, const int timeoutMs)
+{
+    return Awaiter{this, Awaiter::Match::VALUE, MicrowaveMsgFormat::Type::STATE, static_cast<uint32_t>(state), timeoutMs};
+}
+
+DeviceSession::Awaiter DeviceSession::waitFor(const MicrowaveMsgFormat::Signal signal, const int timeoutMs)
+{
+    return Awaiter{this, Awaiter::Match::VALUE, MicrowaveMsgFormat::Type::SIGNAL, static_cast<uint32_t>(signal), timeoutMs};
+}
+
+DeviceSession::Awaiter DeviceSession::waitFor(const MicrowaveMsgFormat::Update update, const int timeoutMs)
+{
+    return Awaiter{this, Awaiter::Match::VALUE, MicrowaveMsgFormat::Type::UPDATE, static_cast<uint32_t>(update), timeoutMs};
+}
+
+DeviceSession::Awaiter DeviceSession::delay(const int ms)
+{
+    return Awaiter{this, Awaiter::Match::NOTHING, MicrowaveMsgFormat::Type::STATE, 0, ms};
+}
+
+void DeviceSession::dispatch(const MicrowaveMsgFormat::Message& msg)
+{
+    //collect first, resumed flows are free to await again on this session
+    Awaiter* ready {nullptr};
+    for(Awaiter* awaiter {waiters}; awaiter;) {
+        Awaiter* following {awaiter->next};
+        if(awaiter->matches(msg)) {
+            unlink(*awaiter);
+            TimerService::instance()->stop(awaiter->timer);
+            awaiter->result = msg;
+            awaiter->next = ready;
+            ready = awaiter;
+        }
+        awaiter = following;
+    }
+
+    while(ready) {
+        Awaiter* awaiter {ready};
+        ready = awaiter->next;
+        awaiter->next = nullptr;
+        std::coroutine_handle<> handle {awaiter->handle};
+        awaiter->handle = nullptr;
+        handle.resume();
+    }
+}
+
+void DeviceSession::send(const MicrowaveMsgFormat::Signal signal)
+{
+    using namespace MicrowaveMsgFormat;
+    Message msg;
+    msg.dst = Destination::DEV;
+    msg.signal = signal;
+    memset(msg.data, 0, sizeof(msg.data));
+    scheduler->send(msg);
+}
+
+int DeviceSession::pending() const
+{
+    return waiterCount;
+}
+
+void DeviceSession::link(Awaiter& awaiter)
+{
+    awaiter.prev = nullptr;
+    awaiter.next = waiters;
+    if(waiters) {
+        waiters->prev = &awaiter;
+    }
+    waiters = &awaiter;
+    ++waiterCount;
+}
+
+void DeviceSession::unlink(Awaiter& awaiter)
+{
+    if(awaiter.prev) {
+        awaiter.prev->next = awaiter.next;
+    }
+    else if(waiters == &awaiter) {
+        waiters = awaiter.next;
+    }
+    else {
+        return; //not linked
+    }
+    if(awaiter.next) {
+        awaiter.next->prev = awaiter.prev;
+    }
+    awaiter.prev = nullptr;
+    awaiter.next = nullptr;
+    --waiterCount;
+}
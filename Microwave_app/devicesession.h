@@ -0,0 +1,115 @@
+#ifndef DEVICESESSION_H
+#define DEVICESESSION_H
+
+#include "MicrowaveMessageFormat.h"
+#include "timingwheel.h"
+
+#include <QObject>
+
+#include <coroutine>
+#include <optional>
+
+class TxScheduler;
+
+// Detached coroutine started by a DeviceSession flow. It runs eagerly until
+// its first co_await and frees its own frame when it finishes.
+class SessionTask
+{
+public:
+    struct promise_type
+    {
+        SessionTask get_return_object() noexcept { return SessionTask{}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// Coroutine front end for command/response flows with one device.
+//
+//   const std::optional<Message> reply {co_await session->request(Signal::STATE_REQUEST, 500)};
+//   const std::optional<Message> tick {co_await session->waitFor(Update::DISPLAY_TIMER, 1500)};
+//
+// An awaited request resumes with the first matching rx message or with an
+// empty optional on timeout; a negative timeout waits indefinitely. Timeouts
+// live on the shared TimerService wheel inside the awaiting coroutine's
+// frame, so an in-flight request costs no thread, no QTimer and no
+// allocation beyond the frame itself.
+class DeviceSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    class Awaiter
+    {
+    public:
+        ~Awaiter();
+
+        Awaiter(const Awaiter&) = delete;
+        Awaiter& operator=(const Awaiter&) = delete;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        std::optional<MicrowaveMsgFormat::Message> await_resume() noexcept { return result; }
+
+    private:
+        friend class DeviceSession;
+
+        enum class Match {
+            NOTHING,    // plain delay
+            TYPE,       // any message of the given Type
+            VALUE       // exact State/Signal/Update value
+        };
+
+        Awaiter(DeviceSession* session, const Match match, const MicrowaveMsgFormat::Type type,
+                const uint32_t value, const int timeoutMs,
+                const MicrowaveMsgFormat::Message* txMessage = nullptr);
+
+        bool matches(const MicrowaveMsgFormat::Message& msg) const;
+
+        DeviceSession* session;
+        Match match;
+        MicrowaveMsgFormat::Type type;
+        uint32_t value;
+        int timeoutMs;
+        bool transmit;
+        MicrowaveMsgFormat::Message txMessage;
+        std::optional<MicrowaveMsgFormat::Message> result;
+        std::coroutine_handle<> handle;
+        TimingWheel::Timer timer;
+        Awaiter* prev;
+        Awaiter* next;
+    };
+
+    explicit DeviceSession(TxScheduler* scheduler, QObject *parent = nullptr);
+    ~DeviceSession();
+
+    //sends signal and waits for its reply: a State for STATE_REQUEST, the
+    // echoed Signal otherwise
+    Awaiter request(const MicrowaveMsgFormat::Signal signal, const int timeoutMs);
+    //same for a fully built message, e.g. one carrying data
+    Awaiter request(const MicrowaveMsgFormat::Message& msg, const int timeoutMs);
+
+    Awaiter waitFor(const MicrowaveMsgFormat::State state, const int timeoutMs);
+    Awaiter waitFor(const MicrowaveMsgFormat::Signal signal, const int timeoutMs);
+    Awaiter waitFor(const MicrowaveMsgFormat::Update update, const int timeoutMs);
+    Awaiter delay(const int ms);
+
+    //feeds one rx message to the awaiting flows
+    void dispatch(const MicrowaveMsgFormat::Message& msg);
+
+    void send(const MicrowaveMsgFormat::Signal signal);
+
+    int pending() const;
+
+private:
+    TxScheduler* scheduler;
+    Awaiter* waiters;
+    int waiterCount;
+
+    void link(Awaiter& awaiter);
+    void unlink(Awaiter& awaiter);
+};
+
+#endif // DEVICESESSION_H
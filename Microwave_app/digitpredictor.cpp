@@ -0,0 +1,137 @@
+#include "digitpredictor.h"
+
+#include <QDebug>
+
+DigitPredictor::DigitPredictor()
+    : mode{Mode::OFF}
+    , confirmed{}
+    , pending{}
+    , pendingCount{0}
+    , stat{}
+    , clock{}
+{
+    clock.start();
+}
+
+DigitPredictor::~DigitPredictor()
+{
+    logStats();
+}
+
+bool DigitPredictor::setMode(const Mode mode, MicrowaveMsgFormat::Time &time)
+{
+    this->mode = mode;
+    return expire(time);
+}
+
+bool DigitPredictor::predict(const quint32 digit, MicrowaveMsgFormat::Time &time)
+{
+    if(Mode::OFF == mode) {
+        return false;
+    }
+    if(MAX_PENDING == pendingCount) {
+        //far ahead of the device, stop guessing until it catches up
+        return false;
+    }
+    if(0 == pendingCount) {
+        confirmed = time;
+    }
+    apply(digit, time);
+    pending[pendingCount++] = Pending{digit, time, clock.nsecsElapsed()};
+    ++stat.predicted;
+    return true;
+}
+
+void DigitPredictor::reconcile(const MicrowaveMsgFormat::Time &received, MicrowaveMsgFormat::Time &time)
+{
+    confirmed = received;
+    if(0 == pendingCount) {
+        time = received;
+        return;
+    }
+
+    const qint64 latency {clock.nsecsElapsed() - pending[0].pressedNs};
+    MicrowaveMsgFormat::Time predicted {pending[0].predicted};
+    const bool hit {predicted == received};
+    for(int i {1}; i < pendingCount; ++i) {
+        pending[i - 1] = pending[i];
+    }
+    --pendingCount;
+
+    stat.totalEchoNs += latency;
+    if(hit) {
+        ++stat.confirmed;
+    }
+    else {
+        //the right value only shows now, and later presses move onto it
+        ++stat.mispredicted;
+        stat.totalPerceivedNs += latency;
+        MicrowaveMsgFormat::Time rebased {received};
+        for(int i {0}; i < pendingCount; ++i) {
+            apply(pending[i].digit, rebased);
+            pending[i].predicted = rebased;
+        }
+    }
+    time = pendingCount ? pending[pendingCount - 1].predicted : received;
+}
+
+bool DigitPredictor::expire(MicrowaveMsgFormat::Time &time)
+{
+    if(0 == pendingCount) {
+        return false;
+    }
+    stat.expired += static_cast<quint64>(pendingCount);
+    pendingCount = 0;
+    time = confirmed;
+    return true;
+}
+
+bool DigitPredictor::isPending() const
+{
+    return pendingCount > 0;
+}
+
+const DigitPredictor::Stats &DigitPredictor::stats() const
+{
+    return stat;
+}
+
+void DigitPredictor::apply(const quint32 digit, MicrowaveMsgFormat::Time &time) const
+{
+    switch(mode) {
+    case Mode::SHIFT:
+        time.left_tens = time.left_ones;
+        time.left_ones = time.right_tens;
+        time.right_tens = time.right_ones;
+        time.right_ones = digit;
+        break;
+    case Mode::LEFT_TENS:
+        time.left_tens = digit;
+        break;
+    case Mode::LEFT_ONES:
+        time.left_ones = digit;
+        break;
+    case Mode::RIGHT_TENS:
+        time.right_tens = digit;
+        break;
+    case Mode::RIGHT_ONES:
+        time.right_ones = digit;
+        break;
+    case Mode::OFF:
+        break;
+    }
+}
+
+void DigitPredictor::logStats() const
+{
+    const quint64 answered {stat.confirmed + stat.mispredicted};
+    if(0 == stat.predicted) {
+        return;
+    }
+    qDebug() << "digit echo:" << stat.predicted << "predicted,"
+             << stat.mispredicted << "of" << answered << "mispredicted,"
+             << stat.expired << "expired, echo mean"
+             << (answered ? stat.totalEchoNs / static_cast<qint64>(answered) / 1000 : 0)
+             << "us, perceived mean"
+             << (answered ? stat.totalPerceivedNs / static_cast<qint64>(answered) / 1000 : 0) << "us";
+}
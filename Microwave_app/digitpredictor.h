@@ -0,0 +1,81 @@
+#ifndef DIGITPREDICTOR_H
+#define DIGITPREDICTOR_H
+
+#include "MicrowaveMessageFormat.h"
+
+#include <QElapsedTimer>
+
+// Local echo of digit keys.
+//
+// A digit press changes the displayed Time right away the way the device
+// is expected to: shifted in from the right while a cook time is entered,
+// written over the selected position in the clock and kitchen timer select
+// states. Each prediction stays pending until the device's next time
+// update. A matching update confirms it. A different one wins, and the
+// presses still pending are replayed on top of it. Predictions the device
+// never answers, or that are left behind by a mode change, are rolled back
+// to the last authoritative value.
+class DigitPredictor
+{
+public:
+    enum class Mode {
+        OFF,
+        SHIFT,          // MM:SS <- d
+        LEFT_TENS,      // overwrite one position
+        LEFT_ONES,
+        RIGHT_TENS,
+        RIGHT_ONES
+    };
+
+    struct Stats
+    {
+        quint64 predicted;
+        quint64 confirmed;
+        quint64 mispredicted;
+        quint64 expired;
+        qint64 totalEchoNs;         // press to the device's update
+        qint64 totalPerceivedNs;    // press to the right value on screen
+    };
+
+    DigitPredictor();
+    ~DigitPredictor();
+
+    //pending predictions belong to the previous mode and are rolled back as
+    // by expire(), true when time changed
+    bool setMode(const Mode mode, MicrowaveMsgFormat::Time& time);
+
+    //applies digit to time, false when the current mode predicts nothing or
+    // too many presses are already pending
+    bool predict(const quint32 digit, MicrowaveMsgFormat::Time& time);
+
+    //sets time from an authoritative update, keeping later predictions on top
+    void reconcile(const MicrowaveMsgFormat::Time& received, MicrowaveMsgFormat::Time& time);
+
+    //rolls time back to the last authoritative value, false when nothing was pending
+    bool expire(MicrowaveMsgFormat::Time& time);
+
+    bool isPending() const;
+    const Stats& stats() const;
+
+private:
+    static const int MAX_PENDING {8};
+
+    struct Pending
+    {
+        quint32 digit;
+        MicrowaveMsgFormat::Time predicted;
+        qint64 pressedNs;
+    };
+
+    Mode mode;
+    MicrowaveMsgFormat::Time confirmed;
+    Pending pending[MAX_PENDING];
+    int pendingCount;
+    Stats stat;
+    QElapsedTimer clock;
+
+    void apply(const quint32 digit, MicrowaveMsgFormat::Time& time) const;
+    void logStats() const;
+};
+
+#endif // DIGITPREDICTOR_H
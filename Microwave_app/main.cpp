@@ -1,9 +1,11 @@
 #include "microwave.h"
+#include "startupprofiler.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler::instance();
     QApplication a(argc, argv);
     Microwave w;
     w.show();
@@ -1,61 +1,177 @@
 #include "microwave.h"
+#include "transport.h"
+#include "txscheduler.h"
+#include "devicesession.h"
+#include "timerservice.h"
+#include "blinkengine.h"
+#include "startupprofiler.h"
+#include "statecache.h"
+#include "capturewriter.h"
+#include "digitpredictor.h"
 #include "MicrowaveMessageFormat.h"
+#include "MicrowaveTimeDelta.h"
+#include "MicrowaveDisplay.h"
+#include "MicrowavePerfCounters.h"
 #include "ui_microwave.h"
 
+#include <QDateTime>
 #include <QDebug>
-#include <QTcpSocket>
-#include <QNetworkDatagram>
-#include <QStateMachine>
-#include <QState>
-#include <QSignalTransition>
 #include <QTimer>
+#include <QShortcut>
+#include <QKeySequence>
 
 namespace {
 
-const quint16 DEV_RECV_PORT {60002};
-const QHostAddress server {QHostAddress("192.168.0.10")};
+const int STATE_REQUEST_INTERVAL_MS {500}; // half second
+const int RECONNECT_MIN_DELAY_MS {500};
+const int RECONNECT_MAX_DELAY_MS {30000};
+const int CAPABILITIES_TIMEOUT_MS {1000};
+//a digit echo the device has not confirmed by then is rolled back
+const int DIGIT_ECHO_TIMEOUT_MS {1000};
+//rx messages taken from the transport per pass before yielding to the event loop
+const int RX_BUDGET {64};
+
+//set to profile the receive path, the table goes to the debug output on
+// Ctrl+Shift+P and on exit
+const char* const PERF_ENV {"MICROWAVE_PERF"};
+
+const char* const LIVE_DISPLAY_STYLE {"color: rgb(34, 206, 7);"};
+const char* const STALE_DISPLAY_STYLE {"color: rgb(17, 103, 4);"};
+
+//Updates that carry a whole value, a later one of the same kind makes an
+// earlier one pointless; deltas are only superseded by a full *_SECONDS
+enum class UpdateKind {
+    CLOCK = 0,
+    DISPLAY_TIMER,
+    POWER_LEVEL,
+    CLOCK_STREAM,
+    DISPLAY_TIMER_STREAM,
+    COUNT
+};
+
+bool updateKind(const MicrowaveMsgFormat::Update update, UpdateKind& kind, bool& full)
+{
+    using namespace MicrowaveMsgFormat;
+    full = true;
+    switch(update) {
+    case Update::CLOCK:
+        kind = UpdateKind::CLOCK;
+        return true;
+    case Update::DISPLAY_TIMER:
+        kind = UpdateKind::DISPLAY_TIMER;
+        return true;
+    case Update::POWER_LEVEL:
+        kind = UpdateKind::POWER_LEVEL;
+        return true;
+    case Update::CLOCK_SECONDS:
+        kind = UpdateKind::CLOCK_STREAM;
+        return true;
+    case Update::DISPLAY_TIMER_SECONDS:
+        kind = UpdateKind::DISPLAY_TIMER_STREAM;
+        return true;
+    case Update::CLOCK_DELTA:
+        kind = UpdateKind::CLOCK_STREAM;
+        full = false;
+        return true;
+    case Update::DISPLAY_TIMER_DELTA:
+        kind = UpdateKind::DISPLAY_TIMER_STREAM;
+        full = false;
+        return true;
+    case Update::NONE:
+        break;
+    }
+    return false;
+}
+
+//Drops the Updates of batch that a later Update of the same kind replaces
+// before the next State or Signal, so every State and Signal still sees
+// the values it would have seen. Returns the new count.
+int coalesceUpdates(MicrowaveMsgFormat::Message* batch, const int count)
+{
+    using namespace MicrowaveMsgFormat;
+
+    bool keep[RX_BUDGET];
+    bool superseded[static_cast<int>(UpdateKind::COUNT)] {};
+    for(int i {count - 1}; i >= 0; --i) {
+        keep[i] = true;
+        if(Type::UPDATE != static_cast<Type>(static_cast<uint32_t>(batch[i].state) >> 24)) {
+            for(bool& flag : superseded) {
+                flag = false;
+            }
+            continue;
+        }
+        UpdateKind kind;
+        bool full;
+        if(!updateKind(batch[i].update, kind, full)) {
+            continue;
+        }
+        keep[i] = !superseded[static_cast<int>(kind)];
+        if(full) {
+            superseded[static_cast<int>(kind)] = true;
+        }
+    }
+
+    int kept {0};
+    for(int i {0}; i < count; ++i) {
+        if(keep[i]) {
+            batch[kept++] = batch[i];
+        }
+    }
+    return kept;
+}
 
 }
 
 Microwave::Microwave(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::Microwave)
-    , socket{new QTcpSocket(this)}
-    , txBuf{}
-    , rxBuf{}
-    , timer{new QTimer(this)}
+    , transport{Transport::create(this)}
+    , txScheduler{new TxScheduler(transport, this)}
+    , session{new DeviceSession(txScheduler, this)}
+    , blinkEngine{new BlinkEngine(this)}
+    , core{new MicrowaveMsgFormat::ProtocolCore()}
+    , coreTimer{}
+    , reconnectTimer{}
+    , digitEchoTimer{}
+    , reconnectDelay{RECONNECT_MIN_DELAY_MS}
     , txMessage{new MicrowaveMsgFormat::Message()}
-    , rxMessage{new MicrowaveMsgFormat::Message()}
-    , time{new MicrowaveMsgFormat::Time()}
-    , powerLevel{}
-    , disableClockDisplay{false}
-    , disablePowerLevel{false}
-    , sm{new QStateMachine(this)}
-    , InitialState{new QState(sm)}
-    , DisplayClock{Q_NULLPTR}
-    , DisplayClockInit{Q_NULLPTR}
-    , SetClock{Q_NULLPTR}
-    , ClockSelectHourTens{Q_NULLPTR}
-    , ClockSelectHourOnes{Q_NULLPTR}
-    , ClockSelectMinuteTens{Q_NULLPTR}
-    , ClockSelectMinuteOnes{Q_NULLPTR}
-    , SetCookTimer{Q_NULLPTR}
-    , SetCookTimerInit{Q_NULLPTR}
-    , SetPowerLevel{Q_NULLPTR}
-    , SetPowerLevelInit{Q_NULLPTR}
-    , SetKitchenTimer{Q_NULLPTR}
-    , SetKitchenTimerInit{Q_NULLPTR}
-    , KitchenSelectMinuteTens{Q_NULLPTR}
-    , KitchenSelectMinuteOnes{Q_NULLPTR}
-    , KitchenSelectSecondTens{Q_NULLPTR}
-    , KitchenSelectSecondOnes{Q_NULLPTR}
-    , DisplayTimer{Q_NULLPTR}
-    , DisplayTimerInit{Q_NULLPTR}
-    , SetCookTimerTransition{Q_NULLPTR}
-    , SetKitchenTimerTransition{Q_NULLPTR}
-    , DisplayTimerTransition{Q_NULLPTR}
-{
+    , rxBatch{new MicrowaveMsgFormat::Message[RX_BUDGET]}
+    , rxDrainQueued{false}
+    , rxCoalesced{0}
+    , stateCache{new StateCache(transport->endpoint())}
+    , capture{CaptureWriter::instance()}
+    , predictor{new DigitPredictor()}
+    , editedStream{MicrowaveMsgFormat::TimeStream::DISPLAY_TIMER}
+    , perf{qEnvironmentVariableIsSet(PERF_ENV) ? new MicrowaveMsgFormat::PerfProfile() : Q_NULLPTR}
+    , perfType{MicrowaveMsgFormat::PerfNoType}
+    , stale{true}
+    , requestingState{false}
+    , shownFrame{new MicrowaveMsgFormat::DisplayFrame()}
+    , glyphLabels{}
+{
+    //start connecting before anything else so the link comes up while the
+    // UI is built, queued so the slots below only run once the UI exists
+    connect(transport, SIGNAL(connected()), this, SLOT(onTransportConnect()), Qt::QueuedConnection);
+    connect(transport, SIGNAL(disconnected()), this, SLOT(onTransportDisconnect()), Qt::QueuedConnection);
+    transport->open();
+    StartupProfiler::instance()->reach(StartupProfiler::Milestone::TRANSPORT_OPENED);
+
+    txMessage->dst = MicrowaveMsgFormat::Destination::DEV;
+    //a link that came up synchronously gets its STATE_REQUEST right away
+    requestState();
+
     ui->setupUi(this);
+    StartupProfiler::instance()->reach(StartupProfiler::Milestone::UI_BUILT);
+    StartupProfiler::instance()->watchFirstPaint(this);
+
+    glyphLabels[static_cast<int>(MicrowaveMsgFormat::Glyph::LEFT_TENS)] = ui->left_tens;
+    glyphLabels[static_cast<int>(MicrowaveMsgFormat::Glyph::LEFT_ONES)] = ui->left_ones;
+    glyphLabels[static_cast<int>(MicrowaveMsgFormat::Glyph::COLON)] = ui->colon;
+    glyphLabels[static_cast<int>(MicrowaveMsgFormat::Glyph::RIGHT_TENS)] = ui->right_tens;
+    glyphLabels[static_cast<int>(MicrowaveMsgFormat::Glyph::RIGHT_ONES)] = ui->right_ones;
+    //the core starts out on the texts set up by microwave.ui
+    *shownFrame = core->frame();
+
     connect(ui->pb_timeCook, SIGNAL(clicked()), this, SLOT(sendTimeCook()));
     connect(ui->pb_powerLevel, SIGNAL(clicked()), this, SLOT(sendPowerLevel()));
     connect(ui->pb_kitchenTimer, SIGNAL(clicked()), this, SLOT(sendKitchenTimer()));
@@ -73,556 +189,390 @@ Microwave::Microwave(QWidget *parent)
     connect(ui->pb_stop, SIGNAL(clicked()), this, SLOT(sendStop()));
     connect(ui->pb_start, SIGNAL(clicked()), this, SLOT(sendStart()));
 
-    connect(socket, SIGNAL(connected()), this, SLOT(onTcpConnect()));
-    connect(socket, SIGNAL(disconnected()), this, SLOT(onTcpDisconnect()));
-
-    txMessage->dst = MicrowaveMsgFormat::Destination::DEV;
-
-    connect(InitialState, SIGNAL(entered()), this, SLOT(InitialStateEntry()));
-    connect(InitialState, SIGNAL(exited()), this, SLOT(InitialStateExit()));
-
-    SetupDisplayClockState(sm);
-    SetupSetCookTimerState(sm);
-    SetupSetPowerLevelState(sm);
-    SetupSetKitchenTimerState(sm);
-    SetupDisplayTimerState(sm);
-
-    //normal transitions between higher level states
-
-    //transitions from DisplayClock to the following need to be saved:
-    // - SetCookTimer
-    // - SetKitchenTimer
-    // - DisplayTimer
-    SetCookTimerTransition    = DisplayClock->addTransition(this, SIGNAL(cook_time_sig()), SetCookTimer);
-    SetKitchenTimerTransition = DisplayClock->addTransition(this, SIGNAL(kitchen_timer_sig()), SetKitchenTimer);
-    DisplayTimerTransition     = DisplayClock->addTransition(this, SIGNAL(start_sig()), DisplayTimer);
-
-    SetCookTimer->addTransition(this, SIGNAL(power_level_sig()), SetPowerLevel);
-    SetCookTimer->addTransition(this, SIGNAL(stop_sig()), DisplayClock);
-    SetCookTimer->addTransition(this, SIGNAL(start_sig()), DisplayTimer);
-
-    SetPowerLevel->addTransition(this, SIGNAL(cook_time_sig()), SetCookTimer);
-    SetPowerLevel->addTransition(this, SIGNAL(stop_sig()), DisplayClock);
-    SetPowerLevel->addTransition(this, SIGNAL(start_sig()), DisplayTimer);
-
-    SetKitchenTimer->addTransition(this, SIGNAL(stop_sig()), DisplayClock);
-    SetKitchenTimer->addTransition(this, SIGNAL(start_sig()), DisplayTimer);
-
-    DisplayTimer->addTransition(this, SIGNAL(display_timer_done_sig()), DisplayClock);
-    DisplayTimer->addTransition(this, SIGNAL(stop_sig()), DisplayClock);
-
-    //state request resultant transitions
-    InitialState->addTransition(this, SIGNAL(state_req_display_clock()), DisplayClock);
-
-    InitialState->addTransition(this, SIGNAL(state_req_set_cook_timer()), SetCookTimer);
-    InitialState->addTransition(this, SIGNAL(state_req_set_power_level()), SetPowerLevel);
-    InitialState->addTransition(this, SIGNAL(state_req_display_timer()), DisplayTimer);
-
-    InitialState->addTransition(this, SIGNAL(state_req_clock_select_left_tens()), ClockSelectHourTens);
-    InitialState->addTransition(this, SIGNAL(state_req_clock_select_left_ones()), ClockSelectHourOnes);
-    InitialState->addTransition(this, SIGNAL(state_req_clock_select_right_tens()), ClockSelectMinuteTens);
-    InitialState->addTransition(this, SIGNAL(state_req_clock_select_right_ones()), ClockSelectMinuteOnes);
-
-    InitialState->addTransition(this, SIGNAL(state_req_kitchen_select_left_tens()), KitchenSelectMinuteTens);
-    InitialState->addTransition(this, SIGNAL(state_req_kitchen_select_left_ones()), KitchenSelectMinuteOnes);
-    InitialState->addTransition(this, SIGNAL(state_req_kitchen_select_right_tens()), KitchenSelectSecondTens);
-    InitialState->addTransition(this, SIGNAL(state_req_kitchen_select_right_ones()), KitchenSelectSecondOnes);
+    if(perf) {
+        perf->calibrate();
+        if(!perf->hasCounters()) {
+            qDebug() << "perf: hardware counters unavailable, timing only";
+        }
+        QShortcut* dump {new QShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_P), this)};
+        connect(dump, SIGNAL(activated()), this, SLOT(dumpPerf()));
+    }
 
-    sm->setInitialState(InitialState);
-    sm->start();
+    //show the last known values right away, the device reconciles them
+    restoreCachedState();
 
-    socket->connectToHost(server, DEV_RECV_PORT, QIODevice::ReadWrite);
+    connect(blinkEngine, SIGNAL(blink(bool)), this, SLOT(onBlink(bool)));
+    core->setListener(this);
+    StartupProfiler::instance()->reach(StartupProfiler::Milestone::STATE_MACHINE_STARTED);
 }
 
 Microwave::~Microwave()
 {
-    delete time;
+    dumpPerf();
+    delete perf;
+    delete core;
+    delete stateCache;
+    delete predictor;
+    delete shownFrame;
     delete txMessage;
+    delete[] rxBatch;
     delete ui;
 }
 
-void Microwave::SetupDisplayClockState(QState *parent)
-{
-    DisplayClock = new QState(parent);
-    DisplayClockInit = new QState(DisplayClock);
-
-    SetClock = new QState(DisplayClock);
-    SetClockInit = new QState(SetClock);
-    ClockSelectHourTens = new QState(SetClock);
-    ClockSelectHourOnes = new QState(SetClock);
-    ClockSelectMinuteTens = new QState(SetClock);
-    ClockSelectMinuteOnes = new QState(SetClock);
-
-    DisplayClock->setObjectName("DisplayClock");
-    DisplayClockInit->setObjectName("DisplayClockInit");
-    SetClock->setObjectName("SetClock");
-    SetClockInit->setObjectName("SetClockInit");
-    ClockSelectHourTens->setObjectName("ClockSelectHourTens");
-    ClockSelectHourOnes->setObjectName("ClockSelectHourOnes");
-    ClockSelectMinuteTens->setObjectName("ClockSelectMinuteTens");
-    ClockSelectMinuteOnes->setObjectName("ClockSelectMinuteOnes");
-
-    //display_clock
-    connect(DisplayClock, SIGNAL(entered()), this, SLOT(DisplayClockInitEntry()));
-    connect(DisplayClock, SIGNAL(exited()), this, SLOT(DisplayClockInitExit()));
-    DisplayClockInit->addTransition(this, SIGNAL(clock_sig()), SetClock);
-
-    //set_clock
-    connect(SetClock, SIGNAL(entered()), this, SLOT(SetClockEntry()));
-    connect(SetClock, SIGNAL(exited()), this, SLOT(SetClockExit()));
-    SetClock->setInitialState(SetClockInit);
-    SetClockInit->addTransition(this, SIGNAL(select_left_tens_sig()), ClockSelectHourTens);
-
-    //select_hour_tens
-    connect(ClockSelectHourTens, SIGNAL(entered()), this, SLOT(SelectLeftTensEntry()));
-    connect(ClockSelectHourTens, SIGNAL(exited()), this, SLOT(displayTime()));
-    connect(ClockSelectHourTens, SIGNAL(exited()), this, SLOT(SelectLeftTensExit()));
-    ClockSelectHourTens->addTransition(this, SIGNAL(select_left_ones_sig()), ClockSelectHourOnes);
-
-    //select_hour_ones
-    connect(ClockSelectHourOnes, SIGNAL(entered()), this, SLOT(SelectLeftOnesEntry()));
-    connect(ClockSelectHourOnes, SIGNAL(exited()), this, SLOT(displayTime()));
-    connect(ClockSelectHourOnes, SIGNAL(exited()), this, SLOT(SelectLeftOnesExit()));
-    ClockSelectHourOnes->addTransition(this, SIGNAL(select_right_tens_sig()), ClockSelectMinuteTens);
-
-    //select_minute_tens
-    connect(ClockSelectMinuteTens, SIGNAL(entered()), this, SLOT(SelectRightTensEntry()));
-    connect(ClockSelectMinuteTens, SIGNAL(exited()), this, SLOT(displayTime()));
-    connect(ClockSelectMinuteTens, SIGNAL(exited()), this, SLOT(SelectRightTensExit()));
-    ClockSelectMinuteTens->addTransition(this, SIGNAL(select_right_ones_sig()), ClockSelectMinuteOnes);
-
-    //select_minute_ones
-    connect(ClockSelectMinuteOnes, SIGNAL(entered()), this, SLOT(SelectRightOnesEntry()));
-    connect(ClockSelectMinuteOnes, SIGNAL(exited()), this, SLOT(displayTime()));
-    connect(ClockSelectMinuteOnes, SIGNAL(exited()), this, SLOT(SelectRightOnesExit()));
-    ClockSelectMinuteOnes->addTransition(this, SIGNAL(select_left_tens_sig()), ClockSelectHourTens);
-
-    //transitions to finish exit set_clock
-    SetClock->addTransition(this, SIGNAL(clock_done_sig()), DisplayClock);
-
-    DisplayClock->setInitialState(DisplayClockInit);
-}
-
-void Microwave::SetupSetCookTimerState(QState *parent)
-{
-    SetCookTimer = new QState(parent);
-    SetCookTimerInit = new QState(SetCookTimer);
-
-    SetCookTimer->setObjectName("SetCookTimer");
-    SetCookTimerInit->setObjectName("SetCookTimerInit");
-
-    connect(SetCookTimer, SIGNAL(entered()), this, SLOT(SetCookTimerEntry()));
-    connect(SetCookTimer, SIGNAL(exited()), this, SLOT(SetCookTimerExit()));
-
-    SetCookTimer->setInitialState(SetCookTimerInit);
-}
-
-void Microwave::SetupSetPowerLevelState(QState *parent)
+void Microwave::restoreCachedState()
 {
-    SetPowerLevel = new QState(parent);
-    SetPowerLevelInit = new QState(SetPowerLevel);
-
-    SetPowerLevel->setObjectName("SetPowerLevel");
-    SetPowerLevelInit->setObjectName("SetPowerLevelInit");
-
-    connect(SetPowerLevel, SIGNAL(entered()), this, SLOT(SetPowerLevelEntry()));
-    connect(SetPowerLevel, SIGNAL(exited()), this, SLOT(SetPowerLevelExit()));
-    SetPowerLevel->setInitialState(SetPowerLevelInit);
-}
-
-void Microwave::SetupSetKitchenTimerState(QState *parent)
-{
-    SetKitchenTimer = new QState(parent);
-    SetKitchenTimerInit = new QState(SetKitchenTimer);
-    KitchenSelectMinuteTens = new QState(SetKitchenTimer);
-    KitchenSelectMinuteOnes = new QState(SetKitchenTimer);
-    KitchenSelectSecondTens = new QState(SetKitchenTimer);
-    KitchenSelectSecondOnes = new QState(SetKitchenTimer);
-
-    SetKitchenTimer->setObjectName("SetKitchenTimer");
-    SetKitchenTimerInit->setObjectName("SetKitchenTimerInit");
-    KitchenSelectMinuteTens->setObjectName("KitchenSelectMinuteTens");
-    KitchenSelectMinuteOnes->setObjectName("KitchenSelectMinuteOnes");
-    KitchenSelectSecondTens->setObjectName("KitchenSelectSecondTens");
-    KitchenSelectSecondOnes->setObjectName("KitchenSelectSecondOnes");
-
-    SetKitchenTimerInit->addTransition(this, SIGNAL(select_left_tens_sig()), KitchenSelectMinuteTens);
-
-    connect(KitchenSelectMinuteTens, SIGNAL(entered()), this, SLOT(SelectLeftTensEntry()));
-    connect(KitchenSelectMinuteTens, SIGNAL(exited()), this, SLOT(SelectLeftTensExit()));
-    KitchenSelectMinuteTens->addTransition(this, SIGNAL(select_left_ones_sig()), KitchenSelectMinuteOnes);
-
-    connect(KitchenSelectMinuteOnes, SIGNAL(entered()), this, SLOT(SelectLeftOnesEntry()));
-    connect(KitchenSelectMinuteOnes, SIGNAL(exited()), this, SLOT(SelectLeftOnesExit()));
-    KitchenSelectMinuteOnes->addTransition(this, SIGNAL(select_right_tens_sig()), KitchenSelectSecondTens);
-
-    connect(KitchenSelectSecondTens, SIGNAL(entered()), this, SLOT(SelectRightTensEntry()));
-    connect(KitchenSelectSecondTens, SIGNAL(exited()), this, SLOT(SelectRightTensExit()));
-    KitchenSelectSecondTens->addTransition(this, SIGNAL(select_right_ones_sig()), KitchenSelectSecondOnes);
-
-    connect(KitchenSelectSecondOnes, SIGNAL(entered()), this, SLOT(SelectRightOnesEntry()));
-    connect(KitchenSelectSecondOnes, SIGNAL(exited()), this, SLOT(SelectRightOnesExit()));
-    KitchenSelectSecondOnes->addTransition(this, SIGNAL(select_left_tens_sig()), KitchenSelectMinuteTens);
-
-    SetKitchenTimer->setInitialState(SetKitchenTimerInit);
-}
-
-void Microwave::SetupDisplayTimerState(QState *parent)
-{
-    DisplayTimer = new QState(parent);
-    DisplayTimerInit = new QState(DisplayTimer);
-
-    DisplayTimer->setObjectName("DisplayTimer");
-    DisplayTimerInit->setObjectName("DisplayTimerInit");
-
-    connect(DisplayTimer, SIGNAL(entered()), this, SLOT(DisplayTimerInitEntry()));
-    connect(DisplayTimer, SIGNAL(exited()), this, SLOT(DisplayTimerInitExit()));
-
-    DisplayTimer->setInitialState(DisplayTimerInit);
-}
-
-void Microwave::InitialStateEntry()
-{
-    connect(timer, SIGNAL(timeout()), this, SLOT(onStateRequestTimeout()));
-    timer->setInterval(500); // half second
-    timer->setSingleShot(false);
-    timer->start();
-}
-
-void Microwave::InitialStateExit()
-{
-    disconnect(timer, SIGNAL(timeout()), this, SLOT(onStateRequestTimeout()));
-    timer->stop();
-}
-
-void Microwave::DisplayClockInitEntry()
-{
-    qDebug() << "entered display_clock";
-    connect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_colon(bool)));
-}
-
-void Microwave::DisplayClockInitExit()
-{
-    qDebug() << "left display_clock";
-    disconnect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_colon(bool)));
-}
-
-void Microwave::SetClockEntry()
-{
-    qDebug() << "entered set_clock";
-
-    connect(this, SIGNAL(clock_sig()), this, SLOT(clock_done()));
-    connect(this, SIGNAL(stop_sig()), this, SLOT(clock_done()));
-    disconnect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_colon(bool)));
-
-    DisplayClock->removeTransition(dynamic_cast<QAbstractTransition*>(SetCookTimerTransition));
-    DisplayClock->removeTransition(dynamic_cast<QAbstractTransition*>(SetKitchenTimerTransition));
-    DisplayClock->removeTransition(dynamic_cast<QAbstractTransition*>(DisplayTimerTransition));
-}
-
-void Microwave::SetClockExit()
-{
-    qDebug() << "left set_clock";
-
-    disconnect(this, SIGNAL(clock_sig()), this, SLOT(clock_done()));
-    disconnect(this, SIGNAL(stop_sig()), this, SLOT(clock_done()));
-    connect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_colon(bool)));
-
-    DisplayClock->addTransition(dynamic_cast<QAbstractTransition*>(SetCookTimerTransition));
-    DisplayClock->addTransition(dynamic_cast<QAbstractTransition*>(SetKitchenTimerTransition));
-    DisplayClock->addTransition(dynamic_cast<QAbstractTransition*>(DisplayTimerTransition));
-}
-
-void Microwave::SelectLeftTensEntry()
-{
-    qDebug() << "entered select_hour_tens";
-    connect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_left_tens(bool)));
-}
-
-void Microwave::SelectLeftTensExit()
-{
-    qDebug() << "left select_hour_tens";
-    disconnect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_left_tens(bool)));
-}
-
-void Microwave::SelectLeftOnesEntry()
-{
-    qDebug() << "entered select_hour_ones";
-    connect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_left_ones(bool)));
-}
-
-void Microwave::SelectLeftOnesExit()
-{
-    qDebug() << "left select_hour_ones";
-    disconnect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_left_ones(bool)));
-}
+    using namespace MicrowaveMsgFormat;
 
-void Microwave::SelectRightTensEntry()
-{
-    qDebug() << "entered select_minute_tens";
-    connect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_right_tens(bool)));
-}
+    setStale(true);
 
-void Microwave::SelectRightTensExit()
-{
-    qDebug() << "left select_minute_tens";
-    disconnect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_right_tens(bool)));
-}
+    StateCache::Snapshot snapshot {};
+    if(!stateCache->load(snapshot)) {
+        return;
+    }
+    qDebug() << "restored cached state from"
+             << QDateTime::fromMSecsSinceEpoch(snapshot.savedAtMs).toString(Qt::ISODate);
 
-void Microwave::SelectRightOnesEntry()
-{
-    qDebug() << "entered select_minute_ones";
-    connect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_right_ones(bool)));
+    core->restore(snapshot.time, snapshot.powerLevel, State::SET_POWER_LEVEL == snapshot.state);
+    present();
 }
 
-void Microwave::SelectRightOnesExit()
+void Microwave::setStale(const bool flag)
 {
-    qDebug() << "left select_minute_ones";
-    disconnect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_right_ones(bool)));
+    if(stale && !flag) {
+        StartupProfiler::instance()->reach(StartupProfiler::Milestone::FIRST_VALID_DISPLAY);
+    }
+    stale = flag;
+    const char* const style {flag ? STALE_DISPLAY_STYLE : LIVE_DISPLAY_STYLE};
+    ui->left_tens->setStyleSheet(style);
+    ui->left_ones->setStyleSheet(style);
+    ui->colon->setStyleSheet(style);
+    ui->right_tens->setStyleSheet(style);
+    ui->right_ones->setStyleSheet(style);
 }
 
-void Microwave::SetCookTimerEntry()
+SessionTask Microwave::requestState()
 {
-    qDebug() << "entered set_cook_time";
-    disableClockDisplay = true;
-    disablePowerLevel = true;
-    displayTime();
-}
+    using namespace MicrowaveMsgFormat;
 
-void Microwave::SetCookTimerExit()
-{
-    qDebug() << "left set_cook_time";
-    disableClockDisplay = false;
-    disablePowerLevel = false;
+    //poll until a State reply has confirmed the display, the reply itself is
+    // handled by handleState like any other rx message; a link that is down
+    // is picked up again by onTransportConnect()
+    if(requestingState) {
+        co_return;
+    }
+    requestingState = true;
+    while(stale && transport->isConnected()) {
+        const std::optional<Message> reply {co_await session->request(Signal::STATE_REQUEST, STATE_REQUEST_INTERVAL_MS)};
+        if(reply) {
+            co_await session->delay(STATE_REQUEST_INTERVAL_MS);
+        }
+    }
+    requestingState = false;
 }
 
-void Microwave::SetPowerLevelEntry()
+SessionTask Microwave::negotiateCapabilities()
 {
-    qDebug() << "entered set_power_level";
-    disableClockDisplay = true;
-    connect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_power_level(bool)));
-    displayPowerLevel();
-}
+    using namespace MicrowaveMsgFormat;
 
-void Microwave::SetPowerLevelExit()
-{
-    qDebug() << "left set_power_level";
-    disconnect(this, SIGNAL(blink_sig(bool)), this, SLOT(blink_power_level(bool)));
-    disableClockDisplay = false;
+    Message offer {};
+    offer.dst = Destination::DEV;
+    offer.signal = Signal::CAPABILITIES;
+    offer.data[0] = static_cast<char>(CoreCapabilities);
+    offer.data[1] = static_cast<char>(ProtocolVersion);
+    offer.data[2] = static_cast<char>(TimerSyncOfferS);
+
+    //older firmware never answers, the link then stays on the original
+    // protocol; the reply itself went through the core like any rx message,
+    // which took local blink and timer sync from it
+    const std::optional<Message> reply {co_await session->request(offer, CAPABILITIES_TIMEOUT_MS)};
+    const uint8_t enabled {reply ? static_cast<uint8_t>(reply->data[0] & CoreCapabilities) : uint8_t{0}};
+    const uint8_t version {reply ? static_cast<uint8_t>(reply->data[1]) : uint8_t{1}};
+    qDebug() << "device protocol version:" << static_cast<int>(version)
+             << "capabilities:" << static_cast<int>(enabled)
+             << "timer sync every" << core->syncInterval() << "s";
+
+    if(core->isLocalBlink()) {
+        //no device blinks to smooth anymore, the core's edges take over
+        blinkEngine->stop();
+        armCoreTimer();
+        present();
+    }
+    //the device switches right after its reply, which has just been decoded
+    if((enabled & CAP_FRAMING_V2) && version >= 2) {
+        transport->setFraming(Transport::Framing::V2);
+    }
 }
 
-void Microwave::DisplayTimerInitEntry()
+void Microwave::onTransportConnect()
 {
-    qDebug() << "entered display_timer";
-    connect(this, SIGNAL(clock_sig()), this, SIGNAL(display_timer_done_sig()));
-    connect(this, SIGNAL(power_level_sig()), this, SLOT(startDisplayPowerLevel2Sec()));
-    disableClockDisplay = true;
-    disablePowerLevel = true;
-}
+    connect(transport, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    TimerService::instance()->stop(reconnectTimer);
+    reconnectDelay = RECONNECT_MIN_DELAY_MS;
+    negotiateCapabilities();
+    requestState();
 
-void Microwave::DisplayTimerInitExit()
-{
-    qDebug() << "left display_timer";
-    disconnect(this, SIGNAL(clock_sig()), this, SIGNAL(display_timer_done_sig()));
-    disconnect(this, SIGNAL(power_level_sig()), this, SLOT(startDisplayPowerLevel2Sec()));
-    disconnect(timer, SIGNAL(timeout()), this, SLOT(stopDisplayPowerLevel2Sec()));
-    disableClockDisplay = false;
-    disablePowerLevel = false;
+    //anything that arrived before readyRead() was connected
+    onReadyRead();
 }
 
-void Microwave::onTcpConnect()
+void Microwave::onTransportDisconnect()
 {
-    qDebug() << "socket connected";
-    connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
-//    connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)));
-}
+    disconnect(transport, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    txScheduler->reset();
+    //the device never answered those digits, show what it last confirmed
+    MicrowaveMsgFormat::Time shown {core->currentTime()};
+    if(predictor->expire(shown)) {
+        core->showTime(shown);
+    }
+    TimerService::instance()->stop(digitEchoTimer);
+    //what was negotiated goes with the link, the blink stops lit
+    if(capture) {
+        capture->writeLinkReset();
+    }
+    blinkEngine->stop();
+    core->linkReset();
+    armCoreTimer();
+    present();
+    setStale(true);
 
-void Microwave::onTcpDisconnect()
-{
-    qDebug() << "socket disconnected";
-    disconnect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
-//    disconnect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(onBytesWritten(qint64)));
+    //back off exponentially while the board stays unreachable
+    qDebug() << "reconnecting in" << reconnectDelay << "ms";
+    TimerService::instance()->start(reconnectTimer, reconnectDelay, [this]() {
+        transport->open();
+    });
+    reconnectDelay = qMin(reconnectDelay * 2, RECONNECT_MAX_DELAY_MS);
 }
 
 void Microwave::onReadyRead()
 {
     using namespace MicrowaveMsgFormat;
-    static const qint32 MessageSize = sizeof(Message);
-
-    rxBuf.append(socket->readAll());
 
-    //handle received data
-    while(rxBuf.size() >= MessageSize) {
-        char * tmp {strstr(rxBuf.data(), "Mapp")};
-        if(tmp) {
-            *rxMessage = ByteSwapMessage(Message(tmp));
-        }
-        else {
-            //clear everything except the last 3 bytes because
-            // a truncated header might be there
-            rxBuf = rxBuf.right(3);
+    //handle received data, unknown values never reach the switches below
+    // whatever transport they came in on
+    int count {0};
+    int read {0};
+    bool handshake {false};
+    {
+        PerfScope scope(perf, PerfSection::READ);
+        while(read < RX_BUDGET && transport->readMessage(rxBatch[count])) {
+            ++read;
+            const uint32_t value {static_cast<uint32_t>(rxBatch[count].state)};
+            if(!IsValidValue(value)) {
+                qDebug() << "dropping message with unknown value" << QString::number(value, 16);
+                continue;
+            }
+            //the capture keeps everything the device sent
+            if(capture) {
+                capture->writeRx(rxBatch[count]);
+            }
+            ++count;
+            //the device may switch framing right after its CAPABILITIES
+            // reply, nothing after it is decoded before the reply is handled
+            if(Signal::CAPABILITIES == rxBatch[count - 1].signal) {
+                handshake = true;
+                break;
+            }
         }
+    }
 
-        Type type = static_cast<Type>(static_cast<uint32_t>(rxMessage->state) >> 24);
+    //a full budget means the device is ahead of us: only the latest value of
+    // each update gets displayed and the rest waits for the next pass, so a
+    // flood never keeps the event loop from painting or handling input
+    if(RX_BUDGET == read) {
+        const int kept {coalesceUpdates(rxBatch, count)};
+        rxCoalesced += static_cast<quint64>(count - kept);
+        count = kept;
+        if(!rxDrainQueued) {
+            rxDrainQueued = true;
+            QTimer::singleShot(0, this, SLOT(drainRx()));
+        }
+    }
+    else if(rxCoalesced) {
+        qDebug() << "rx overload over," << rxCoalesced << "updates coalesced";
+        rxCoalesced = 0;
+    }
+    //what is left was read off the socket already, no readyRead() follows
+    if(handshake && !rxDrainQueued) {
+        rxDrainQueued = true;
+        QTimer::singleShot(0, this, SLOT(drainRx()));
+    }
 
-        switch(type) {
+    for(int i {0}; i < count; ++i) {
+        const MicrowaveMsgFormat::Message& msg {rxBatch[i]};
+        perfType = PerfTypeOf(msg);
+        PerfScope scope(perf, PerfSection::DISPATCH, perfType);
+        switch(static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
         case Type::STATE:
-            handleState(*rxMessage);
+            handleState(msg);
             break;
         case Type::SIGNAL:
-            handleSignal(*rxMessage);
+            handleSignal(msg);
             break;
         case Type::UPDATE:
-            handleUpdate(*rxMessage);
+            handleUpdate(msg);
             break;
         }
-
-        //remove used data
-        rxBuf = rxBuf.right(rxBuf.size() - MessageSize);
+        present();
+        txScheduler->acknowledge(msg);
+        session->dispatch(msg);
     }
+    perfType = PerfNoType;
+    //the batch may have started a countdown, an overlay or a local blink
+    armCoreTimer();
+}
+
+void Microwave::drainRx()
+{
+    rxDrainQueued = false;
+    onReadyRead();
 }
 
-void Microwave::onBytesWritten(qint64 bytes)
+void Microwave::dumpPerf()
 {
-    qDebug() << bytes << "written to" << socket->peerAddress();
+    if(perf) {
+        qDebug().noquote() << QString::fromStdString(perf->report());
+    }
 }
 
 void Microwave::handleState(const MicrowaveMsgFormat::Message &msg)
+{
+    stateCache->storeState(msg.state);
+    setStale(false);
+    //only the first reply moves the core out of InitialState
+    core->process(msg, now());
+}
+
+void Microwave::handleSignal(const MicrowaveMsgFormat::Message &msg)
 {
     using namespace MicrowaveMsgFormat;
-    switch(msg.state) {
-    case State::DISPLAY_CLOCK:
-        emit state_req_display_clock();
-        break;
-    case State::CLOCK_SELECT_HOUR_TENS:
-        emit state_req_clock_select_left_tens();
-        break;
-    case State::CLOCK_SELECT_HOUR_ONES:
-        emit state_req_clock_select_left_ones();
-        break;
-    case State::CLOCK_SELECT_MINUTE_TENS:
-        emit state_req_clock_select_right_tens();
-        break;
-    case State::CLOCK_SELECT_MINUTE_ONES:
-        emit state_req_clock_select_right_ones();
-        break;
-    case State::SET_COOK_TIMER:
-        emit state_req_set_cook_timer();
-        break;
-    case State::SET_POWER_LEVEL:
-        emit state_req_set_power_level();
-        break;
-    case State::KITCHEN_SELECT_HOUR_TENS:
-        emit state_req_kitchen_select_left_tens();
-        break;
-    case State::KITCHEN_SELECT_HOUR_ONES:
-        emit state_req_kitchen_select_left_ones();
-        break;
-    case State::KITCHEN_SELECT_MINUTE_TENS:
-        emit state_req_kitchen_select_right_tens();
-        break;
-    case State::KITCHEN_SELECT_MINUTE_ONES:
-        emit state_req_kitchen_select_right_ones();
-        break;
-    case State::DISPLAY_TIMER:
-        emit state_req_display_timer();
-        break;
-    case State::NONE:
-        break;
+    //device blinks are smoothed before they reach the core, unless the core
+    // blinks on its own and a stray frame only re-anchors it
+    if((Signal::BLINK_ON == msg.signal || Signal::BLINK_OFF == msg.signal) && !core->isLocalBlink()) {
+        blinkEngine->onDeviceBlink(Signal::BLINK_ON == msg.signal);
+        return;
     }
+    core->process(msg, now());
 }
 
-void Microwave::handleSignal(const MicrowaveMsgFormat::Message &msg)
+void Microwave::handleUpdate(const MicrowaveMsgFormat::Message &msg)
+{
+    core->process(msg, now());
+    if(MicrowaveMsgFormat::Update::POWER_LEVEL == msg.update) {
+        stateCache->storePowerLevel(core->powerLevel());
+    }
+}
+
+void Microwave::stateChanged(const MicrowaveMsgFormat::CoreState from, const MicrowaveMsgFormat::CoreState to)
 {
     using namespace MicrowaveMsgFormat;
-    switch(msg.signal) {
-    case Signal::CLOCK:
-        emit clock_sig();
+    qDebug() << "state" << CoreStateName(from) << "->" << CoreStateName(to);
+
+    //digit keys edit the clock while it is set and the timer otherwise, the
+    // states that echo them say where a digit lands
+    DigitPredictor::Mode mode {DigitPredictor::Mode::OFF};
+    switch(to) {
+    case CoreState::SET_CLOCK:
+        editedStream = TimeStream::CLOCK;
         break;
-    case Signal::COOK_TIME:
-        emit cook_time_sig();
+    case CoreState::CLOCK_SELECT_HOUR_TENS:
+        editedStream = TimeStream::CLOCK;
+        mode = DigitPredictor::Mode::LEFT_TENS;
         break;
-    case Signal::POWER_LEVEL:
-        emit power_level_sig();
+    case CoreState::CLOCK_SELECT_HOUR_ONES:
+        editedStream = TimeStream::CLOCK;
+        mode = DigitPredictor::Mode::LEFT_ONES;
         break;
-    case Signal::KITCHEN_TIMER:
-        emit kitchen_timer_sig();
+    case CoreState::CLOCK_SELECT_MINUTE_TENS:
+        editedStream = TimeStream::CLOCK;
+        mode = DigitPredictor::Mode::RIGHT_TENS;
         break;
-    case Signal::STOP:
-        emit stop_sig();
+    case CoreState::CLOCK_SELECT_MINUTE_ONES:
+        editedStream = TimeStream::CLOCK;
+        mode = DigitPredictor::Mode::RIGHT_ONES;
         break;
-    case Signal::START:
-        emit start_sig();
+    case CoreState::SET_COOK_TIMER:
+        editedStream = TimeStream::DISPLAY_TIMER;
+        mode = DigitPredictor::Mode::SHIFT;
         break;
-    case Signal::BLINK_ON:
-        emit blink_sig(true);
+    case CoreState::SET_KITCHEN_TIMER:
+        editedStream = TimeStream::DISPLAY_TIMER;
         break;
-    case Signal::BLINK_OFF:
-        emit blink_sig(false);
+    case CoreState::KITCHEN_SELECT_MINUTE_TENS:
+        editedStream = TimeStream::DISPLAY_TIMER;
+        mode = DigitPredictor::Mode::LEFT_TENS;
         break;
-    case Signal::MOD_LEFT_TENS:
-        emit select_left_tens_sig();
+    case CoreState::KITCHEN_SELECT_MINUTE_ONES:
+        editedStream = TimeStream::DISPLAY_TIMER;
+        mode = DigitPredictor::Mode::LEFT_ONES;
         break;
-    case Signal::MOD_LEFT_ONES:
-        emit select_left_ones_sig();
+    case CoreState::KITCHEN_SELECT_SECOND_TENS:
+        editedStream = TimeStream::DISPLAY_TIMER;
+        mode = DigitPredictor::Mode::RIGHT_TENS;
         break;
-    case Signal::MOD_RIGHT_TENS:
-        emit select_right_tens_sig();
-        break;
-    case Signal::MOD_RIGHT_ONES:
-        emit select_right_ones_sig();
+    case CoreState::KITCHEN_SELECT_SECOND_ONES:
+        editedStream = TimeStream::DISPLAY_TIMER;
+        mode = DigitPredictor::Mode::RIGHT_ONES;
         break;
     default:
         break;
     }
+    setPredictorMode(mode);
 }
 
-void Microwave::handleUpdate(const MicrowaveMsgFormat::Message &msg)
+void Microwave::timeReceived(const MicrowaveMsgFormat::Time &received, const MicrowaveMsgFormat::TimeStream stream,
+                             MicrowaveMsgFormat::Time &shown)
 {
-    using namespace MicrowaveMsgFormat;
-    switch(msg.update) {
-    case Update::CLOCK:
-            time->left_tens = static_cast<uint32_t>(msg.data[0] - '0');
-            time->left_ones = static_cast<uint32_t>(msg.data[1] - '0');
-            time->right_tens = static_cast<uint32_t>(msg.data[2] - '0');
-            time->right_ones = static_cast<uint32_t>(msg.data[3] - '0');
-        if(!disableClockDisplay) {
-            displayTime();
-        }
-        break;
-    case Update::DISPLAY_TIMER:
-            time->left_tens = static_cast<uint32_t>(msg.data[0] - '0');
-            time->left_ones = static_cast<uint32_t>(msg.data[1] - '0');
-            time->right_tens = static_cast<uint32_t>(msg.data[2] - '0');
-            time->right_ones = static_cast<uint32_t>(msg.data[3] - '0');
-        if(!disableDisplayTimer) {
-            displayTime();
-        }
-        break;
-    case Update::POWER_LEVEL:
-        powerLevel = static_cast<uint32_t>(((msg.data[0] - '0') * 10) + (msg.data[1] - '0'));
-        if(!disablePowerLevel) {
-            displayPowerLevel();
+    //digits echoed locally and not yet answered stay on top of an update of
+    // the value being edited; the other stream, like a minute tick while a
+    // cook time is entered, neither confirms nor displaces them
+    if(stream == editedStream) {
+        predictor->reconcile(received, shown);
+        if(!predictor->isPending()) {
+            TimerService::instance()->stop(digitEchoTimer);
         }
-        break;
-    case Update::NONE:
-        break;
     }
+    else if(!predictor->isPending()) {
+        shown = received;
+    }
+    stateCache->storeTime(received);
+}
+
+quint64 Microwave::now() const
+{
+    return static_cast<quint64>(TimerService::instance()->elapsed());
+}
+
+void Microwave::armCoreTimer()
+{
+    //one wheel timer for whatever the core has due first: a countdown tick,
+    // the end of the power level overlay or a local blink edge
+    uint64_t due {};
+    if(!core->nextTimeout(due)) {
+        TimerService::instance()->stop(coreTimer);
+        return;
+    }
+    const quint64 current {now()};
+    TimerService::instance()->start(coreTimer, due > current ? static_cast<int>(due - current) : 0, [this]() {
+        core->advance(now());
+        present();
+        armCoreTimer();
+    });
+}
+
+void Microwave::onBlink(const bool on)
+{
+    core->blink(on, now());
+    present();
 }
 
 void Microwave::writeData()
 {
-    //swap from host to network byte order
-    MicrowaveMsgFormat::Message message {ByteSwapMessage(*txMessage)};
-    txBuf.append(reinterpret_cast<char*>(&message), sizeof(MicrowaveMsgFormat::Message));
-    if(socket->state() == QAbstractSocket::ConnectedState) {
-        const qint64 count {socket->write(txBuf)};
-        if(-1 == count) {
-            qDebug() << "Error occurred while writing data";
-        }
+    if(capture) {
+        capture->writeTx(*txMessage);
     }
-    txBuf.clear();
+    txScheduler->send(*txMessage);
 }
+
 void Microwave::sendTimeCook()
 {
     qDebug() << "time cook";
@@ -653,170 +603,118 @@ void Microwave::sendClock()
 
 void Microwave::send0()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_0;
-    writeData();
+    sendDigit(0);
 }
 
 void Microwave::send1()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_1;
-    writeData();
+    sendDigit(1);
 }
 
 void Microwave::send2()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_2;
-    writeData();
+    sendDigit(2);
 }
 
 void Microwave::send3()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_3;
-    writeData();
+    sendDigit(3);
 }
 
 void Microwave::send4()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_4;
-    writeData();
+    sendDigit(4);
 }
 
 void Microwave::send5()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_5;
-    writeData();
+    sendDigit(5);
 }
 
 void Microwave::send6()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_6;
-    writeData();
+    sendDigit(6);
 }
 
 void Microwave::send7()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_7;
-    writeData();
+    sendDigit(7);
 }
 
 void Microwave::send8()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_8;
-    writeData();
+    sendDigit(8);
 }
 
 void Microwave::send9()
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::DIGIT_9;
-    writeData();
-}
-
-void Microwave::sendStop()
-{
-    txMessage->signal = MicrowaveMsgFormat::Signal::STOP;
-    writeData();
-}
-
-void Microwave::sendStart()
-{
-    txMessage->signal = MicrowaveMsgFormat::Signal::START;
-    writeData();
+    sendDigit(9);
 }
 
-void Microwave::SendStateRequest()
+void Microwave::sendDigit(const quint32 digit)
 {
-    txMessage->signal = MicrowaveMsgFormat::Signal::STATE_REQUEST;
+    txMessage->signal = static_cast<MicrowaveMsgFormat::Signal>(
+        static_cast<uint32_t>(MicrowaveMsgFormat::Signal::DIGIT_0) + digit);
     writeData();
-}
-
-void Microwave::displayTime()
-{
-    ui->left_tens->setText(QString::number(time->left_tens));
-    ui->left_ones->setText(QString::number(time->left_ones));
-    ui->right_tens->setText(QString::number(time->right_tens));
-    ui->right_ones->setText(QString::number(time->right_ones));
-
-    ui->colon->setText(":");
-}
-
-void Microwave::displayPowerLevel()
-{
-    ui->left_tens->setText("P");
-    ui->left_ones->setText("L");
-    const quint32 left_digit {powerLevel / 10};
-    ui->right_tens->setText(1 == left_digit ? QString::number(left_digit) : "");
-    ui->right_ones->setText(QString::number(powerLevel % 10));
-    ui->colon->setText("");
-}
-
-void Microwave::startDisplayPowerLevel2Sec()
-{
-    static const qint32 twoSec {2000};
-    disconnect(this, SIGNAL(power_level_sig()), this, SLOT(startDisplayPowerLevel2Sec()));
-    connect(timer, SIGNAL(timeout()), this, SLOT(stopDisplayPowerLevel2Sec()));
-    disableDisplayTimer = true;
-    disablePowerLevel = false;
-    timer->setSingleShot(true);
-    timer->start(twoSec);
-    displayPowerLevel();
-}
-
-void Microwave::stopDisplayPowerLevel2Sec()
-{
-    timer->stop();
-    disconnect(timer, SIGNAL(timeout()), this, SLOT(stopDisplayPowerLevel2Sec()));
-    disableDisplayTimer = false;
-    disablePowerLevel = true;
-    displayTime();
-    connect(this, SIGNAL(power_level_sig()), this, SLOT(startDisplayPowerLevel2Sec()));
-}
 
-void Microwave::blink_colon(const bool flag)
-{
-    ui->colon->setText(flag ? ":" : "");
+    //show the digit now instead of a round trip later
+    MicrowaveMsgFormat::Time shown {core->currentTime()};
+    if(predictor->predict(digit, shown)) {
+        showPrediction(shown);
+        TimerService::instance()->start(digitEchoTimer, DIGIT_ECHO_TIMEOUT_MS, [this]() {
+            MicrowaveMsgFormat::Time confirmed {core->currentTime()};
+            if(predictor->expire(confirmed)) {
+                showPrediction(confirmed);
+            }
+        });
+    }
+    else if(predictor->expire(shown)) {
+        //too far ahead of the device, back to what it last confirmed
+        TimerService::instance()->stop(digitEchoTimer);
+        showPrediction(shown);
+    }
 }
 
-void Microwave::blink_left_tens(const bool flag)
+void Microwave::setPredictorMode(const DigitPredictor::Mode mode)
 {
-    ui->left_tens->setText(flag ? QString::number(time->left_tens) : "");
+    //predictions left behind by the state just left are rolled back
+    MicrowaveMsgFormat::Time shown {core->currentTime()};
+    if(predictor->setMode(mode, shown)) {
+        TimerService::instance()->stop(digitEchoTimer);
+        showPrediction(shown);
+    }
 }
 
-void Microwave::blink_left_ones(const bool flag)
+void Microwave::showPrediction(const MicrowaveMsgFormat::Time &shown)
 {
-    ui->left_ones->setText(flag ? QString::number(time->left_ones) : "");
+    core->showTime(shown);
+    present();
 }
 
-void Microwave::blink_right_tens(const bool flag)
+void Microwave::sendStop()
 {
-    ui->right_tens->setText(flag ? QString::number(time->right_tens) : "");
+    txMessage->signal = MicrowaveMsgFormat::Signal::STOP;
+    writeData();
 }
 
-void Microwave::blink_right_ones(const bool flag)
+void Microwave::sendStart()
 {
-    ui->right_ones->setText(flag ? QString::number(time->right_ones) : "");
+    txMessage->signal = MicrowaveMsgFormat::Signal::START;
+    writeData();
 }
 
-void Microwave::blink_power_level(const bool flag)
+//pushes the glyphs that changed since the last call to their labels
+void Microwave::present()
 {
-    if(flag) {
-        displayPowerLevel();
-    }
-    else {
-        ui->colon->setText("");
-        ui->left_tens->setText("");
-        ui->left_ones->setText("");
-        ui->right_tens->setText("");
-        ui->right_ones->setText("");
+    using namespace MicrowaveMsgFormat;
+    //refreshes outside onReadyRead() are blink and timeout driven
+    PerfScope scope(perf, PerfSection::DISPLAY, perfType);
+    const DisplayFrame& frame {core->frame()};
+    for(size_t i {0}; i < GlyphCount; ++i) {
+        const char glyph {frame.glyphs[i]};
+        if(glyph != shownFrame->glyphs[i]) {
+            glyphLabels[i]->setText(BlankGlyph == glyph ? QString() : QString(QChar(glyph)));
+            shownFrame->glyphs[i] = glyph;
+        }
     }
 }
-
-void Microwave::clock_done()
-{
-    emit clock_done_sig();
-}
-
-void Microwave::onStateRequestTimeout()
-{
-    SendStateRequest();
-}
-
@@ -1,26 +1,35 @@
 #ifndef MICROWAVE_H
 #define MICROWAVE_H
 
+#include "timingwheel.h"
+#include "digitpredictor.h"
+#include "MicrowaveProtocolCore.h"
+
 #include <QMainWindow>
-#include <QByteArray>
 
 //forward declarations
-class QTcpSocket;
-class QStateMachine;
-class QSignalTransition;
-class QState;
-class QTimer;
+class Transport;
+class TxScheduler;
+class DeviceSession;
+class SessionTask;
+class BlinkEngine;
+class StateCache;
+class CaptureWriter;
+class QLabel;
 
 namespace MicrowaveMsgFormat {
-class Time;
-class Message;
+class PerfProfile;
 }
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Microwave; }
 QT_END_NAMESPACE
 
-class Microwave : public QMainWindow
+//The window of the microwave. Its state machine, display gating and
+// countdown live in a ProtocolCore, the very code replay and the tools
+// run; this class feeds it the device's messages and the clock and shows
+// the frame it renders.
+class Microwave : public QMainWindow, private MicrowaveMsgFormat::ProtocolCore::Listener
 {
     Q_OBJECT
 
@@ -28,97 +37,71 @@ public:
     Microwave(QWidget *parent = nullptr);
     ~Microwave();
 
-signals:
-    //signals mapped to rx Signal from the dev board
-    void clock_sig();
-    void cook_time_sig();
-    void power_level_sig();
-    void kitchen_timer_sig();
-    void stop_sig();
-    void start_sig();
-    void blink_sig(bool);
-    void select_left_tens_sig();
-    void select_left_ones_sig();
-    void select_right_tens_sig();
-    void select_right_ones_sig();
-
-    //signals generated from the response of the STATE_REQUEST tx signal
-    void state_req_display_clock();
-    void state_req_clock_select_left_tens();
-    void state_req_clock_select_left_ones();
-    void state_req_clock_select_right_tens();
-    void state_req_clock_select_right_ones();
-    void state_req_set_cook_timer();
-    void state_req_set_power_level();
-    void state_req_kitchen_select_left_tens();
-    void state_req_kitchen_select_left_ones();
-    void state_req_kitchen_select_right_tens();
-    void state_req_kitchen_select_right_ones();
-    void state_req_display_timer();
-
-    //signals that result from handling other signals
-    void clock_done_sig();
-    void display_timer_done_sig();
-
 private:
     Ui::Microwave *ui;
-    QTcpSocket* socket;
-    QByteArray txBuf;
-    QByteArray rxBuf;
-    QTimer* timer;
+    Transport* transport;
+    TxScheduler* txScheduler;
+    DeviceSession* session;
+    BlinkEngine* blinkEngine;
+    MicrowaveMsgFormat::ProtocolCore* core;
+
+    //timeouts served by the shared TimerService wheel
+    TimingWheel::Timer coreTimer;
+    TimingWheel::Timer reconnectTimer;
+    TimingWheel::Timer digitEchoTimer;
+    int reconnectDelay;
 
     MicrowaveMsgFormat::Message* txMessage;
-    MicrowaveMsgFormat::Message* rxMessage;
-    MicrowaveMsgFormat::Time* time;
-    quint32 powerLevel;
-    bool disableClockDisplay;
-    bool disableDisplayTimer;
-    bool disablePowerLevel;
-
-    QStateMachine* sm;
-    QState* InitialState;
-    QState* DisplayClock;
-      QState* DisplayClockInit;
-      QState* SetClock;
-        QState* SetClockInit;
-        QState* ClockSelectHourTens;
-        QState* ClockSelectHourOnes;
-        QState* ClockSelectMinuteTens;
-        QState* ClockSelectMinuteOnes;
-    QState* SetCookTimer;
-      QState* SetCookTimerInit;
-    QState* SetPowerLevel;
-      QState* SetPowerLevelInit;
-    QState* SetKitchenTimer;
-      QState* SetKitchenTimerInit;
-      QState* KitchenSelectMinuteTens;
-      QState* KitchenSelectMinuteOnes;
-      QState* KitchenSelectSecondTens;
-      QState* KitchenSelectSecondOnes;
-    QState* DisplayTimer;
-      QState* DisplayTimerInit;
-
-    QSignalTransition* SetCookTimerTransition;
-    QSignalTransition* SetKitchenTimerTransition;
-    QSignalTransition* DisplayTimerTransition;
-
-    void SetupDisplayClockState(QState* parent = Q_NULLPTR);
-    void SetupSetCookTimerState(QState* parent = Q_NULLPTR);
-    void SetupSetPowerLevelState(QState* parent = Q_NULLPTR);
-    void SetupSetKitchenTimerState(QState* parent = Q_NULLPTR);
-    void SetupDisplayTimerState(QState* parent = Q_NULLPTR);
+    //one onReadyRead() pass worth of rx messages
+    MicrowaveMsgFormat::Message* rxBatch;
+    bool rxDrainQueued;
+    quint64 rxCoalesced;
+    StateCache* stateCache;
+    CaptureWriter* capture;
+    DigitPredictor* predictor;
+    //the stream digit keys edit in the current entry state
+    MicrowaveMsgFormat::TimeStream editedStream;
+    //receive path counters, only with MICROWAVE_PERF set
+    MicrowaveMsgFormat::PerfProfile* perf;
+    //Type of the message being dispatched, what a display refresh is charged to
+    size_t perfType;
+    //display shows cached or pre-disconnect values until the device confirms
+    bool stale;
+    bool requestingState;
+
+    //what the labels currently show
+    MicrowaveMsgFormat::DisplayFrame* shownFrame;
+    QLabel* glyphLabels[5];
 
     void handleState(const MicrowaveMsgFormat::Message& txMessage);
     void handleSignal(const MicrowaveMsgFormat::Message& txMessage);
     void handleUpdate(const MicrowaveMsgFormat::Message& txMessage);
 
+    //ProtocolCore::Listener
+    void stateChanged(const MicrowaveMsgFormat::CoreState from, const MicrowaveMsgFormat::CoreState to) override;
+    void timeReceived(const MicrowaveMsgFormat::Time& received, const MicrowaveMsgFormat::TimeStream stream,
+                      MicrowaveMsgFormat::Time& shown) override;
+
+    quint64 now() const;
+    void armCoreTimer();
+    void setPredictorMode(const DigitPredictor::Mode mode);
+    void showPrediction(const MicrowaveMsgFormat::Time& shown);
     void writeData();
+    void sendDigit(const quint32 digit);
+
+    void present();
+    void restoreCachedState();
+    void setStale(const bool flag);
+
+    SessionTask requestState();
+    SessionTask negotiateCapabilities();
 
 private slots:
-    void onTcpConnect();
-    void onTcpDisconnect();
+    void onTransportConnect();
+    void onTransportDisconnect();
     void onReadyRead();
-    void onBytesWritten(qint64 bytes);
+    void drainRx();
+    void dumpPerf();
 
     void sendTimeCook();
     void sendPowerLevel();
@@ -136,53 +119,7 @@ private slots:
     void send9();
     void sendStop();
     void sendStart();
-    void SendStateRequest();
-
-    void displayTime();
-    void displayPowerLevel();
-    void startDisplayPowerLevel2Sec();
-    void stopDisplayPowerLevel2Sec();
-
-    void onStateRequestTimeout();
-
-    //slots for blinking stuff
-    void blink_colon(const bool flag);
-    void blink_left_tens(const bool flag);
-    void blink_left_ones(const bool flag);
-    void blink_right_tens(const bool flag);
-    void blink_right_ones(const bool flag);
-    void blink_power_level(const bool flag);
-
-    void clock_done();
-
-    void InitialStateEntry();
-    void InitialStateExit();
-
-    void DisplayClockInitEntry();
-    void DisplayClockInitExit();
-
-    void SetClockEntry();
-    void SetClockExit();
-
-    void SelectLeftTensEntry();
-    void SelectLeftTensExit();
-
-    void SelectLeftOnesEntry();
-    void SelectLeftOnesExit();
-
-    void SelectRightTensEntry();
-    void SelectRightTensExit();
-
-    void SelectRightOnesEntry();
-    void SelectRightOnesExit();
-
-    void SetCookTimerEntry();
-    void SetCookTimerExit();
-
-    void SetPowerLevelEntry();
-    void SetPowerLevelExit();
 
-    void DisplayTimerInitEntry();
-    void DisplayTimerInitExit();
+    void onBlink(const bool on);
 };
 #endif // MICROWAVE_H
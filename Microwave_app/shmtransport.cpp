@@ -0,0 +1,175 @@
+#include "shmtransport.h"
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveShmRing.h"
+
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include <initializer_list>
+
+#include <sys/un.h>
+
+ShmTransport::ShmTransport(const QString& socketPath, QObject *parent)
+    : Transport(parent)
+    , socketPath{socketPath}
+    , sock{-1}
+    , memFd{-1}
+    , toAppFd{-1}
+    , toDevFd{-1}
+    , region{Q_NULLPTR}
+    , rxNotifier{Q_NULLPTR}
+    , hangupNotifier{Q_NULLPTR}
+{
+}
+
+ShmTransport::~ShmTransport()
+{
+    release();
+}
+
+void ShmTransport::open()
+{
+    using namespace MicrowaveMsgFormat;
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    const QByteArray path {socketPath.toLocal8Bit()};
+    strncpy(addr.sun_path, path.constData(), sizeof(addr.sun_path) - 1);
+
+    int fds[SHM_FD_COUNT] {-1, -1, -1};
+    if(-1 == sock ||
+       -1 == ::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+       !ReceiveShmFds(sock, fds)) {
+        qDebug() << "shm transport: unable to attach to" << socketPath;
+        release();
+        emit disconnected();
+        return;
+    }
+    memFd = fds[SHM_FD_MEMORY];
+    toAppFd = fds[SHM_FD_TO_APP];
+    toDevFd = fds[SHM_FD_TO_DEV];
+
+    void* mapped {mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0)};
+    if(MAP_FAILED == mapped) {
+        qDebug() << "shm transport: mmap failed";
+        release();
+        emit disconnected();
+        return;
+    }
+    region = static_cast<ShmRegion*>(mapped);
+    if(ShmMagic != region->magic || ShmVersion != region->version) {
+        qDebug() << "shm transport: incompatible region";
+        release();
+        emit disconnected();
+        return;
+    }
+
+    rxNotifier = new QSocketNotifier(toAppFd, QSocketNotifier::Read, this);
+    hangupNotifier = new QSocketNotifier(sock, QSocketNotifier::Read, this);
+    connect(rxNotifier, SIGNAL(activated(int)), this, SLOT(onRxEvent()));
+    connect(hangupNotifier, SIGNAL(activated(int)), this, SLOT(onSocketEvent()));
+
+    qDebug() << "shm transport connected";
+    emit connected();
+
+    //records may have been queued before we attached
+    if(region->toApp.front()) {
+        emit readyRead();
+    }
+}
+
+void ShmTransport::close()
+{
+    const bool wasConnected {isConnected()};
+    release();
+    if(wasConnected) {
+        qDebug() << "shm transport disconnected";
+        emit disconnected();
+    }
+}
+
+void ShmTransport::release()
+{
+    //close() runs from the notifiers' own activated() slots, so they must
+    // outlive this pass; disabled they no longer see the fds closed below
+    for(QSocketNotifier* notifier : {rxNotifier, hangupNotifier}) {
+        if(notifier) {
+            notifier->setEnabled(false);
+            notifier->deleteLater();
+        }
+    }
+    rxNotifier = Q_NULLPTR;
+    hangupNotifier = Q_NULLPTR;
+
+    if(region) {
+        munmap(region, sizeof(MicrowaveMsgFormat::ShmRegion));
+        region = Q_NULLPTR;
+    }
+    for(int* fd : {&sock, &memFd, &toAppFd, &toDevFd}) {
+        if(-1 != *fd) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+bool ShmTransport::isConnected() const
+{
+    return Q_NULLPTR != rxNotifier;
+}
+
+QString ShmTransport::endpoint() const
+{
+    return socketPath;
+}
+
+bool ShmTransport::readMessage(MicrowaveMsgFormat::Message &msg)
+{
+    if(!isConnected()) {
+        return false;
+    }
+    const MicrowaveMsgFormat::Message* record {region->toApp.front()};
+    if(!record) {
+        return false;
+    }
+    //records are already in host byte order, take it straight out of the ring
+    msg = *record;
+    region->toApp.pop();
+    return true;
+}
+
+bool ShmTransport::writeMessage(const MicrowaveMsgFormat::Message &msg)
+{
+    if(!isConnected()) {
+        return false;
+    }
+    MicrowaveMsgFormat::Message* slot {region->toDev.claim()};
+    if(!slot) {
+        qDebug() << "shm transport: tx ring full, message dropped";
+        return false;
+    }
+    *slot = msg;
+    if(region->toDev.publish()) {
+        MicrowaveMsgFormat::KickEventFd(toDevFd);
+    }
+    return true;
+}
+
+bool ShmTransport::canWrite() const
+{
+    //the device does not signal when it drains toDev, callers poll
+    return isConnected() && region->toDev.size() < MicrowaveMsgFormat::ShmRingCapacity;
+}
+
+void ShmTransport::onRxEvent()
+{
+    MicrowaveMsgFormat::DrainEventFd(toAppFd);
+    emit readyRead();
+}
+
+void ShmTransport::onSocketEvent()
+{
+    //the hand-off socket carries no data after the fds, so readable means hangup
+    close();
+}
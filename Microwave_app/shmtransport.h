@@ -0,0 +1,51 @@
+#ifndef SHMTRANSPORT_H
+#define SHMTRANSPORT_H
+
+#include "transport.h"
+
+#include <QString>
+
+class QSocketNotifier;
+
+namespace MicrowaveMsgFormat {
+struct ShmRegion;
+}
+
+// Shared-memory ring transport for a device or simulator on the same host.
+// See MicrowaveShmRing.h for the region layout and the fd hand-off.
+class ShmTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    explicit ShmTransport(const QString& socketPath, QObject *parent = nullptr);
+    ~ShmTransport();
+
+    void open() override;
+    void close() override;
+    bool isConnected() const override;
+    QString endpoint() const override;
+
+    bool readMessage(MicrowaveMsgFormat::Message& msg) override;
+    bool writeMessage(const MicrowaveMsgFormat::Message& msg) override;
+    bool canWrite() const override;
+
+private:
+    QString socketPath;
+    int sock;
+    int memFd;
+    int toAppFd;
+    int toDevFd;
+    MicrowaveMsgFormat::ShmRegion* region;
+
+    QSocketNotifier* rxNotifier;
+    QSocketNotifier* hangupNotifier;
+
+    void release();
+
+private slots:
+    void onRxEvent();
+    void onSocketEvent();
+};
+
+#endif // SHMTRANSPORT_H
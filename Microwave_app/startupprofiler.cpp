@@ -0,0 +1,69 @@
+#include "startupprofiler.h"
+
+#include <QDebug>
+#include <QEvent>
+#include <QWidget>
+
+namespace {
+
+const char* const MILESTONE_NAMES[] {
+    "transport opened",
+    "ui built",
+    "state machine started",
+    "first paint",
+    "first valid display",
+};
+
+}
+
+StartupProfiler* StartupProfiler::instance()
+{
+    //outlives the application object, so it has no parent
+    static StartupProfiler profiler;
+    return &profiler;
+}
+
+StartupProfiler::StartupProfiler()
+    : QObject(Q_NULLPTR)
+    , clock{}
+    , reached{}
+{
+    clock.start();
+    for(qint64& ms : reached) {
+        ms = -1;
+    }
+}
+
+void StartupProfiler::reach(const Milestone milestone)
+{
+    qint64& ms {reached[static_cast<int>(milestone)]};
+    if(-1 != ms) {
+        return;
+    }
+    ms = clock.elapsed();
+    qDebug() << "startup:" << MILESTONE_NAMES[static_cast<int>(milestone)] << "at" << ms << "ms";
+
+    if(Milestone::FIRST_VALID_DISPLAY == milestone) {
+        qDebug() << "startup: time to first paint" << elapsed(Milestone::FIRST_PAINT)
+                 << "ms, time to first valid display" << ms << "ms";
+    }
+}
+
+void StartupProfiler::watchFirstPaint(QWidget *window)
+{
+    window->installEventFilter(this);
+}
+
+qint64 StartupProfiler::elapsed(const Milestone milestone) const
+{
+    return reached[static_cast<int>(milestone)];
+}
+
+bool StartupProfiler::eventFilter(QObject *watched, QEvent *event)
+{
+    if(QEvent::Paint == event->type()) {
+        watched->removeEventFilter(this);
+        reach(Milestone::FIRST_PAINT);
+    }
+    return QObject::eventFilter(watched, event);
+}
@@ -0,0 +1,46 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+
+class QWidget;
+
+// Cold-start milestones, measured from the top of main().
+//
+// Each milestone is logged the first time it is reached. Once the display
+// has shown device-confirmed values a one-line summary with time to first
+// paint and time to first valid display is logged.
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Milestone {
+        TRANSPORT_OPENED,       // connection attempt started
+        UI_BUILT,               // setupUi() done
+        STATE_MACHINE_STARTED,
+        FIRST_PAINT,            // first paint of the main window
+        FIRST_VALID_DISPLAY,    // display confirmed by the device
+        COUNT
+    };
+
+    //the first call starts the clock, call it first thing in main()
+    static StartupProfiler* instance();
+
+    void reach(const Milestone milestone);
+    void watchFirstPaint(QWidget* window);
+
+    qint64 elapsed(const Milestone milestone) const;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    StartupProfiler();
+
+    QElapsedTimer clock;
+    qint64 reached[static_cast<int>(Milestone::COUNT)];
+};
+
+#endif // STARTUPPROFILER_H
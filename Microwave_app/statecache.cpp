@@ -0,0 +1,140 @@
+#include "statecache.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+#include <atomic>
+
+namespace {
+
+const quint32 CACHE_MAGIC {0x4D636368}; // "Mcch"
+const quint32 CACHE_VERSION {1};
+
+QString cachePath(const QString& endpoint)
+{
+    QString name {endpoint};
+    for(QChar& c : name) {
+        if(!c.isLetterOrNumber()) {
+            c = '_';
+        }
+    }
+    const QString dir {QStandardPaths::writableLocation(QStandardPaths::CacheLocation)};
+    QDir().mkpath(dir);
+    return dir + "/state-" + name + ".cache";
+}
+
+}
+
+//layout of the mapped file, host byte order since it never leaves the machine
+struct StateCache::Record
+{
+    quint32 magic;
+    quint32 version;
+    std::atomic<quint32> sequence;  // odd while a write is in progress
+    quint32 valid;                  // set once a State has been stored
+    MicrowaveMsgFormat::State state;
+    MicrowaveMsgFormat::Time time;
+    quint32 powerLevel;
+    qint64 savedAtMs;
+};
+
+StateCache::StateCache(const QString &endpoint)
+    : file{new QFile(cachePath(endpoint))}
+    , record{Q_NULLPTR}
+{
+    if(!file->open(QIODevice::ReadWrite)) {
+        qDebug() << "state cache unavailable:" << file->errorString();
+        return;
+    }
+
+    const bool fresh {file->size() != static_cast<qint64>(sizeof(Record))};
+    if(fresh && !file->resize(sizeof(Record))) {
+        qDebug() << "state cache unavailable:" << file->errorString();
+        return;
+    }
+
+    //the mapping stays valid for as long as file is open
+    record = reinterpret_cast<Record*>(file->map(0, sizeof(Record)));
+    if(!record) {
+        qDebug() << "state cache unavailable:" << file->errorString();
+        return;
+    }
+
+    //an odd sequence at rest is a write torn by a crash, its fields are mixed
+    if(fresh || CACHE_MAGIC != record->magic || CACHE_VERSION != record->version ||
+       (record->sequence.load(std::memory_order_relaxed) & 1)) {
+        memset(static_cast<void*>(record), 0, sizeof(Record));
+        record->magic = CACHE_MAGIC;
+        record->version = CACHE_VERSION;
+    }
+}
+
+StateCache::~StateCache()
+{
+    delete file;
+}
+
+bool StateCache::isOpen() const
+{
+    return Q_NULLPTR != record;
+}
+
+bool StateCache::load(Snapshot &snapshot) const
+{
+    if(!record || !record->valid || (record->sequence.load(std::memory_order_acquire) & 1)) {
+        return false;
+    }
+    snapshot.state = record->state;
+    snapshot.time = record->time;
+    snapshot.powerLevel = record->powerLevel;
+    snapshot.savedAtMs = record->savedAtMs;
+    return MicrowaveMsgFormat::IsValidValue(static_cast<uint32_t>(snapshot.state));
+}
+
+void StateCache::storeState(const MicrowaveMsgFormat::State state)
+{
+    if(!record || MicrowaveMsgFormat::State::NONE == state) {
+        return;
+    }
+    beginWrite();
+    record->state = state;
+    record->valid = 1;
+    endWrite();
+}
+
+void StateCache::storeTime(const MicrowaveMsgFormat::Time &time)
+{
+    if(!record) {
+        return;
+    }
+    beginWrite();
+    record->time = time;
+    endWrite();
+}
+
+void StateCache::storePowerLevel(const quint32 powerLevel)
+{
+    if(!record) {
+        return;
+    }
+    beginWrite();
+    record->powerLevel = powerLevel;
+    endWrite();
+}
+
+//the counter is forced odd and then to the next even value rather than
+// stepped, so a write always leaves it even whatever it started from
+void StateCache::beginWrite()
+{
+    record->sequence.store(record->sequence.load(std::memory_order_relaxed) | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void StateCache::endWrite()
+{
+    record->savedAtMs = QDateTime::currentMSecsSinceEpoch();
+    record->sequence.store((record->sequence.load(std::memory_order_relaxed) | 1) + 1, std::memory_order_release);
+}
@@ -0,0 +1,52 @@
+#ifndef STATECACHE_H
+#define STATECACHE_H
+
+#include "MicrowaveMessageFormat.h"
+
+#include <QString>
+
+class QFile;
+
+// Last-known device state, kept in a small memory-mapped file per device.
+//
+// Every State, Time and power level the device reports is written straight
+// into the mapping, so keeping the cache current costs a few stores and no
+// syscalls; the kernel writes the page back. A sequence counter is odd while
+// a record is being written, so a record torn by a crash is ignored on load.
+class StateCache
+{
+public:
+    struct Snapshot {
+        MicrowaveMsgFormat::State state;
+        MicrowaveMsgFormat::Time time;
+        quint32 powerLevel;
+        qint64 savedAtMs;   // wall clock, ms since epoch
+    };
+
+    //endpoint identifies the device, see Transport::endpoint()
+    explicit StateCache(const QString& endpoint);
+    ~StateCache();
+
+    StateCache(const StateCache&) = delete;
+    StateCache& operator=(const StateCache&) = delete;
+
+    bool isOpen() const;
+
+    //false when there is no complete record for this device yet
+    bool load(Snapshot& snapshot) const;
+
+    void storeState(const MicrowaveMsgFormat::State state);
+    void storeTime(const MicrowaveMsgFormat::Time& time);
+    void storePowerLevel(const quint32 powerLevel);
+
+private:
+    struct Record;
+
+    QFile* file;
+    Record* record;
+
+    void beginWrite();
+    void endWrite();
+};
+
+#endif // STATECACHE_H
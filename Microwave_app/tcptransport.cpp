@@ -0,0 +1,176 @@
+#include "tcptransport.h"
+#include "capturewriter.h"
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveMessageDecoder.h"
+
+#include <QDebug>
+#include <QTcpSocket>
+
+namespace {
+
+//bytes QTcpSocket may hold before the link counts as backed up. A buffered
+// socket queues every write and hands it to the kernel on the next event
+// loop pass, so this caps one pass at six v1 frames (more of the shorter v2
+// ones). The rest waits in TxScheduler, where STOP still cancels queued key
+// presses, until bytesWritten() says Qt has handed the pass to the kernel.
+const qint64 TX_HIGH_WATER_BYTES {64};
+//undecoded rx bytes held by the decoder, and again by QTcpSocket, before
+// reading stops and TCP flow control holds the device back
+const qint64 RX_HIGH_WATER_BYTES {4096};
+
+}
+
+TcpTransport::TcpTransport(const QHostAddress& host, const quint16 port, QObject *parent)
+    : Transport(parent)
+    , socket{new QTcpSocket(this)}
+    , host{host}
+    , port{port}
+    , decoder{new MicrowaveMsgFormat::MessageDecoder(MicrowaveMsgFormat::Destination::APP)}
+    , reportedResyncs{0}
+    , highWater{RX_HIGH_WATER_BYTES}
+    , connecting{false}
+{
+    socket->setReadBufferSize(highWater);
+    connect(socket, SIGNAL(stateChanged(QAbstractSocket::SocketState)),
+            this, SLOT(onStateChanged(QAbstractSocket::SocketState)));
+    connect(socket, SIGNAL(connected()), this, SLOT(onTcpConnect()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(onTcpDisconnect()));
+    connect(socket, SIGNAL(bytesWritten(qint64)), this, SIGNAL(writable()));
+}
+
+TcpTransport::~TcpTransport()
+{
+    delete decoder;
+}
+
+void TcpTransport::open()
+{
+    connecting = true;
+    socket->connectToHost(host, port, QIODevice::ReadWrite);
+}
+
+void TcpTransport::close()
+{
+    socket->disconnectFromHost();
+}
+
+bool TcpTransport::isConnected() const
+{
+    return socket->state() == QAbstractSocket::ConnectedState;
+}
+
+QString TcpTransport::endpoint() const
+{
+    return host.toString() + ':' + QString::number(port);
+}
+
+bool TcpTransport::readMessage(MicrowaveMsgFormat::Message &msg)
+{
+    using namespace MicrowaveMsgFormat;
+
+    if(decoder->next(msg)) {
+        return true;
+    }
+    fill();
+    if(decoder->next(msg)) {
+        return true;
+    }
+
+    const MessageDecoder::Stats& stats {decoder->stats()};
+    if(reportedResyncs != stats.resyncs) {
+        reportedResyncs = stats.resyncs;
+        qDebug() << "rx stream resynchronized:"
+                 << stats.resyncs << "resyncs,"
+                 << stats.bytesDiscarded << "bytes discarded,"
+                 << stats.rejectedHeaders << "headers rejected,"
+                 << stats.messages << "messages decoded";
+    }
+    return false;
+}
+
+bool TcpTransport::writeMessage(const MicrowaveMsgFormat::Message &msg)
+{
+    using namespace MicrowaveMsgFormat;
+
+    if(!isConnected()) {
+        return false;
+    }
+
+    qint64 count {};
+    if(decoder->isFramingV2()) {
+        char frame[V2MaxFrameSize];
+        count = socket->write(frame, static_cast<qint64>(EncodeV2(msg, frame)));
+    }
+    else {
+        //swap from host to network byte order
+        const Message message {ByteSwapMessage(msg)};
+        count = socket->write(reinterpret_cast<const char*>(&message), sizeof(Message));
+    }
+    if(-1 == count) {
+        qDebug() << "Error occurred while writing data";
+        return false;
+    }
+    return true;
+}
+
+bool TcpTransport::canWrite() const
+{
+    return isConnected() && socket->bytesToWrite() < TX_HIGH_WATER_BYTES;
+}
+
+void TcpTransport::setFraming(const Framing framing)
+{
+    qDebug() << "switching to" << (Framing::V2 == framing ? "v2" : "v1") << "framing";
+    decoder->setFramingV2(Framing::V2 == framing);
+}
+
+void TcpTransport::setReceiveHighWater(const qint64 bytes)
+{
+    highWater = qMax(bytes, static_cast<qint64>(MicrowaveMsgFormat::WireMessageSize));
+    socket->setReadBufferSize(highWater);
+}
+
+void TcpTransport::fill()
+{
+    //only as much as the decoder has room for, the rest stays with the socket
+    const qint64 room {highWater - static_cast<qint64>(decoder->buffered())};
+    if(room <= 0 || 0 == socket->bytesAvailable()) {
+        return;
+    }
+    const QByteArray data {socket->read(room)};
+    if(CaptureWriter* capture {CaptureWriter::instance()}) {
+        capture->writeRaw(data.constData(), data.size());
+    }
+    decoder->append(data.constData(), static_cast<size_t>(data.size()));
+}
+
+void TcpTransport::onStateChanged(QAbstractSocket::SocketState state)
+{
+    if(connecting && QAbstractSocket::UnconnectedState == state) {
+        connecting = false;
+        qDebug() << "unable to connect to" << host;
+        emit disconnected();
+    }
+}
+
+void TcpTransport::onTcpConnect()
+{
+    connecting = false;
+    qDebug() << "socket connected";
+    connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    emit connected();
+}
+
+void TcpTransport::onTcpDisconnect()
+{
+    qDebug() << "socket disconnected";
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    decoder->reset();
+    emit disconnected();
+}
+
+void TcpTransport::onReadyRead()
+{
+    fill();
+    emit readyRead();
+}
@@ -0,0 +1,53 @@
+#ifndef TCPTRANSPORT_H
+#define TCPTRANSPORT_H
+
+#include "transport.h"
+
+#include <QHostAddress>
+#include <QAbstractSocket>
+
+class QTcpSocket;
+
+namespace MicrowaveMsgFormat {
+class MessageDecoder;
+}
+
+class TcpTransport : public Transport
+{
+    Q_OBJECT
+
+public:
+    TcpTransport(const QHostAddress& host, const quint16 port, QObject *parent = nullptr);
+    ~TcpTransport();
+
+    void open() override;
+    void close() override;
+    bool isConnected() const override;
+    QString endpoint() const override;
+
+    bool readMessage(MicrowaveMsgFormat::Message& msg) override;
+    bool writeMessage(const MicrowaveMsgFormat::Message& msg) override;
+    bool canWrite() const override;
+    void setFraming(const Framing framing) override;
+    void setReceiveHighWater(const qint64 bytes) override;
+
+private:
+    QTcpSocket* socket;
+    QHostAddress host;
+    quint16 port;
+
+    MicrowaveMsgFormat::MessageDecoder* decoder;
+    quint64 reportedResyncs;
+    qint64 highWater;
+    bool connecting;
+
+    void fill();
+
+private slots:
+    void onStateChanged(QAbstractSocket::SocketState state);
+    void onTcpConnect();
+    void onTcpDisconnect();
+    void onReadyRead();
+};
+
+#endif // TCPTRANSPORT_H
@@ -0,0 +1,68 @@
+#include "timerservice.h"
+
+#include <QCoreApplication>
+#include <QTimer>
+
+namespace {
+
+const uint32_t WHEEL_TICK_MS {10};
+
+}
+
+TimerService* TimerService::instance()
+{
+    //parented to the application so it goes away with the event loop
+    static TimerService* service {new TimerService(QCoreApplication::instance())};
+    return service;
+}
+
+TimerService::TimerService(QObject *parent)
+    : QObject(parent)
+    , wheel{WHEEL_TICK_MS}
+    , clock{}
+    , wakeup{new QTimer(this)}
+{
+    clock.start();
+    wakeup->setSingleShot(true);
+    connect(wakeup, SIGNAL(timeout()), this, SLOT(onWakeup()));
+}
+
+void TimerService::start(TimingWheel::Timer& timer, const int ms, TimingWheel::Callback callback)
+{
+    //an idle wheel is not advanced, catch it up first or the next wakeup
+    // steps through every tick since the last timer fired. The wheel is
+    // empty, so advance() fires nothing and only jumps to now.
+    if(0 == wheel.size()) {
+        wheel.advance(static_cast<uint64_t>(clock.elapsed()));
+    }
+    wheel.scheduleAt(timer, static_cast<uint64_t>(clock.elapsed() + (ms > 0 ? ms : 0)), std::move(callback));
+    rearm();
+}
+
+void TimerService::stop(TimingWheel::Timer& timer)
+{
+    wheel.cancel(timer);
+    rearm();
+}
+
+qint64 TimerService::elapsed() const
+{
+    return clock.elapsed();
+}
+
+void TimerService::rearm()
+{
+    uint64_t due {};
+    if(!wheel.nextExpiry(due)) {
+        wakeup->stop();
+        return;
+    }
+    const qint64 delay {static_cast<qint64>(due) - clock.elapsed()};
+    wakeup->start(delay > 0 ? static_cast<int>(delay) : 0);
+}
+
+void TimerService::onWakeup()
+{
+    wheel.advance(static_cast<uint64_t>(clock.elapsed()));
+    rearm();
+}
@@ -0,0 +1,41 @@
+#ifndef TIMERSERVICE_H
+#define TIMERSERVICE_H
+
+#include "timingwheel.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+
+class QTimer;
+
+// Process-wide timing wheel driven by a single QTimer.
+//
+// Every session schedules its timeouts here instead of owning QTimers; the
+// QTimer is only armed for the earliest pending expiry, so timers that fall
+// into the same tick are served by one wakeup.
+class TimerService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TimerService* instance();
+
+    void start(TimingWheel::Timer& timer, const int ms, TimingWheel::Callback callback);
+    void stop(TimingWheel::Timer& timer);
+
+    qint64 elapsed() const;
+
+private:
+    explicit TimerService(QObject *parent = nullptr);
+
+    TimingWheel wheel;
+    QElapsedTimer clock;
+    QTimer* wakeup;
+
+    void rearm();
+
+private slots:
+    void onWakeup();
+};
+
+#endif // TIMERSERVICE_H
@@ -0,0 +1,207 @@
+#include "timingwheel.h"
+
+#include <utility>
+
+TimingWheel::Timer::Timer()
+    : Link{nullptr, nullptr}
+    , wheel{nullptr}
+    , expiryTick{0}
+    , callback{}
+{
+}
+
+TimingWheel::Timer::~Timer()
+{
+    cancel();
+}
+
+bool TimingWheel::Timer::isActive() const
+{
+    return nullptr != next;
+}
+
+void TimingWheel::Timer::cancel()
+{
+    if(wheel) {
+        wheel->cancel(*this);
+    }
+}
+
+TimingWheel::TimingWheel(const uint32_t tickMs)
+    : tickMs{tickMs ? tickMs : 1}
+    , currentTick{0}
+    , count{0}
+{
+    for(auto& level : buckets) {
+        for(Link& head : level) {
+            head.prev = &head;
+            head.next = &head;
+        }
+    }
+}
+
+TimingWheel::~TimingWheel()
+{
+    for(auto& level : buckets) {
+        for(Link& head : level) {
+            while(head.next != &head) {
+                Timer& timer {static_cast<Timer&>(*head.next)};
+                unlink(timer);
+                timer.wheel = nullptr;
+            }
+        }
+    }
+}
+
+void TimingWheel::schedule(Timer& timer, const uint64_t delayMs, Callback callback)
+{
+    scheduleAt(timer, now() + delayMs, std::move(callback));
+}
+
+void TimingWheel::scheduleAt(Timer& timer, const uint64_t whenMs, Callback callback)
+{
+    cancel(timer);
+    timer.wheel = this;
+    timer.callback = std::move(callback);
+    //round up so a timer never fires early, and always at least one tick out
+    const uint64_t tick {(whenMs + tickMs - 1) / tickMs};
+    timer.expiryTick = tick > currentTick ? tick : currentTick + 1;
+    link(timer);
+    ++count;
+}
+
+void TimingWheel::cancel(Timer& timer)
+{
+    if(timer.isActive() && this == timer.wheel) {
+        unlink(timer);
+        --count;
+    }
+}
+
+void TimingWheel::advance(const uint64_t nowMs)
+{
+    const uint64_t target {nowMs / tickMs};
+    while(currentTick < target) {
+        if(0 == count) {
+            currentTick = target;
+            break;
+        }
+        ++currentTick;
+
+        //pull the next stretch of every higher level down when its range starts
+        for(uint32_t level {1}; level < LevelCount; ++level) {
+            if(0 != (currentTick & ((1ull << (LevelBits * level)) - 1))) {
+                break;
+            }
+            cascade(level);
+        }
+
+        //detach everything due first, callbacks may reschedule into this bucket
+        Link& head {buckets[0][currentTick & BucketMask]};
+        Link due {&due, &due};
+        while(head.next != &head) {
+            Link& node {*head.next};
+            unlink(node);
+            append(due, node);
+        }
+
+        while(due.next != &due) {
+            Timer& timer {static_cast<Timer&>(*due.next)};
+            unlink(timer);
+            --count;
+            Callback callback {std::move(timer.callback)};
+            callback();
+        }
+    }
+}
+
+bool TimingWheel::nextExpiry(uint64_t& ms) const
+{
+    if(0 == count) {
+        return false;
+    }
+
+    uint64_t best {UINT64_MAX};
+    for(uint32_t level {0}; level < LevelCount; ++level) {
+        const uint32_t shift {LevelBits * level};
+        const uint64_t base {currentTick >> shift};
+        for(uint32_t distance {1}; distance <= BucketCount; ++distance) {
+            const Link& head {buckets[level][(base + distance) & BucketMask]};
+            if(head.next != &head) {
+                //a level 0 bucket holds exactly that tick, higher levels are
+                // only known to start no earlier than their cascade point
+                const uint64_t start {(base + distance) << shift};
+                if(start < best) {
+                    best = start;
+                }
+                break;
+            }
+        }
+    }
+    ms = (best > currentTick ? best : currentTick + 1) * tickMs;
+    return true;
+}
+
+uint64_t TimingWheel::now() const
+{
+    return currentTick * tickMs;
+}
+
+uint32_t TimingWheel::tick() const
+{
+    return tickMs;
+}
+
+uint32_t TimingWheel::size() const
+{
+    return count;
+}
+
+void TimingWheel::link(Timer& timer)
+{
+    uint64_t delta {timer.expiryTick - currentTick};
+    uint64_t expiry {timer.expiryTick};
+    if(delta > MaxTicks) {
+        //beyond the top level, park it at the far end and let it cascade again
+        delta = MaxTicks;
+        expiry = currentTick + MaxTicks;
+    }
+
+    uint32_t level {0};
+    while(level + 1 < LevelCount && delta >= (1ull << (LevelBits * (level + 1)))) {
+        ++level;
+    }
+    append(buckets[level][(expiry >> (LevelBits * level)) & BucketMask], timer);
+}
+
+void TimingWheel::cascade(const uint32_t level)
+{
+    Link& head {buckets[level][(currentTick >> (LevelBits * level)) & BucketMask]};
+    Link pending {&pending, &pending};
+    while(head.next != &head) {
+        Link& node {*head.next};
+        unlink(node);
+        append(pending, node);
+    }
+    while(pending.next != &pending) {
+        Timer& timer {static_cast<Timer&>(*pending.next)};
+        unlink(timer);
+        link(timer);
+    }
+}
+
+void TimingWheel::unlink(Link& node)
+{
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = nullptr;
+    node.next = nullptr;
+}
+
+void TimingWheel::append(Link& head, Link& node)
+{
+    node.prev = head.prev;
+    node.next = &head;
+    head.prev->next = &node;
+    head.prev = &node;
+}
@@ -0,0 +1,87 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <cstdint>
+#include <functional>
+
+// Hierarchical timing wheel.
+//
+// Four levels of 64 buckets each: level 0 holds timers due within the next
+// 64 ticks, every further level covers 64 times the range of the one below
+// and is cascaded down as time reaches it. Timers are intrusive nodes owned
+// by the caller, so scheduling allocates nothing and both schedule() and
+// cancel() are O(1). Time is in milliseconds, rounded up to whole ticks;
+// advance() fires everything due up to the given time in one batch.
+class TimingWheel
+{
+    struct Link
+    {
+        Link* prev;
+        Link* next;
+    };
+
+public:
+    typedef std::function<void()> Callback;
+
+    class Timer : private Link
+    {
+    public:
+        Timer();
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool isActive() const;
+        void cancel();
+
+    private:
+        friend class TimingWheel;
+
+        TimingWheel* wheel;
+        uint64_t expiryTick;
+        Callback callback;
+    };
+
+    explicit TimingWheel(const uint32_t tickMs = 10);
+    ~TimingWheel();
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    //(re)arms timer to fire delayMs after the wheel's current time
+    void schedule(Timer& timer, const uint64_t delayMs, Callback callback);
+    //(re)arms timer to fire at the absolute wheel time whenMs
+    void scheduleAt(Timer& timer, const uint64_t whenMs, Callback callback);
+    void cancel(Timer& timer);
+
+    //fires every timer due at or before nowMs
+    void advance(const uint64_t nowMs);
+
+    //earliest time something may be due, false when the wheel is empty.
+    // Exact for the next 64 ticks, otherwise the next cascade point.
+    bool nextExpiry(uint64_t& ms) const;
+
+    uint64_t now() const;
+    uint32_t tick() const;
+    uint32_t size() const;
+
+private:
+    static const uint32_t LevelBits {6};
+    static const uint32_t BucketCount {1u << LevelBits};
+    static const uint32_t BucketMask {BucketCount - 1};
+    static const uint32_t LevelCount {4};
+    static const uint64_t MaxTicks {(1ull << (LevelBits * LevelCount)) - 1};
+
+    Link buckets[LevelCount][BucketCount];
+    uint32_t tickMs;
+    uint64_t currentTick;
+    uint32_t count;
+
+    void link(Timer& timer);
+    void cascade(const uint32_t level);
+    static void unlink(Link& node);
+    static void append(Link& head, Link& node);
+};
+
+#endif // TIMINGWHEEL_H
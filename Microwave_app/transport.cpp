@@ -0,0 +1,75 @@
+#include "transport.h"
+#include "tcptransport.h"
+#include "shmtransport.h"
+
+#include <QHostAddress>
+#include <QtGlobal>
+
+namespace {
+
+const quint16 DEV_RECV_PORT {60002};
+const QHostAddress server {QHostAddress("192.168.0.10")};
+
+//unix socket of a co-located device/simulator that serves a shared-memory ring
+const char* const SHM_SOCKET_ENV {"MICROWAVE_SHM_SOCKET"};
+//overrides the receive high-water mark of stream transports, in bytes
+const char* const RX_HIGH_WATER_ENV {"MICROWAVE_RX_HIGH_WATER"};
+//host:port to use instead of the board, e.g. a Microwave_proxy
+const char* const DEVICE_ENV {"MICROWAVE_DEVICE"};
+
+}
+
+Transport::Transport(QObject *parent)
+    : QObject(parent)
+{
+}
+
+Transport::~Transport()
+{
+}
+
+bool Transport::canWrite() const
+{
+    return isConnected();
+}
+
+void Transport::setFraming(const Framing framing)
+{
+    Q_UNUSED(framing);
+}
+
+void Transport::setReceiveHighWater(const qint64 bytes)
+{
+    Q_UNUSED(bytes);
+}
+
+Transport* Transport::create(QObject *parent)
+{
+    Transport* transport {Q_NULLPTR};
+    if(qEnvironmentVariableIsSet(SHM_SOCKET_ENV)) {
+        transport = new ShmTransport(qEnvironmentVariable(SHM_SOCKET_ENV), parent);
+    }
+    else {
+        QHostAddress host {server};
+        quint16 port {DEV_RECV_PORT};
+        const QString device {qEnvironmentVariable(DEVICE_ENV)};
+        const int colon {device.lastIndexOf(':')};
+        if(colon > 0) {
+            bool ok {false};
+            const quint16 devicePort {device.mid(colon + 1).toUShort(&ok)};
+            const QHostAddress deviceHost {device.left(colon)};
+            if(ok && !deviceHost.isNull()) {
+                host = deviceHost;
+                port = devicePort;
+            }
+        }
+        transport = new TcpTransport(host, port, parent);
+    }
+
+    bool ok {false};
+    const qint64 highWater {qEnvironmentVariable(RX_HIGH_WATER_ENV).toLongLong(&ok)};
+    if(ok && highWater > 0) {
+        transport->setReceiveHighWater(highWater);
+    }
+    return transport;
+}
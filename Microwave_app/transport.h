@@ -0,0 +1,59 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QString>
+
+namespace MicrowaveMsgFormat {
+class Message;
+}
+
+// Link between the app and one device board.
+//
+// Messages cross this interface in host byte order; each implementation owns
+// its own framing. readyRead() is emitted when at least one message can be
+// taken with readMessage(). disconnected() is also emitted when an open()
+// attempt fails, so callers can retry from a single place. canWrite() turns
+// false while the link is backed up; implementations that can tell when it
+// drains emit writable().
+class Transport : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Framing {
+        V1,     // fixed 12-byte Message
+        V2      // compact framing, see MicrowaveFramingV2.h
+    };
+
+    explicit Transport(QObject *parent = nullptr);
+    virtual ~Transport();
+
+    //picks the transport configured for this process (TCP by default)
+    static Transport* create(QObject *parent = nullptr);
+
+    virtual void open() = 0;
+    virtual void close() = 0;
+    virtual bool isConnected() const = 0;
+
+    //stable name of the device this transport talks to
+    virtual QString endpoint() const = 0;
+
+    virtual bool readMessage(MicrowaveMsgFormat::Message& msg) = 0;
+    virtual bool writeMessage(const MicrowaveMsgFormat::Message& msg) = 0;
+    virtual bool canWrite() const;
+
+    //switches wire framing once negotiated, links without framing ignore it
+    virtual void setFraming(const Framing framing);
+    //bytes a stream link buffers before it stops reading and lets the
+    // device block, links with a fixed size ring ignore it
+    virtual void setReceiveHighWater(const qint64 bytes);
+
+signals:
+    void connected();
+    void disconnected();
+    void readyRead();
+    void writable();
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,160 @@
+#include "txscheduler.h"
+#include "transport.h"
+#include "timerservice.h"
+
+#include <QDebug>
+
+namespace {
+
+//polling interval while a transport without writable() is backed up, one
+// TimerService tick
+const int TX_RETRY_MS {10};
+const qint64 STATE_REQUEST_IN_FLIGHT_NS {MicrowaveMsgFormat::StateReplyWindowMs * 1000000LL};
+
+const char* const PRIORITY_NAMES[] {"critical", "control", "input"};
+
+}
+
+TxScheduler::TxScheduler(Transport* transport, QObject *parent)
+    : QObject(parent)
+    , transport{transport}
+    , queues{}
+    , classStats{}
+    , clock{}
+    , retryTimer{}
+    , stateRequestQueued{false}
+    , stateRequestSentNs{-1}
+{
+    clock.start();
+    connect(transport, SIGNAL(writable()), this, SLOT(flush()));
+}
+
+TxScheduler::~TxScheduler()
+{
+    TimerService::instance()->stop(retryTimer);
+    logStats();
+}
+
+TxScheduler::Priority TxScheduler::classify(const MicrowaveMsgFormat::Message &msg)
+{
+    using namespace MicrowaveMsgFormat;
+    switch(msg.signal) {
+    case Signal::STOP:
+        return Priority::CRITICAL;
+    case Signal::STATE_REQUEST:
+    case Signal::CAPABILITIES:
+        return Priority::CONTROL;
+    default:
+        return Priority::INPUT;
+    }
+}
+
+void TxScheduler::send(const MicrowaveMsgFormat::Message &msg)
+{
+    using namespace MicrowaveMsgFormat;
+
+    if(!transport->isConnected()) {
+        return;
+    }
+    const Priority priority {classify(msg)};
+    Stats& stats {classStats[static_cast<int>(priority)]};
+
+    if(Signal::STATE_REQUEST == msg.signal) {
+        if(stateRequestQueued || stateRequestInFlight()) {
+            ++stats.deduplicated;
+            return;
+        }
+        stateRequestQueued = true;
+    }
+    else if(Priority::CRITICAL == priority) {
+        QQueue<Entry>& input {queues[static_cast<int>(Priority::INPUT)]};
+        classStats[static_cast<int>(Priority::INPUT)].cancelled += static_cast<quint64>(input.size());
+        input.clear();
+    }
+
+    queues[static_cast<int>(priority)].enqueue(Entry{msg, clock.nsecsElapsed()});
+    flush();
+}
+
+void TxScheduler::acknowledge(const MicrowaveMsgFormat::Message &msg)
+{
+    using namespace MicrowaveMsgFormat;
+    if(Type::STATE == static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
+        stateRequestSentNs = -1;
+    }
+}
+
+void TxScheduler::reset()
+{
+    TimerService::instance()->stop(retryTimer);
+    for(QQueue<Entry>& queue : queues) {
+        queue.clear();
+    }
+    stateRequestQueued = false;
+    stateRequestSentNs = -1;
+    logStats();
+}
+
+const TxScheduler::Stats& TxScheduler::stats(const Priority priority) const
+{
+    return classStats[static_cast<int>(priority)];
+}
+
+bool TxScheduler::stateRequestInFlight() const
+{
+    return -1 != stateRequestSentNs && clock.nsecsElapsed() - stateRequestSentNs < STATE_REQUEST_IN_FLIGHT_NS;
+}
+
+void TxScheduler::logStats() const
+{
+    for(int i {0}; i < static_cast<int>(Priority::COUNT); ++i) {
+        const Stats& stats {classStats[i]};
+        if(0 == stats.sent && 0 == stats.cancelled && 0 == stats.deduplicated) {
+            continue;
+        }
+        qDebug() << "tx" << PRIORITY_NAMES[i] << "queue:"
+                 << stats.sent << "sent, queueing delay mean"
+                 << (stats.sent ? stats.totalDelayNs / static_cast<qint64>(stats.sent) / 1000 : 0)
+                 << "us max" << stats.maxDelayNs / 1000 << "us,"
+                 << stats.cancelled << "cancelled,"
+                 << stats.deduplicated << "deduplicated";
+    }
+}
+
+void TxScheduler::flush()
+{
+    using namespace MicrowaveMsgFormat;
+
+    for(int i {0}; i < static_cast<int>(Priority::COUNT); ) {
+        QQueue<Entry>& queue {queues[i]};
+        if(queue.isEmpty()) {
+            ++i;
+            continue;
+        }
+        if(!transport->canWrite()) {
+            //retried on writable() or by polling, a dead link is reset()
+            if(transport->isConnected() && !retryTimer.isActive()) {
+                TimerService::instance()->start(retryTimer, TX_RETRY_MS, [this]() {
+                    flush();
+                });
+            }
+            return;
+        }
+
+        const Entry entry {queue.dequeue()};
+        const qint64 now {clock.nsecsElapsed()};
+        if(Signal::STATE_REQUEST == entry.msg.signal) {
+            stateRequestQueued = false;
+            stateRequestSentNs = now;
+        }
+        transport->writeMessage(entry.msg);
+
+        Stats& stats {classStats[i]};
+        const qint64 delay {now - entry.enqueuedNs};
+        ++stats.sent;
+        stats.totalDelayNs += delay;
+        stats.maxDelayNs = qMax(stats.maxDelayNs, delay);
+        //anything more urgent queued by the write goes first
+        i = 0;
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef TXSCHEDULER_H
+#define TXSCHEDULER_H
+
+#include "MicrowaveMessageFormat.h"
+#include "timingwheel.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QQueue>
+
+class Transport;
+
+// Transmit queue in front of a Transport.
+//
+// Messages wait in one FIFO per priority class and are written out highest
+// class first whenever the transport can take them, so on an idle link a
+// message goes out from send() directly. STOP is critical: it jumps every
+// queue and cancels the key presses still waiting, which would act on a
+// mode the device is about to leave. A STATE_REQUEST is dropped while
+// another one is queued or still waiting for its State reply; the pending
+// one answers the caller just the same.
+class TxScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Priority {
+        CRITICAL = 0,   // STOP
+        CONTROL,        // session requests: STATE_REQUEST, CAPABILITIES
+        INPUT,          // key presses, in the order they were made
+        COUNT
+    };
+
+    struct Stats
+    {
+        quint64 sent;
+        quint64 cancelled;
+        quint64 deduplicated;
+        qint64 totalDelayNs;    // enqueue to transport write
+        qint64 maxDelayNs;
+    };
+
+    explicit TxScheduler(Transport* transport, QObject *parent = nullptr);
+    ~TxScheduler();
+
+    static Priority classify(const MicrowaveMsgFormat::Message& msg);
+
+    void send(const MicrowaveMsgFormat::Message& msg);
+
+    //feeds one rx message, a State ends the STATE_REQUEST in flight
+    void acknowledge(const MicrowaveMsgFormat::Message& msg);
+
+    //drops everything queued, for a link that went down
+    void reset();
+
+    const Stats& stats(const Priority priority) const;
+
+private:
+    struct Entry
+    {
+        MicrowaveMsgFormat::Message msg;
+        qint64 enqueuedNs;
+    };
+
+    Transport* transport;
+    QQueue<Entry> queues[static_cast<int>(Priority::COUNT)];
+    Stats classStats[static_cast<int>(Priority::COUNT)];
+    QElapsedTimer clock;
+    TimingWheel::Timer retryTimer;
+    bool stateRequestQueued;
+    qint64 stateRequestSentNs;  // -1 when none is in flight
+
+    bool stateRequestInFlight() const;
+    void logStats() const;
+
+private slots:
+    void flush();
+};
+
+#endif // TXSCHEDULER_H
@@ -0,0 +1,19 @@
+# Hardware counter benchmarks of the receive path, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveMessageDecoder.h \
+    ../MicrowaveTimeDelta.h \
+    ../MicrowaveDisplay.h \
+    ../MicrowaveCapture.h \
+    ../MicrowavePerfCounters.h \
+    ../MicrowaveProtocolCore.h
+
+INCLUDEPATH += \
+    ../
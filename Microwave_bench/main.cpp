@@ -0,0 +1,420 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveMessageDecoder.h"
+#include "MicrowaveCapture.h"
+#include "MicrowaveDisplay.h"
+#include "MicrowaveFramingV2.h"
+#include "MicrowavePerfCounters.h"
+#include "MicrowaveProtocolCore.h"
+#include "MicrowaveTimeDelta.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmarks of the receive hot path with hardware counters.
+//
+//   Microwave_bench [--messages N] [--chunk N] [capture...]
+//
+// Runs a stream of DEV->APP messages through the same stages as the app's
+// onReadyRead(): the frame decoder (read), the protocol core's dispatch
+// switches (dispatch) and the time rendering behind present()
+// (display). Each stage is measured with the counters of
+// MicrowavePerfCounters.h, per message Type, and reported per call with the
+// cost of reading the counters taken out. The stream is the RX messages of
+// the given captures, or a synthetic session of clock, cook time and
+// countdown traffic, repeated up to N messages (default 1000000). The
+// decoder is fed --chunk messages at a time (default 8), about what one
+// readyRead() brings.
+//
+//   Microwave_bench --wire [--sessions N] [--seconds S]
+//
+// Measures instead what display timer load costs on the link, device to
+// app. Each of N sessions (default 1000) runs countdowns of 30 s to 30 min
+// back to back for S seconds (default 3600), seeded by the session's index
+// so every run sends the same traffic. The traffic is sent as ASCII digits
+// and as binary seconds and deltas, in v1 and v2 framing, and with timer
+// sync, each after the CAPABILITIES reply that enables it, and reported in
+// bytes and messages per second per session. Every stream is decoded again
+// through MessageDecoder and ProtocolCore and the display checked against
+// the device's every second; exits non-zero on any difference.
+
+namespace {
+
+using namespace MicrowaveMsgFormat;
+
+const size_t DEFAULT_MESSAGES {1000000};
+const size_t DEFAULT_CHUNK {8};
+
+//--wire
+const uint32_t DEFAULT_SESSIONS {1000};
+const uint32_t DEFAULT_SECONDS {3600};
+const uint32_t COUNTDOWN_MIN_S {30};
+const uint32_t COUNTDOWN_MAX_S {30 * 60};
+const uint8_t WIRE_SYNC_INTERVAL_S {5};
+
+struct WireMode
+{
+    const char* name;
+    uint8_t capabilities;   // 0 for the original protocol, no handshake
+};
+
+const WireMode WIRE_MODES[] {
+    {"ascii, v1 framing", 0},
+    {"binary, v1 framing", CAP_BINARY_TIME},
+    {"ascii, v2 framing", CAP_FRAMING_V2},
+    {"binary, v2 framing", CAP_BINARY_TIME | CAP_FRAMING_V2},
+    {"binary, v2 framing, timer sync", CAP_BINARY_TIME | CAP_FRAMING_V2 | CAP_TIMER_SYNC},
+};
+
+Message makeMessage(const uint32_t value, const char* data = "\0\0\0\0")
+{
+    Message msg {};
+    msg.dst = Destination::APP;
+    msg.state = static_cast<State>(value);
+    memcpy(msg.data, data, sizeof(msg.data));
+    return msg;
+}
+
+Message makeSignal(const Signal signal)
+{
+    return makeMessage(static_cast<uint32_t>(signal));
+}
+
+void appendTime(std::vector<Message>& stream, const Update update, const uint32_t left, const uint32_t right)
+{
+    const char data[4] {static_cast<char>('0' + left / 10), static_cast<char>('0' + left % 10),
+                        static_cast<char>('0' + right / 10), static_cast<char>('0' + right % 10)};
+    stream.push_back(makeMessage(static_cast<uint32_t>(update), data));
+}
+
+// One cook: the clock blinking for a while, a cook time and power level
+// entered, a one minute countdown and the State replies to the app's poll
+std::vector<Message> syntheticSession()
+{
+    std::vector<Message> stream;
+    stream.push_back(makeMessage(static_cast<uint32_t>(State::DISPLAY_CLOCK)));
+    appendTime(stream, Update::CLOCK, 12, 0);
+    for(uint32_t i {0}; i < 60; ++i) {
+        stream.push_back(makeSignal(Signal::BLINK_ON));
+        stream.push_back(makeMessage(static_cast<uint32_t>(State::DISPLAY_CLOCK)));
+        stream.push_back(makeSignal(Signal::BLINK_OFF));
+    }
+    appendTime(stream, Update::CLOCK, 12, 1);
+
+    stream.push_back(makeSignal(Signal::COOK_TIME));
+    appendTime(stream, Update::DISPLAY_TIMER, 0, 0);
+    appendTime(stream, Update::DISPLAY_TIMER, 0, 1);
+    appendTime(stream, Update::DISPLAY_TIMER, 0, 10);
+    appendTime(stream, Update::DISPLAY_TIMER, 1, 0);
+    stream.push_back(makeSignal(Signal::POWER_LEVEL));
+    stream.push_back(makeMessage(static_cast<uint32_t>(Update::POWER_LEVEL), "80\0\0"));
+    stream.push_back(makeSignal(Signal::START));
+    for(uint32_t second {59}; second > 0; --second) {
+        appendTime(stream, Update::DISPLAY_TIMER, 0, second);
+        stream.push_back(makeMessage(static_cast<uint32_t>(State::DISPLAY_TIMER)));
+        stream.push_back(makeMessage(static_cast<uint32_t>(State::DISPLAY_TIMER)));
+    }
+    stream.push_back(makeSignal(Signal::STOP));
+    return stream;
+}
+
+// The device's side of one --wire session: a countdown started as soon as
+// the clock is back, the clock shown for the second in between
+class TimerLoadSession
+{
+public:
+    TimerLoadSession(const uint32_t seed, const uint8_t capabilities)
+        : rng{seed}
+        , capabilities{capabilities}
+        , second{0}
+        , clockSeconds{static_cast<uint32_t>(rng() % (24 * 60)) * 60}
+        , remaining{0}
+        , sinceSync{0}
+    {
+    }
+
+    // Appends what the device sends in the next second to out
+    void step(std::vector<Message>& out)
+    {
+        if(0 == second) {
+            if(capabilities) {
+                Message reply {makeSignal(Signal::CAPABILITIES)};
+                reply.data[0] = static_cast<char>(capabilities);
+                reply.data[1] = static_cast<char>(ProtocolVersion);
+                reply.data[2] = static_cast<char>(WIRE_SYNC_INTERVAL_S);
+                out.push_back(reply);
+            }
+            out.push_back(makeMessage(static_cast<uint32_t>(State::DISPLAY_CLOCK)));
+            appendSeconds(out, TimeStream::CLOCK, clockSeconds);
+        }
+        if(0 == ++second % 60) {
+            clockSeconds = (clockSeconds + 60) % (24 * 3600);
+        }
+
+        if(0 == remaining) {
+            remaining = COUNTDOWN_MIN_S + static_cast<uint32_t>(rng() % (COUNTDOWN_MAX_S - COUNTDOWN_MIN_S + 1));
+            sinceSync = 0;
+            out.push_back(makeSignal(Signal::START));
+            appendSeconds(out, TimeStream::DISPLAY_TIMER, remaining);
+            return;
+        }
+        --remaining;
+        if(!(capabilities & CAP_TIMER_SYNC) || ++sinceSync >= WIRE_SYNC_INTERVAL_S) {
+            sinceSync = 0;
+            appendSeconds(out, TimeStream::DISPLAY_TIMER, remaining);
+        }
+        if(0 == remaining) {
+            out.push_back(makeSignal(Signal::STOP));
+            appendSeconds(out, TimeStream::CLOCK, clockSeconds);
+        }
+    }
+
+    // What the display shows after the last step
+    Time shown() const
+    {
+        Time time;
+        SecondsToTime(remaining ? TimeStream::DISPLAY_TIMER : TimeStream::CLOCK,
+                      remaining ? remaining : clockSeconds, time);
+        return time;
+    }
+
+private:
+    std::mt19937 rng;
+    uint8_t capabilities;
+    uint32_t second;
+    uint32_t clockSeconds;
+    uint32_t remaining;         // 0 while the clock shows
+    uint32_t sinceSync;
+    TimeDeltaEncoder encoder;
+
+    void appendSeconds(std::vector<Message>& out, const TimeStream stream, const uint32_t seconds)
+    {
+        if(capabilities & CAP_BINARY_TIME) {
+            Message msg {};
+            encoder.encode(stream, seconds, msg);
+            out.push_back(msg);
+            return;
+        }
+        Time time;
+        SecondsToTime(stream, seconds, time);
+        appendTime(out, TimeStream::CLOCK == stream ? Update::CLOCK : Update::DISPLAY_TIMER,
+                   time.left_tens * 10 + time.left_ones, time.right_tens * 10 + time.right_ones);
+    }
+};
+
+struct WireResult
+{
+    uint64_t bytes;
+    uint64_t messages;
+    uint64_t checks;
+    uint64_t mismatches;
+};
+
+// Encodes every session in mode a second at a time, decodes it again and
+// checks the display after each second
+WireResult measureWire(const WireMode& mode, const uint32_t sessions, const uint32_t seconds)
+{
+    WireResult result {};
+    std::vector<Message> sent;
+    std::vector<char> wire;
+    for(uint32_t session {0}; session < sessions; ++session) {
+        TimerLoadSession device(session, mode.capabilities);
+        MessageDecoder decoder(Destination::APP);
+        ProtocolCore core;
+        bool sendV2 {false};
+        for(uint32_t second {0}; second < seconds; ++second) {
+            sent.clear();
+            wire.clear();
+            device.step(sent);
+            for(const Message& msg : sent) {
+                char frame[WireMessageSize];
+                if(sendV2) {
+                    wire.insert(wire.end(), frame, frame + EncodeV2(msg, frame));
+                }
+                else {
+                    const Message swapped {ByteSwapMessage(msg)};
+                    memcpy(frame, &swapped, WireMessageSize);
+                    wire.insert(wire.end(), frame, frame + WireMessageSize);
+                }
+                //the device switches right after its reply
+                sendV2 = sendV2 || (Signal::CAPABILITIES == msg.signal && (mode.capabilities & CAP_FRAMING_V2));
+            }
+            result.bytes += wire.size();
+            result.messages += sent.size();
+
+            const uint64_t nowMs {static_cast<uint64_t>(second) * 1000};
+            uint64_t due {};
+            while(core.nextTimeout(due) && due <= nowMs) {
+                core.advance(due);
+            }
+            decoder.append(wire.data(), wire.size());
+            Message msg;
+            while(decoder.next(msg)) {
+                core.process(msg, nowMs);
+                if(Signal::CAPABILITIES == msg.signal && (msg.data[0] & CAP_FRAMING_V2)) {
+                    decoder.setFramingV2(true);
+                }
+            }
+            ++result.checks;
+            if(!(core.displayedTime() == device.shown())) {
+                ++result.mismatches;
+            }
+        }
+    }
+    return result;
+}
+
+int runWire(const uint32_t sessions, const uint32_t seconds)
+{
+    printf("display timer load: %" PRIu32 " sessions of %" PRIu32 " s, device to app, per session\n\n",
+           sessions, seconds);
+    printf("%-32s %9s %9s %9s %12s\n", "", "bytes/s", "msgs/s", "of ascii", "fleet kB/s");
+    const double sessionSeconds {static_cast<double>(sessions) * seconds};
+    double baseline {0.0};
+    uint64_t mismatches {0};
+    for(const WireMode& mode : WIRE_MODES) {
+        const WireResult result {measureWire(mode, sessions, seconds)};
+        const double rate {static_cast<double>(result.bytes) / sessionSeconds};
+        baseline = baseline > 0.0 ? baseline : rate;
+        printf("%-32s %9.2f %9.3f %8.1f%% %12.1f\n", mode.name, rate,
+               static_cast<double>(result.messages) / sessionSeconds, 100.0 * rate / baseline,
+               rate * sessions / 1000.0);
+        if(result.mismatches) {
+            fprintf(stderr, "%s: display differs from the device's in %" PRIu64 " of %" PRIu64 " seconds\n",
+                    mode.name, result.mismatches, result.checks);
+        }
+        mismatches += result.mismatches;
+    }
+    return 0 == mismatches ? 0 : 1;
+}
+
+bool readCapture(const char* path, std::vector<Message>& stream)
+{
+    std::ifstream in(path, std::ios::binary);
+    if(!in) {
+        return false;
+    }
+    const std::vector<char> data {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    CaptureReader reader(data.data(), data.size());
+    if(!reader.isValid()) {
+        return false;
+    }
+    CaptureRecord record;
+    Message msg;
+    while(reader.next(record)) {
+        if(CaptureKind::RX == record.kind && DecodeCaptureMessage(record, msg)) {
+            stream.push_back(msg);
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    size_t messages {DEFAULT_MESSAGES};
+    size_t chunk {DEFAULT_CHUNK};
+    bool wireLoad {false};
+    uint32_t sessions {DEFAULT_SESSIONS};
+    uint32_t sessionSeconds {DEFAULT_SECONDS};
+    std::vector<Message> session;
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--messages") && i + 1 < argc) {
+            messages = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--chunk") && i + 1 < argc) {
+            chunk = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--wire")) {
+            wireLoad = true;
+        }
+        else if(0 == strcmp(argv[i], "--sessions") && i + 1 < argc) {
+            sessions = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            sessionSeconds = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if('-' != argv[i][0]) {
+            if(!readCapture(argv[i], session)) {
+                fprintf(stderr, "%s: unreadable capture\n", argv[i]);
+                return 1;
+            }
+        }
+        else {
+            fprintf(stderr, "usage: %s [--messages N] [--chunk N] [capture...]\n"
+                            "       %s --wire [--sessions N] [--seconds S]\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+    if(wireLoad) {
+        if(0 == sessions || 0 == sessionSeconds) {
+            fprintf(stderr, "nothing to measure\n");
+            return 2;
+        }
+        return runWire(sessions, sessionSeconds);
+    }
+    if(session.empty()) {
+        session = syntheticSession();
+    }
+    if(0 == chunk) {
+        chunk = 1;
+    }
+
+    //the whole run as wire bytes, decoded chunk by chunk below
+    std::vector<char> wire;
+    wire.reserve(messages * WireMessageSize);
+    for(size_t i {0}; i < messages; ++i) {
+        const Message swapped {ByteSwapMessage(session[i % session.size()])};
+        const char* bytes {reinterpret_cast<const char*>(&swapped)};
+        wire.insert(wire.end(), bytes, bytes + WireMessageSize);
+    }
+
+    PerfProfile profile;
+    profile.calibrate();
+
+    MessageDecoder decoder(Destination::APP);
+    ProtocolCore core;
+    DisplayFrame frame;
+    std::vector<Message> batch(chunk);
+    uint64_t nowMs {0};
+    uint64_t due {};
+    const auto start {std::chrono::steady_clock::now()};
+    for(size_t offset {0}; offset < wire.size(); offset += chunk * WireMessageSize) {
+        size_t count {0};
+        {
+            PerfScope scope(&profile, PerfSection::READ);
+            const size_t size {std::min(chunk * WireMessageSize, wire.size() - offset)};
+            decoder.append(wire.data() + offset, size);
+            while(count < chunk && decoder.next(batch[count])) {
+                ++count;
+            }
+        }
+
+        for(size_t i {0}; i < count; ++i) {
+            const Message& msg {batch[i]};
+            const size_t type {PerfTypeOf(msg)};
+            nowMs += 10;
+            while(core.nextTimeout(due) && due <= nowMs) {
+                core.advance(due);
+            }
+            PerfScope scope(&profile, PerfSection::DISPATCH, type);
+            if(core.process(msg, nowMs) && Type::UPDATE == static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
+                PerfScope display(&profile, PerfSection::DISPLAY, type);
+                RenderTime(core.displayedTime(), frame);
+            }
+        }
+    }
+    const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    printf("%zu messages in chunks of %zu, %.3f s with counters read around every section\n\n%s",
+           messages, chunk, seconds, profile.report().c_str());
+    return 0;
+}
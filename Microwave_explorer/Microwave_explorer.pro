@@ -0,0 +1,17 @@
+# Exhaustive state space search of the app's state machine, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a thread
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveTimeDelta.h \
+    ../MicrowaveDisplay.h \
+    ../MicrowaveCapture.h \
+    ../MicrowaveProtocolCore.h
+
+INCLUDEPATH += \
+    ../
@@ -0,0 +1,511 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveProtocolCore.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// Exhaustive explorer of the app's state machine.
+//
+//   Microwave_explorer [-j workers] [--depth N] [--updates] [--dot file]
+//
+// The Microwave window runs its transitions, display gating and timeouts
+// on ProtocolCore, so the graph walked here is the app's own. Only what the
+// window adds around the core, the digit echo and the state cache, is not
+// explored.
+//
+// Starts from a freshly reset ProtocolCore and feeds every State and
+// Signal value plus the expiry of the power level overlay timer to every
+// configuration reached, breadth first, up to the given depth. --updates
+// adds clock, timer and power level updates with two values each, which
+// checks the display gating too at the cost of a much larger space. A
+// configuration is the core's snapshot: leaf state, display gating flags,
+// blink phase, overlay timer and the rendered frame. Each level is
+// shared between worker threads through an atomic cursor and the visited
+// set is a hash map split into shards with a lock each, so workers rarely
+// wait on one another.
+//
+// Reports leaf states never reached, dead ends (configurations no input
+// leads out of, or from which DisplayClock cannot be reached again) and
+// leaf states reached with more than one combination of gating flags, each
+// with a shortest input sequence that gets there. --dot writes the leaf
+// state transition relation as a Graphviz digraph. Exits 1 when there are
+// unreachable states or dead ends.
+
+namespace {
+
+using namespace MicrowaveMsgFormat;
+
+const size_t DEFAULT_DEPTH {24};
+const size_t SHARDS {64};
+//frontier entries a worker takes at a time
+const size_t CHUNK {64};
+//the inputs happen at this time, the overlay timer fires only as an input
+const uint64_t NOW_MS {0};
+const uint32_t NO_PARENT {UINT32_MAX};
+
+const char* const SIGNAL_NAMES[] {
+    "NONE", "CLOCK", "COOK_TIME", "POWER_LEVEL", "KITCHEN_TIMER", "STOP", "START",
+    "DIGIT_0", "DIGIT_1", "DIGIT_2", "DIGIT_3", "DIGIT_4",
+    "DIGIT_5", "DIGIT_6", "DIGIT_7", "DIGIT_8", "DIGIT_9",
+    "BLINK_ON", "BLINK_OFF", "MOD_LEFT_TENS", "MOD_LEFT_ONES", "MOD_RIGHT_TENS", "MOD_RIGHT_ONES",
+    "STATE_REQUEST", "CAPABILITIES",
+};
+
+const char* const STATE_VALUE_NAMES[] {
+    "NONE", "DISPLAY_CLOCK",
+    "CLOCK_SELECT_HOUR_TENS", "CLOCK_SELECT_HOUR_ONES", "CLOCK_SELECT_MINUTE_TENS", "CLOCK_SELECT_MINUTE_ONES",
+    "SET_COOK_TIMER", "SET_POWER_LEVEL",
+    "KITCHEN_SELECT_HOUR_TENS", "KITCHEN_SELECT_HOUR_ONES", "KITCHEN_SELECT_MINUTE_TENS", "KITCHEN_SELECT_MINUTE_ONES",
+    "DISPLAY_TIMER",
+};
+
+// One thing that can happen to the app: a DEV->APP message or, for a
+// value of 0, the overlay timer running out
+struct Input
+{
+    uint32_t value;
+    std::string name;
+    char data[sizeof(int)];
+};
+
+std::vector<Input> buildInputs(const bool updates)
+{
+    std::vector<Input> inputs;
+    for(uint32_t i {0}; i < sizeof(SIGNAL_NAMES) / sizeof(SIGNAL_NAMES[0]); ++i) {
+        inputs.push_back(Input{static_cast<uint32_t>(Signal::NONE) + i, std::string("Signal::") + SIGNAL_NAMES[i], {}});
+    }
+    for(uint32_t i {0}; i < sizeof(STATE_VALUE_NAMES) / sizeof(STATE_VALUE_NAMES[0]); ++i) {
+        inputs.push_back(Input{static_cast<uint32_t>(State::NONE) + i, std::string("State::") + STATE_VALUE_NAMES[i], {}});
+    }
+    inputs.push_back(Input{0, "timeout", {}});
+    if(updates) {
+        inputs.push_back(Input{static_cast<uint32_t>(Update::CLOCK), "Update::CLOCK(1200)", {'1', '2', '0', '0'}});
+        inputs.push_back(Input{static_cast<uint32_t>(Update::CLOCK), "Update::CLOCK(1201)", {'1', '2', '0', '1'}});
+        inputs.push_back(Input{static_cast<uint32_t>(Update::DISPLAY_TIMER), "Update::DISPLAY_TIMER(0030)", {'0', '0', '3', '0'}});
+        inputs.push_back(Input{static_cast<uint32_t>(Update::DISPLAY_TIMER), "Update::DISPLAY_TIMER(0029)", {'0', '0', '2', '9'}});
+        inputs.push_back(Input{static_cast<uint32_t>(Update::POWER_LEVEL), "Update::POWER_LEVEL(05)", {'0', '5'}});
+        inputs.push_back(Input{static_cast<uint32_t>(Update::POWER_LEVEL), "Update::POWER_LEVEL(10)", {'1', '0'}});
+    }
+    return inputs;
+}
+
+typedef std::array<char, CoreSnapshotSize> Key;
+
+struct KeyHash
+{
+    size_t operator()(const Key& key) const
+    {
+        //FNV-1a
+        uint64_t hash {0xcbf29ce484222325ull};
+        for(const char c : key) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+// Configurations seen so far and the id each got, safe to use from any
+// number of threads. A key's shard comes from the top bits of its hash,
+// the shard's own map uses all of them.
+class VisitedSet
+{
+public:
+    VisitedSet()
+        : shards{new Shard[SHARDS]}
+        , next{0}
+    {
+    }
+
+    //id of key, inserted tells whether this call added it
+    uint32_t insert(const Key& key, bool& inserted)
+    {
+        const size_t hash {KeyHash()(key)};
+        Shard& shard {shards[(hash >> 58) % SHARDS]};
+        std::lock_guard<std::mutex> guard(shard.lock);
+        const auto found {shard.ids.find(key)};
+        if(shard.ids.end() != found) {
+            inserted = false;
+            return found->second;
+        }
+        const uint32_t id {next.fetch_add(1, std::memory_order_relaxed)};
+        shard.ids.emplace(key, id);
+        inserted = true;
+        return id;
+    }
+
+    size_t size() const
+    {
+        return next.load();
+    }
+
+private:
+    struct alignas(64) Shard
+    {
+        std::mutex lock;
+        std::unordered_map<Key, uint32_t, KeyHash> ids;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<uint32_t> next;
+};
+
+struct Node
+{
+    Key key;
+    CoreState state;
+    uint8_t gating;             // CoreGating bits
+    uint32_t parent;
+    uint16_t input;             // that led here from parent
+    uint16_t depth;
+    bool expanded;
+    //successors other than the node itself, as (input, node)
+    std::vector<std::pair<uint16_t, uint32_t>> edges;
+};
+
+// A node found by a worker, stored once the level is done
+struct Discovery
+{
+    uint32_t id;
+    uint32_t parent;
+    uint16_t input;
+    Key key;
+    CoreState state;
+    uint8_t gating;
+};
+
+//one per worker, aligned so workers never share a cache line
+struct alignas(64) WorkerState
+{
+    std::vector<Discovery> found;
+    uint64_t transitions;
+};
+
+Key snapshot(const ProtocolCore& core)
+{
+    Key key;
+    core.saveSnapshot(key.data());
+    return key;
+}
+
+// Applies input to core, false when it does nothing in this configuration
+bool apply(ProtocolCore& core, const Input& input)
+{
+    if(0 == input.value) {
+        uint64_t due {};
+        if(!core.nextTimeout(due)) {
+            return false;
+        }
+        core.advance(due);
+        return true;
+    }
+    Message msg {};
+    msg.dst = Destination::APP;
+    msg.state = static_cast<State>(input.value);
+    memcpy(msg.data, input.data, sizeof(msg.data));
+    core.process(msg, NOW_MS);
+    return true;
+}
+
+void expand(const std::vector<Input>& inputs, std::vector<Node>& nodes, const uint32_t id,
+            VisitedSet& visited, WorkerState& worker)
+{
+    Node& node {nodes[id]};
+    ProtocolCore core;
+    for(uint16_t i {0}; i < inputs.size(); ++i) {
+        core.loadSnapshot(node.key.data(), node.key.size());
+        if(!apply(core, inputs[i])) {
+            continue;
+        }
+        ++worker.transitions;
+        const Key next {snapshot(core)};
+        if(next == node.key) {
+            continue;
+        }
+        bool inserted {false};
+        const uint32_t target {visited.insert(next, inserted)};
+        if(inserted) {
+            worker.found.push_back(Discovery{target, id, i, next, core.state(), core.gating()});
+        }
+        node.edges.emplace_back(i, target);
+    }
+    node.expanded = true;
+}
+
+std::string path(const std::vector<Input>& inputs, const std::vector<Node>& nodes, uint32_t id)
+{
+    std::vector<const std::string*> names;
+    for(; NO_PARENT != nodes[id].parent; id = nodes[id].parent) {
+        names.push_back(&inputs[nodes[id].input].name);
+    }
+    if(names.empty()) {
+        return "(start)";
+    }
+    std::string text;
+    for(auto it {names.rbegin()}; it != names.rend(); ++it) {
+        text += (text.empty() ? "" : " ") + **it;
+    }
+    return text;
+}
+
+std::string flagText(const uint8_t flags)
+{
+    std::string text;
+    const std::pair<uint8_t, const char*> names[] {
+        {GATING_CLOCK_DISABLED, "disableClockDisplay"},
+        {GATING_TIMER_DISABLED, "disableDisplayTimer"},
+        {GATING_POWER_LEVEL_DISABLED, "disablePowerLevel"},
+        {GATING_OVERLAY_ARMED, "overlayArmed"},
+        {GATING_OVERLAY_ACTIVE, "overlayActive"},
+    };
+    for(const auto& name : names) {
+        if(flags & name.first) {
+            text += (text.empty() ? "" : "|") + std::string(name.second);
+        }
+    }
+    return text.empty() ? "none" : text;
+}
+
+// Nodes from which some DisplayClock node can be reached. Nodes the depth
+// bound left unexpanded count as able to, nothing is known about them.
+std::vector<bool> reachesHome(const std::vector<Node>& nodes)
+{
+    std::vector<std::vector<uint32_t>> predecessors(nodes.size());
+    std::vector<uint32_t> queue;
+    std::vector<bool> home(nodes.size(), false);
+    for(uint32_t id {0}; id < nodes.size(); ++id) {
+        for(const auto& edge : nodes[id].edges) {
+            predecessors[edge.second].push_back(id);
+        }
+        if(CoreState::DISPLAY_CLOCK == nodes[id].state || !nodes[id].expanded) {
+            home[id] = true;
+            queue.push_back(id);
+        }
+    }
+    for(size_t i {0}; i < queue.size(); ++i) {
+        for(const uint32_t id : predecessors[queue[i]]) {
+            if(!home[id]) {
+                home[id] = true;
+                queue.push_back(id);
+            }
+        }
+    }
+    return home;
+}
+
+bool writeDot(const char* file, const std::vector<Input>& inputs, const std::vector<Node>& nodes)
+{
+    std::set<std::tuple<CoreState, CoreState, uint16_t>> relation;
+    for(const Node& node : nodes) {
+        for(const auto& edge : node.edges) {
+            const CoreState to {nodes[edge.second].state};
+            if(to != node.state) {
+                relation.emplace(node.state, to, edge.first);
+            }
+        }
+    }
+
+    FILE* out {fopen(file, "w")};
+    if(!out) {
+        perror(file);
+        return false;
+    }
+    fprintf(out, "digraph Microwave {\n");
+    for(const auto& transition : relation) {
+        fprintf(out, "    %s -> %s [label=\"%s\"];\n",
+                CoreStateName(std::get<0>(transition)),
+                CoreStateName(std::get<1>(transition)),
+                inputs[std::get<2>(transition)].name.c_str());
+    }
+    fprintf(out, "}\n");
+    fclose(out);
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    size_t workers {std::thread::hardware_concurrency()};
+    size_t maxDepth {DEFAULT_DEPTH};
+    bool updates {false};
+    const char* dotFile {nullptr};
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "-j") && i + 1 < argc) {
+            workers = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--depth") && i + 1 < argc) {
+            maxDepth = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--updates")) {
+            updates = true;
+        }
+        else if(0 == strcmp(argv[i], "--dot") && i + 1 < argc) {
+            dotFile = argv[++i];
+        }
+        else {
+            fprintf(stderr, "usage: %s [-j workers] [--depth N] [--updates] [--dot file]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(0 == workers) {
+        workers = 1;
+    }
+    if(maxDepth > UINT16_MAX) {
+        maxDepth = UINT16_MAX;
+    }
+
+    const auto start {std::chrono::steady_clock::now()};
+    const std::vector<Input> inputs {buildInputs(updates)};
+    VisitedSet visited;
+    std::vector<Node> nodes;
+    std::vector<WorkerState> states(workers, WorkerState{});
+
+    bool inserted {false};
+    const ProtocolCore reset;
+    const Key initial {snapshot(reset)};
+    nodes.push_back(Node{initial, reset.state(), reset.gating(), NO_PARENT, 0, 0, false, {}});
+    visited.insert(initial, inserted);
+
+    std::vector<uint32_t> frontier {0};
+    size_t depth {0};
+    for(; !frontier.empty() && depth < maxDepth; ++depth) {
+        std::atomic<size_t> cursor {0};
+        auto worker = [&](const size_t index) {
+            WorkerState& state {states[index]};
+            for(;;) {
+                const size_t begin {cursor.fetch_add(CHUNK, std::memory_order_relaxed)};
+                if(begin >= frontier.size()) {
+                    return;
+                }
+                const size_t end {std::min(begin + CHUNK, frontier.size())};
+                for(size_t i {begin}; i < end; ++i) {
+                    expand(inputs, nodes, frontier[i], visited, state);
+                }
+            }
+        };
+
+        //small levels are not worth waking the workers for
+        const size_t active {std::min(workers, (frontier.size() + CHUNK - 1) / CHUNK)};
+        std::vector<std::thread> threads;
+        for(size_t i {1}; i < active; ++i) {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+        for(std::thread& thread : threads) {
+            thread.join();
+        }
+
+        //ids are handed out densely, so the level's nodes fill the gap
+        nodes.resize(visited.size());
+        frontier.clear();
+        for(WorkerState& state : states) {
+            for(const Discovery& found : state.found) {
+                nodes[found.id] = Node{found.key, found.state, found.gating, found.parent, found.input,
+                                       static_cast<uint16_t>(depth + 1), false, {}};
+                frontier.push_back(found.id);
+            }
+            state.found.clear();
+        }
+        std::sort(frontier.begin(), frontier.end());
+    }
+    const bool saturated {frontier.empty()};
+    const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    uint64_t transitions {0};
+    uint64_t edges {0};
+    for(const WorkerState& state : states) {
+        transitions += state.transitions;
+    }
+    for(const Node& node : nodes) {
+        edges += node.edges.size();
+    }
+    printf("%zu configurations, %" PRIu64 " edges, %" PRIu64 " transitions tried, %zu inputs, "
+           "%zu workers, %.3f s\n", nodes.size(), edges, transitions, inputs.size(), workers, seconds);
+    if(saturated) {
+        printf("saturated at depth %zu, every reachable configuration was visited\n", depth);
+    }
+    else {
+        printf("depth bound %zu reached with %zu configurations unexpanded\n", maxDepth, frontier.size());
+    }
+
+    //first node, in breadth first order, of each leaf state and flag combination
+    std::vector<bool> seen(CoreStateCount, false);
+    std::vector<std::vector<std::pair<uint8_t, uint32_t>>> combinations(CoreStateCount);
+    for(uint32_t id {0}; id < nodes.size(); ++id) {
+        const size_t state {static_cast<size_t>(nodes[id].state)};
+        seen[state] = true;
+        auto& list {combinations[state]};
+        const auto found {std::find_if(list.begin(), list.end(), [&](const std::pair<uint8_t, uint32_t>& entry) {
+            return entry.first == nodes[id].gating;
+        })};
+        if(list.end() == found) {
+            list.emplace_back(nodes[id].gating, id);
+        }
+        else if(nodes[id].depth < nodes[found->second].depth) {
+            found->second = id;
+        }
+    }
+
+    size_t unreachable {0};
+    printf("\nunreachable states:");
+    for(size_t i {0}; i < CoreStateCount; ++i) {
+        if(!seen[i]) {
+            printf(" %s", CoreStateName(static_cast<CoreState>(i)));
+            ++unreachable;
+        }
+    }
+    printf("%s\n", unreachable ? "" : " none");
+
+    size_t deadEnds {0};
+    const std::vector<bool> home {reachesHome(nodes)};
+    printf("\ndead ends:\n");
+    for(uint32_t id {0}; id < nodes.size(); ++id) {
+        const Node& node {nodes[id]};
+        const bool stuck {node.expanded && node.edges.empty()};
+        if(!stuck && home[id]) {
+            continue;
+        }
+        ++deadEnds;
+        printf("  %s [%s] %s: %s\n", CoreStateName(node.state),
+               flagText(node.gating).c_str(), stuck ? "no way out" : "no way back to DisplayClock",
+               path(inputs, nodes, id).c_str());
+    }
+    if(0 == deadEnds) {
+        printf("  none\n");
+    }
+
+    printf("\nstates with more than one flag combination:\n");
+    bool divergent {false};
+    for(size_t i {0}; i < CoreStateCount; ++i) {
+        if(combinations[i].size() < 2) {
+            continue;
+        }
+        divergent = true;
+        printf("  %s\n", CoreStateName(static_cast<CoreState>(i)));
+        for(const auto& entry : combinations[i]) {
+            printf("    [%s] %s\n", flagText(entry.first).c_str(), path(inputs, nodes, entry.second).c_str());
+        }
+    }
+    if(!divergent) {
+        printf("  none\n");
+    }
+
+    if(dotFile && !writeDot(dotFile, inputs, nodes)) {
+        return 2;
+    }
+    return unreachable || deadEnds ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+# Fuzz target for the decoders and the protocol core, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a
+CONFIG -= qt app_bundle
+
+# qmake CONFIG+=libfuzzer with clang links libFuzzer's own main
+libfuzzer {
+    DEFINES += MICROWAVE_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer,address,undefined
+    QMAKE_LFLAGS += -fsanitize=fuzzer,address,undefined
+}
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveMessageDecoder.h \
+    ../MicrowaveFramingV2.h \
+    ../MicrowaveTimeDelta.h \
+    ../MicrowaveDisplay.h \
+    ../MicrowaveProtocolCore.h
+
+INCLUDEPATH += \
+    ../
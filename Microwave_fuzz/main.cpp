@@ -0,0 +1,274 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveMessageDecoder.h"
+#include "MicrowaveFramingV2.h"
+#include "MicrowaveDisplay.h"
+#include "MicrowaveProtocolCore.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+// Fuzz target for everything that parses bytes from the device.
+//
+//   libFuzzer:  qmake CONFIG+=libfuzzer (clang), then ./Microwave_fuzz corpus/
+//   AFL:        qmake QMAKE_CXX=afl-clang-fast++, then afl-fuzz -i in -o out -- ./Microwave_fuzz
+//   standalone: ./Microwave_fuzz [--runs N] [--seed S] [input...]
+//
+// One input drives DecodeWireMessage() and DecodeV2() at every offset, then
+// MessageDecoder::next() fed in chunks with the v2 switch-over at an
+// input-chosen point, and every decoded message through ProtocolCore with
+// its timeouts. A snapshot taken after each message must load back into an
+// identical core; anything else aborts, as do sanitizer findings.
+//
+// The standalone build runs the given inputs once each, or stdin when there
+// are none, which is what AFL without persistent mode needs. With --runs it
+// mutates valid v1/v2 streams itself and reports executions per second, for
+// machines with neither libFuzzer nor AFL.
+
+namespace {
+
+using namespace MicrowaveMsgFormat;
+
+const size_t DEFAULT_RUNS {0};
+const size_t MAX_INPUT {4096};
+
+void checkSnapshot(const ProtocolCore& core)
+{
+    char saved[CoreSnapshotSize];
+    char reloaded[CoreSnapshotSize];
+    core.saveSnapshot(saved);
+    ProtocolCore copy;
+    if(!copy.loadSnapshot(saved, sizeof(saved))) {
+        fprintf(stderr, "snapshot of a live core does not load\n");
+        abort();
+    }
+    copy.saveSnapshot(reloaded);
+    if(0 != memcmp(saved, reloaded, sizeof(saved)) || copy.state() != core.state()) {
+        fprintf(stderr, "snapshot does not round-trip\n");
+        abort();
+    }
+}
+
+void fuzzOne(const char* data, const size_t size)
+{
+    if(size < 2) {
+        return;
+    }
+    //the first two bytes steer the stream decoder, the rest is the stream
+    const size_t chunk {1u + static_cast<uint8_t>(data[0]) % 32u};
+    const size_t switchAt {static_cast<uint8_t>(data[1]) * size / 256u};
+    const char* stream {data + 2};
+    const size_t length {size - 2};
+
+    Message msg;
+    const char appMagic[WireMagicSize] {'M', 'a', 'p', 'p'};
+    for(size_t i {0}; i < length; ++i) {
+        DecodeWireMessage(stream + i, length - i, appMagic, msg);
+        size_t used {};
+        if(V2Result::MESSAGE == DecodeV2(stream + i, length - i, Destination::APP, msg, used) &&
+           (0 == used || used > length - i)) {
+            fprintf(stderr, "DecodeV2 used %zu of %zu bytes\n", used, length - i);
+            abort();
+        }
+    }
+
+    MessageDecoder decoder(Destination::APP);
+    ProtocolCore core;
+    uint64_t nowMs {0};
+    for(size_t offset {0}; offset < length; offset += chunk) {
+        if(offset >= switchAt && !decoder.isFramingV2()) {
+            decoder.setFramingV2(true);
+        }
+        decoder.append(stream + offset, std::min(chunk, length - offset));
+        while(decoder.next(msg)) {
+            if(!IsValidValue(static_cast<uint32_t>(msg.state))) {
+                fprintf(stderr, "decoder handed out unknown value %08x\n", static_cast<uint32_t>(msg.state));
+                abort();
+            }
+            nowMs += 1 + static_cast<uint8_t>(msg.data[3]) * 16;
+            uint64_t due {};
+            while(core.nextTimeout(due) && due <= nowMs) {
+                core.advance(due);
+            }
+            core.process(msg, nowMs);
+            DisplayFrame frame;
+            RenderTime(core.displayedTime(), frame);
+            checkSnapshot(core);
+        }
+    }
+    //a snapshot from the input itself must be rejected or load cleanly
+    if(length >= CoreSnapshotSizeV1) {
+        core.loadSnapshot(stream, length);
+    }
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    fuzzOne(reinterpret_cast<const char*>(data), size);
+    return 0;
+}
+
+#ifndef MICROWAVE_LIBFUZZER
+
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+__AFL_FUZZ_INIT();
+#endif
+
+namespace {
+
+std::vector<char> readFile(std::istream& in)
+{
+    return std::vector<char>{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void appendV1(std::vector<char>& out, const Message& msg)
+{
+    const Message wire {ByteSwapMessage(msg)};
+    const char* bytes {reinterpret_cast<const char*>(&wire)};
+    out.insert(out.end(), bytes, bytes + WireMessageSize);
+}
+
+void appendV2(std::vector<char>& out, const Message& msg)
+{
+    char frame[V2MaxFrameSize];
+    out.insert(out.end(), frame, frame + EncodeV2(msg, frame));
+}
+
+//a valid stream of random messages, v1 up to a point and v2 after it
+std::vector<char> makeSeed(std::mt19937& rng)
+{
+    static const uint32_t firsts[3] {static_cast<uint32_t>(State::NONE), static_cast<uint32_t>(Signal::NONE),
+                                     static_cast<uint32_t>(Update::NONE)};
+    static const uint32_t lasts[3] {static_cast<uint32_t>(State::DISPLAY_TIMER), static_cast<uint32_t>(Signal::CAPABILITIES),
+                                    static_cast<uint32_t>(Update::DISPLAY_TIMER_DELTA)};
+    std::vector<char> seed;
+    const size_t count {1 + rng() % 64};
+    const size_t switchAt {rng() % (count + 1)};
+    seed.push_back(static_cast<char>(rng()));
+    seed.push_back(static_cast<char>(switchAt * 256 / (count + 1)));
+    for(size_t i {0}; i < count; ++i) {
+        const size_t type {rng() % 3};
+        Message msg {};
+        msg.dst = Destination::APP;
+        msg.state = static_cast<State>(firsts[type] + rng() % (lasts[type] - firsts[type] + 1));
+        for(char& c : msg.data) {
+            c = static_cast<char>(rng() % 2 ? '0' + rng() % 10 : rng());
+        }
+        if(i < switchAt) {
+            appendV1(seed, msg);
+        }
+        else {
+            appendV2(seed, msg);
+        }
+    }
+    return seed;
+}
+
+void mutate(std::vector<char>& input, std::mt19937& rng)
+{
+    const size_t edits {1 + rng() % 8};
+    for(size_t i {0}; i < edits && !input.empty(); ++i) {
+        const size_t at {rng() % input.size()};
+        switch(rng() % 5) {
+        case 0:
+            input[at] = static_cast<char>(input[at] ^ (1 << (rng() % 8)));
+            break;
+        case 1:
+            input[at] = static_cast<char>(rng());
+            break;
+        case 2:
+            input.erase(input.begin() + static_cast<long>(at));
+            break;
+        case 3:
+            if(input.size() < MAX_INPUT) {
+                input.insert(input.begin() + static_cast<long>(at), static_cast<char>(rng()));
+            }
+            break;
+        default: {
+            //duplicate a span, like a retransmitted frame
+            const size_t length {std::min<size_t>(1 + rng() % 16, input.size() - at)};
+            if(input.size() + length <= MAX_INPUT) {
+                const std::vector<char> span(input.begin() + static_cast<long>(at),
+                                             input.begin() + static_cast<long>(at + length));
+                input.insert(input.begin() + static_cast<long>(rng() % input.size()), span.begin(), span.end());
+            }
+            break;
+        }
+        }
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    size_t runs {DEFAULT_RUNS};
+    uint32_t seed {1};
+    std::vector<const char*> inputs;
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if('-' != argv[i][0]) {
+            inputs.push_back(argv[i]);
+        }
+        else {
+            fprintf(stderr, "usage: %s [--runs N] [--seed S] [input...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if(0 == runs) {
+        for(const char* path : inputs) {
+            std::ifstream in(path, std::ios::binary);
+            if(!in) {
+                fprintf(stderr, "%s: unreadable\n", path);
+                return 1;
+            }
+            const std::vector<char> data {readFile(in)};
+            fuzzOne(data.data(), data.size());
+        }
+        if(inputs.empty()) {
+#ifdef __AFL_FUZZ_TESTCASE_LEN
+            //AFL persistent mode, one process for many inputs
+            const unsigned char* buf {__AFL_FUZZ_TESTCASE_BUF};
+            while(__AFL_LOOP(10000)) {
+                fuzzOne(reinterpret_cast<const char*>(buf), static_cast<size_t>(__AFL_FUZZ_TESTCASE_LEN));
+            }
+#else
+            std::ios::sync_with_stdio(false);
+            const std::vector<char> data {readFile(std::cin)};
+            fuzzOne(data.data(), data.size());
+#endif
+        }
+        return 0;
+    }
+
+    std::mt19937 rng(seed);
+    const auto start {std::chrono::steady_clock::now()};
+    size_t bytes {0};
+    for(size_t run {0}; run < runs; ++run) {
+        std::vector<char> input {makeSeed(rng)};
+        mutate(input, rng);
+        bytes += input.size();
+        fuzzOne(input.data(), input.size());
+    }
+    const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    printf("%zu runs, %.0f exec/s, %.0f bytes per input, seed %u\n",
+           runs, static_cast<double>(runs) / seconds, static_cast<double>(bytes) / static_cast<double>(runs), seed);
+    return 0;
+}
+
+#endif // MICROWAVE_LIBFUZZER
@@ -0,0 +1,23 @@
+# One device connection shared by many apps, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp \
+    proxy.cpp \
+    proxyio.cpp \
+    epollio.cpp \
+    uringio.cpp
+
+HEADERS += \
+    proxy.h \
+    proxyio.h \
+    epollio.h \
+    uringio.h \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveMessageDecoder.h \
+    ../MicrowaveFramingV2.h
+
+INCLUDEPATH += \
+    ../
@@ -0,0 +1,225 @@
+#include "epollio.h"
+
+#include <cerrno>
+#include <cstdio>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const int MAX_EVENTS {64};
+const size_t READ_SIZE {16384};
+
+}
+
+EpollIo::EpollIo()
+    : epollFd{epoll_create1(EPOLL_CLOEXEC)}
+    , connections{}
+{
+}
+
+EpollIo::~EpollIo()
+{
+    for(auto& entry : connections) {
+        ::close(entry.first);
+    }
+    ::close(epollFd);
+}
+
+const char* EpollIo::name() const
+{
+    return "epoll";
+}
+
+bool EpollIo::listen(const sockaddr_in& addr)
+{
+    const int fd {socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)};
+    const int one {1};
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if(-1 == bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) ||
+       -1 == ::listen(fd, SOMAXCONN)) {
+        perror("listen");
+        ::close(fd);
+        return false;
+    }
+    connections[fd] = Connection{OutputQueue{}, true, false, false};
+    watch(EPOLL_CTL_ADD, fd, EPOLLIN);
+    return true;
+}
+
+int EpollIo::connect(const sockaddr_in& addr)
+{
+    const int fd {socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)};
+    ++syscallCount;
+    if(-1 == fd) {
+        return -1;
+    }
+    setNoDelay(fd);
+    const int result {::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))};
+    ++syscallCount;
+    if(-1 == result && EINPROGRESS != errno) {
+        ::close(fd);
+        return -1;
+    }
+    //the outcome shows as the socket turning writable
+    connections[fd] = Connection{OutputQueue{}, false, true, true};
+    watch(EPOLL_CTL_ADD, fd, EPOLLIN | EPOLLOUT);
+    return fd;
+}
+
+void EpollIo::send(const int fd, SharedBuffer buffer)
+{
+    const auto found {connections.find(fd)};
+    if(connections.end() == found) {
+        return;
+    }
+    Connection& connection {found->second};
+    connection.out.push(std::move(buffer));
+    if(!connection.connecting && !connection.writing) {
+        flush(fd, connection);
+    }
+}
+
+size_t EpollIo::queued(const int fd) const
+{
+    const auto found {connections.find(fd)};
+    return connections.end() == found ? 0 : found->second.out.size();
+}
+
+void EpollIo::close(const int fd)
+{
+    if(connections.erase(fd)) {
+        //also leaves the epoll set
+        ::close(fd);
+        ++syscallCount;
+    }
+}
+
+void EpollIo::run(Handler& handler, const volatile sig_atomic_t& running)
+{
+    epoll_event events[MAX_EVENTS];
+    while(running) {
+        const int count {epoll_wait(epollFd, events, MAX_EVENTS, timeoutMs(handler.onIdle()))};
+        ++syscallCount;
+        for(int i {0}; i < count; ++i) {
+            dispatch(handler, events[i].data.fd, events[i].events);
+        }
+    }
+}
+
+void EpollIo::watch(const int op, const int fd, const uint32_t events)
+{
+    epoll_event event {};
+    event.events = events;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, op, fd, &event);
+    ++syscallCount;
+}
+
+void EpollIo::flush(const int fd, Connection& connection)
+{
+    iovec iov[MAX_IOV];
+    while(!connection.out.isEmpty()) {
+        const size_t count {connection.out.gather(iov, MAX_IOV)};
+        const ssize_t written {writev(fd, iov, static_cast<int>(count))};
+        ++syscallCount;
+        if(written < 0) {
+            if(EAGAIN == errno || EINTR == errno) {
+                break;
+            }
+            //reported from the event loop once the hangup shows, never from
+            // inside a send() the handler is in the middle of
+            connection.out.clear();
+            shutdown(fd, SHUT_RDWR);
+            ++syscallCount;
+            break;
+        }
+        connection.out.consume(static_cast<size_t>(written));
+    }
+
+    const bool pending {!connection.out.isEmpty()};
+    if(pending != connection.writing) {
+        connection.writing = pending;
+        watch(EPOLL_CTL_MOD, fd, EPOLLIN | (pending ? static_cast<uint32_t>(EPOLLOUT) : 0u));
+    }
+}
+
+void EpollIo::dispatch(Handler& handler, const int fd, const uint32_t events)
+{
+    auto found {connections.find(fd)};
+    if(connections.end() == found) {
+        return;
+    }
+    if(found->second.listening) {
+        accept(handler, fd);
+        return;
+    }
+
+    if(found->second.connecting) {
+        if(!(events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+        int error {0};
+        socklen_t size {sizeof(error)};
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size);
+        ++syscallCount;
+        if(0 != error) {
+            close(fd);
+            handler.onConnected(fd, false);
+            return;
+        }
+        found->second.connecting = false;
+        handler.onConnected(fd, true);
+        found = connections.find(fd);
+        if(connections.end() == found) {
+            return;
+        }
+    }
+
+    if(events & EPOLLIN) {
+        char data[READ_SIZE];
+        const ssize_t size {read(fd, data, sizeof(data))};
+        ++syscallCount;
+        if(0 == size || (size < 0 && EAGAIN != errno && EINTR != errno)) {
+            fail(handler, fd);
+            return;
+        }
+        if(size > 0) {
+            handler.onReceived(fd, data, static_cast<size_t>(size));
+        }
+        //the handler may have closed it
+        found = connections.find(fd);
+        if(connections.end() == found) {
+            return;
+        }
+    }
+    if(events & EPOLLOUT) {
+        flush(fd, found->second);
+    }
+    if((events & (EPOLLERR | EPOLLHUP)) && !(events & EPOLLIN)) {
+        fail(handler, fd);
+    }
+}
+
+void EpollIo::accept(Handler& handler, const int listenFd)
+{
+    for(;;) {
+        const int fd {accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)};
+        ++syscallCount;
+        if(-1 == fd) {
+            return;
+        }
+        setNoDelay(fd);
+        connections[fd] = Connection{OutputQueue{}, false, false, false};
+        watch(EPOLL_CTL_ADD, fd, EPOLLIN);
+        handler.onAccepted(fd);
+    }
+}
+
+void EpollIo::fail(Handler& handler, const int fd)
+{
+    close(fd);
+    handler.onClosed(fd);
+}
@@ -0,0 +1,45 @@
+#ifndef EPOLLIO_H
+#define EPOLLIO_H
+
+#include "proxyio.h"
+
+#include <unordered_map>
+
+// Readiness based backend: one epoll_wait per loop, then a read, writev or
+// accept4 per ready socket. Runs on any Linux.
+class EpollIo : public ProxyIo
+{
+public:
+    EpollIo();
+    ~EpollIo();
+
+    const char* name() const override;
+
+    bool listen(const sockaddr_in& addr) override;
+    int connect(const sockaddr_in& addr) override;
+    void send(const int fd, SharedBuffer buffer) override;
+    size_t queued(const int fd) const override;
+    void close(const int fd) override;
+
+    void run(Handler& handler, const volatile sig_atomic_t& running) override;
+
+private:
+    struct Connection
+    {
+        OutputQueue out;
+        bool listening;
+        bool connecting;
+        bool writing;       // EPOLLOUT armed
+    };
+
+    int epollFd;
+    std::unordered_map<int, Connection> connections;
+
+    void watch(const int op, const int fd, const uint32_t events);
+    void flush(const int fd, Connection& connection);
+    void dispatch(Handler& handler, const int fd, const uint32_t events);
+    void accept(Handler& handler, const int listenFd);
+    void fail(Handler& handler, const int fd);
+};
+
+#endif // EPOLLIO_H
@@ -0,0 +1,90 @@
+#include "proxy.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+
+//   Microwave_proxy [--listen [host:]port] [--device host:port] [--io uring|epoll]
+//
+// See Proxy for what it does. Socket I/O goes through io_uring where the
+// kernel has it and through epoll otherwise.
+
+namespace {
+
+const uint16_t DEFAULT_PORT {60002};
+const char* const DEFAULT_DEVICE {"192.168.0.10"};
+
+volatile sig_atomic_t running {1};
+
+void onSignal(int)
+{
+    running = 0;
+}
+
+bool parseEndpoint(const char* text, sockaddr_in& addr, const char* defaultHost)
+{
+    std::string host {defaultHost};
+    std::string port {text};
+    const char* colon {strrchr(text, ':')};
+    if(colon) {
+        host.assign(text, static_cast<size_t>(colon - text));
+        port = colon + 1;
+    }
+    char* end {nullptr};
+    const unsigned long value {strtoul(port.c_str(), &end, 10)};
+    addr = sockaddr_in{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(value));
+    return !port.empty() && '\0' == *end && value > 0 && value <= 0xFFFF &&
+           1 == inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    const char* listenText {nullptr};
+    const char* ioText {nullptr};
+    std::string deviceText {std::string(DEFAULT_DEVICE) + ':' + std::to_string(DEFAULT_PORT)};
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--listen") && i + 1 < argc) {
+            listenText = argv[++i];
+        }
+        else if(0 == strcmp(argv[i], "--device") && i + 1 < argc) {
+            deviceText = argv[++i];
+        }
+        else if(0 == strcmp(argv[i], "--io") && i + 1 < argc) {
+            ioText = argv[++i];
+        }
+        else {
+            fprintf(stderr, "usage: %s [--listen [host:]port] [--device host:port] [--io uring|epoll]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sockaddr_in listenAddr {};
+    sockaddr_in deviceAddr {};
+    const std::string defaultListen {std::to_string(DEFAULT_PORT)};
+    if(!parseEndpoint(listenText ? listenText : defaultListen.c_str(), listenAddr, "0.0.0.0") ||
+       !parseEndpoint(deviceText.c_str(), deviceAddr, DEFAULT_DEVICE)) {
+        fprintf(stderr, "invalid endpoint\n");
+        return 2;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::unique_ptr<ProxyIo> io {ProxyIo::create(ioText)};
+    if(!io->listen(listenAddr)) {
+        return 1;
+    }
+    Proxy proxy(*io, deviceAddr);
+    io->run(proxy, running);
+    proxy.printStats();
+    return 0;
+}
@@ -0,0 +1,277 @@
+#include "proxy.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include <sys/resource.h>
+
+using namespace MicrowaveMsgFormat;
+
+namespace {
+
+//an app further behind than this is disconnected
+const size_t CLIENT_MAX_QUEUED {64 * 1024};
+//STATE_REQUESTs from every app are merged into one upstream while a reply
+// is due; after this the next one goes to the device even if none came
+const auto STATE_REQUEST_IN_FLIGHT {std::chrono::milliseconds(StateReplyWindowMs)};
+const auto RECONNECT_MIN_DELAY {std::chrono::milliseconds(500)};
+const auto RECONNECT_MAX_DELAY {std::chrono::milliseconds(30000)};
+const auto STATS_INTERVAL {std::chrono::seconds(60)};
+
+void appendWire(const Message& msg, std::vector<char>& out)
+{
+    const Message wire {ByteSwapMessage(msg)};
+    const char* bytes {reinterpret_cast<const char*>(&wire)};
+    out.insert(out.end(), bytes, bytes + WireMessageSize);
+}
+
+double cpuSeconds()
+{
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) +
+           static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+}
+
+Proxy::Proxy(ProxyIo& io, const sockaddr_in& deviceAddr)
+    : io{io}
+    , deviceAddr{deviceAddr}
+    , upstreamFd{-1}
+    , upstreamConnected{false}
+    , upstreamDecoder{Destination::APP}
+    , reconnectDelay{RECONNECT_MIN_DELAY}
+    , reconnectAt{Clock::now()}
+    , stateRequestInFlight{false}
+    , stateRequestSentAt{}
+    , clients{}
+    , statsAt{Clock::now() + STATS_INTERVAL}
+    , stats{}
+{
+}
+
+Proxy::~Proxy()
+{
+    for(auto& entry : clients) {
+        io.close(entry.first);
+    }
+    if(-1 != upstreamFd) {
+        io.close(upstreamFd);
+    }
+}
+
+void Proxy::onAccepted(const int fd)
+{
+    if(!upstreamConnected) {
+        //the app retries with back-off, as it would against the board
+        io.close(fd);
+        return;
+    }
+    clients.emplace(fd, MessageDecoder{Destination::DEV});
+    fprintf(stderr, "app attached (%zu)\n", clients.size());
+}
+
+void Proxy::onConnected(const int fd, const bool ok)
+{
+    if(fd != upstreamFd) {
+        return;
+    }
+    if(!ok) {
+        //already closed by the backend
+        upstreamFd = -1;
+        dropUpstream();
+        return;
+    }
+    upstreamConnected = true;
+    reconnectDelay = RECONNECT_MIN_DELAY;
+    fprintf(stderr, "device connected\n");
+}
+
+void Proxy::onReceived(const int fd, const char* data, const size_t size)
+{
+    if(fd == upstreamFd) {
+        readUpstream(data, size);
+        return;
+    }
+    const auto found {clients.find(fd)};
+    if(clients.end() != found) {
+        readClient(fd, found->second, data, size);
+    }
+}
+
+void Proxy::onClosed(const int fd)
+{
+    if(fd == upstreamFd) {
+        upstreamFd = -1;
+        dropUpstream();
+        return;
+    }
+    if(clients.erase(fd)) {
+        fprintf(stderr, "app detached (%zu)\n", clients.size());
+    }
+}
+
+ProxyIo::Clock::time_point Proxy::onIdle()
+{
+    const auto now {Clock::now()};
+    if(-1 == upstreamFd && now >= reconnectAt) {
+        connectUpstream();
+    }
+    if(now >= statsAt) {
+        printStats();
+        statsAt = now + STATS_INTERVAL;
+    }
+    return -1 == upstreamFd ? std::min(reconnectAt, statsAt) : statsAt;
+}
+
+void Proxy::printStats() const
+{
+    const double cpu {cpuSeconds()};
+    const uint64_t syscalls {io.syscalls()};
+    const double frames {static_cast<double>(stats.framesOut + stats.commandsIn)};
+    fprintf(stderr, "%zu apps, device %s: %" PRIu64 " frames in, %" PRIu64 " fanned out, "
+            "%" PRIu64 " commands in, %" PRIu64 " sent, %" PRIu64 " state requests merged, "
+            "%" PRIu64 " capabilities answered, %" PRIu64 " apps dropped for lag\n",
+            clients.size(), upstreamConnected ? "up" : "down",
+            stats.framesIn, stats.framesOut, stats.commandsIn, stats.commandsOut,
+            stats.stateRequestsMerged, stats.capabilitiesAnswered, stats.clientsDropped);
+    //frames counts what moved through the apps' sockets, both ways
+    fprintf(stderr, "%s: %" PRIu64 " syscalls, %.3f per frame, %.3f s CPU, %.3f s per 1M frames\n",
+            io.name(), syscalls, frames > 0 ? static_cast<double>(syscalls) / frames : 0.0,
+            cpu, frames > 0 ? cpu * 1e6 / frames : 0.0);
+}
+
+void Proxy::connectUpstream()
+{
+    upstreamFd = io.connect(deviceAddr);
+    if(-1 == upstreamFd) {
+        dropUpstream();
+    }
+}
+
+void Proxy::dropUpstream()
+{
+    if(-1 != upstreamFd) {
+        io.close(upstreamFd);
+        upstreamFd = -1;
+    }
+    if(upstreamConnected) {
+        fprintf(stderr, "device disconnected, dropping %zu apps\n", clients.size());
+        while(!clients.empty()) {
+            dropClient(clients.begin()->first);
+        }
+    }
+    upstreamConnected = false;
+    upstreamDecoder.reset();
+    stateRequestInFlight = false;
+
+    //apps are refused until the device is back, so only this one upstream
+    // dial is retried; the wait doubles per failure up to the maximum
+    reconnectAt = Clock::now() + reconnectDelay;
+    reconnectDelay = std::min<Clock::duration>(reconnectDelay * 2, RECONNECT_MAX_DELAY);
+}
+
+void Proxy::readUpstream(const char* data, const size_t size)
+{
+    upstreamDecoder.append(data, size);
+
+    //everything decoded from this read goes out as one shared buffer
+    auto frames {std::make_shared<std::vector<char>>()};
+    Message msg;
+    while(upstreamDecoder.next(msg)) {
+        ++stats.framesIn;
+        if(!IsValidValue(static_cast<uint32_t>(msg.state))) {
+            continue;
+        }
+        if(Type::STATE == static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
+            stateRequestInFlight = false;
+        }
+        appendWire(msg, *frames);
+    }
+    if(frames->empty()) {
+        return;
+    }
+
+    const SharedBuffer shared {std::move(frames)};
+    const uint64_t count {shared->size() / WireMessageSize};
+    std::vector<int> lagging;
+    for(auto& entry : clients) {
+        if(!enqueue(entry.first, shared)) {
+            lagging.push_back(entry.first);
+            continue;
+        }
+        stats.framesOut += count;
+    }
+    for(const int fd : lagging) {
+        ++stats.clientsDropped;
+        dropClient(fd);
+    }
+}
+
+void Proxy::dropClient(const int fd)
+{
+    io.close(fd);
+    clients.erase(fd);
+    fprintf(stderr, "app detached (%zu)\n", clients.size());
+}
+
+void Proxy::readClient(const int fd, MessageDecoder& decoder, const char* data, const size_t size)
+{
+    decoder.append(data, size);
+
+    //commands from one read go upstream in one send
+    auto commands {std::make_shared<std::vector<char>>()};
+    bool lagging {false};
+    Message msg;
+    while(decoder.next(msg)) {
+        ++stats.commandsIn;
+        if(!IsValidValue(static_cast<uint32_t>(msg.state))) {
+            continue;
+        }
+        switch(msg.signal) {
+        case Signal::CAPABILITIES: {
+            Message reply {msg};
+            reply.dst = Destination::APP;
+            reply.data[0] = 0;
+            reply.data[1] = 1;
+            auto frame {std::make_shared<std::vector<char>>()};
+            appendWire(reply, *frame);
+            ++stats.capabilitiesAnswered;
+            lagging = lagging || !enqueue(fd, std::move(frame));
+            break;
+        }
+        case Signal::STATE_REQUEST:
+            if(stateRequestInFlight && Clock::now() - stateRequestSentAt < STATE_REQUEST_IN_FLIGHT) {
+                ++stats.stateRequestsMerged;
+                break;
+            }
+            stateRequestInFlight = true;
+            stateRequestSentAt = Clock::now();
+            appendWire(msg, *commands);
+            break;
+        default:
+            appendWire(msg, *commands);
+            break;
+        }
+    }
+
+    if(upstreamConnected && !commands->empty()) {
+        stats.commandsOut += commands->size() / WireMessageSize;
+        io.send(upstreamFd, std::move(commands));
+    }
+    if(lagging) {
+        ++stats.clientsDropped;
+        dropClient(fd);
+    }
+}
+
+//false when the app is too far behind to keep
+bool Proxy::enqueue(const int fd, const SharedBuffer& buffer)
+{
+    if(io.queued(fd) + buffer->size() > CLIENT_MAX_QUEUED) {
+        return false;
+    }
+    io.send(fd, buffer);
+    return true;
+}
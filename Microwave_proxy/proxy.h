@@ -0,0 +1,81 @@
+#ifndef PROXY_H
+#define PROXY_H
+
+#include "proxyio.h"
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveMessageDecoder.h"
+
+#include <unordered_map>
+
+// Connection multiplexer between one device board and many apps.
+//
+// Holds a single upstream connection to the board. DEV->APP frames are
+// decoded once, re-encoded once into a shared buffer and queued by
+// reference on every attached app, so fanning out costs no copy per app.
+// APP->DEV frames from all apps are decoded and forwarded upstream one
+// whole frame at a time in arrival order.
+//
+// The upstream load does not grow with the number of apps:
+//  - CAPABILITIES is answered by the proxy with no capabilities, so every
+//    app stays on the original protocol and the shared bytes suit all of
+//    them; the board is never asked to switch.
+//  - A STATE_REQUEST is only forwarded when none is waiting for its State
+//    reply, which goes out to every app anyway.
+// Apps are dropped while the board is unreachable and when they stop
+// reading, so they show stale values and reconnect like they would to the
+// board itself.
+class Proxy : public ProxyIo::Handler
+{
+public:
+    Proxy(ProxyIo& io, const sockaddr_in& deviceAddr);
+    ~Proxy();
+
+    void onAccepted(const int fd) override;
+    void onConnected(const int fd, const bool ok) override;
+    void onReceived(const int fd, const char* data, const size_t size) override;
+    void onClosed(const int fd) override;
+    ProxyIo::Clock::time_point onIdle() override;
+
+    void printStats() const;
+
+private:
+    typedef ProxyIo::Clock Clock;
+
+    struct Stats
+    {
+        uint64_t framesIn;          // DEV->APP frames from the board
+        uint64_t framesOut;         // DEV->APP frames queued to apps
+        uint64_t commandsIn;        // APP->DEV frames from apps
+        uint64_t commandsOut;       // APP->DEV frames sent to the board
+        uint64_t stateRequestsMerged;
+        uint64_t capabilitiesAnswered;
+        uint64_t clientsDropped;    // for not keeping up
+    };
+
+    ProxyIo& io;
+    sockaddr_in deviceAddr;
+
+    int upstreamFd;
+    bool upstreamConnected;
+    MicrowaveMsgFormat::MessageDecoder upstreamDecoder;
+    Clock::duration reconnectDelay;
+    Clock::time_point reconnectAt;
+
+    bool stateRequestInFlight;
+    Clock::time_point stateRequestSentAt;
+
+    //decoder of each attached app
+    std::unordered_map<int, MicrowaveMsgFormat::MessageDecoder> clients;
+    Clock::time_point statsAt;
+    Stats stats;
+
+    void connectUpstream();
+    void dropUpstream();
+    void readUpstream(const char* data, const size_t size);
+
+    void dropClient(const int fd);
+    void readClient(const int fd, MicrowaveMsgFormat::MessageDecoder& decoder, const char* data, const size_t size);
+    bool enqueue(const int fd, const SharedBuffer& buffer);
+};
+
+#endif // PROXY_H
@@ -0,0 +1,99 @@
+#include "proxyio.h"
+#include "epollio.h"
+#include "uringio.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+OutputQueue::OutputQueue()
+    : buffers{}
+    , offset{0}
+    , bytes{0}
+{
+}
+
+void OutputQueue::push(SharedBuffer buffer)
+{
+    if(buffer->empty()) {
+        return;
+    }
+    bytes += buffer->size();
+    buffers.push_back(std::move(buffer));
+}
+
+size_t OutputQueue::gather(iovec* iov, const size_t max) const
+{
+    size_t count {0};
+    size_t skip {offset};
+    for(const SharedBuffer& buffer : buffers) {
+        if(max == count) {
+            break;
+        }
+        iov[count].iov_base = const_cast<char*>(buffer->data() + skip);
+        iov[count].iov_len = buffer->size() - skip;
+        ++count;
+        skip = 0;
+    }
+    return count;
+}
+
+void OutputQueue::consume(size_t written)
+{
+    bytes -= std::min(written, bytes);
+    while(written > 0 && !buffers.empty()) {
+        const size_t rest {buffers.front()->size() - offset};
+        if(written < rest) {
+            offset += written;
+            return;
+        }
+        written -= rest;
+        offset = 0;
+        buffers.pop_front();
+    }
+}
+
+void OutputQueue::clear()
+{
+    buffers.clear();
+    offset = 0;
+    bytes = 0;
+}
+
+size_t OutputQueue::size() const
+{
+    return bytes;
+}
+
+bool OutputQueue::isEmpty() const
+{
+    return buffers.empty();
+}
+
+std::unique_ptr<ProxyIo> ProxyIo::create(const char* preference)
+{
+    if(!preference || 0 != strcmp(preference, "epoll")) {
+        std::unique_ptr<UringIo> uring {new UringIo()};
+        if(uring->isValid()) {
+            return std::unique_ptr<ProxyIo>(uring.release());
+        }
+        fprintf(stderr, "io_uring unavailable, using epoll\n");
+    }
+    return std::unique_ptr<ProxyIo>(new EpollIo());
+}
+
+int ProxyIo::timeoutMs(const Clock::time_point deadline)
+{
+    const int64_t ms {std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count() + 1};
+    return static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(ms, 60000)));
+}
+
+void ProxyIo::setNoDelay(const int fd)
+{
+    const int one {1};
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    ++syscallCount;
+}
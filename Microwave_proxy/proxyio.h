@@ -0,0 +1,103 @@
+#ifndef PROXYIO_H
+#define PROXYIO_H
+
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/uio.h>
+
+// Frames shared by every queue that references them
+typedef std::shared_ptr<const std::vector<char>> SharedBuffer;
+
+// Bytes waiting to go out on one connection, in order. Queuing a buffer
+// only takes a reference, so frames fanned out to many connections exist
+// once.
+class OutputQueue
+{
+public:
+    OutputQueue();
+
+    void push(SharedBuffer buffer);
+    //fills iov with what is not written yet, returns the entries used
+    size_t gather(iovec* iov, const size_t max) const;
+    //drops bytes that have been written
+    void consume(size_t bytes);
+    void clear();
+
+    size_t size() const;
+    bool isEmpty() const;
+
+private:
+    std::deque<SharedBuffer> buffers;
+    size_t offset;      // into buffers.front()
+    size_t bytes;
+};
+
+// Socket I/O behind the proxy.
+//
+// The proxy decides what goes where, a backend moves the bytes and reports
+// back through Handler, all on the thread inside run(). Backends never call
+// the handler from send() or close(), so the proxy can change its own
+// bookkeeping freely while it issues them. A connection the backend finds
+// broken is closed by the backend and reported with onClosed(); one the
+// proxy closes is not reported.
+class ProxyIo
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    class Handler
+    {
+    public:
+        virtual ~Handler() = default;
+
+        virtual void onAccepted(const int fd) = 0;
+        //result of connect()
+        virtual void onConnected(const int fd, const bool ok) = 0;
+        virtual void onReceived(const int fd, const char* data, const size_t size) = 0;
+        virtual void onClosed(const int fd) = 0;
+        //runs the handler's own timers, returns when it wants to run again
+        virtual Clock::time_point onIdle() = 0;
+    };
+
+    //how many iovecs one write takes at most
+    static const size_t MAX_IOV {64};
+
+    virtual ~ProxyIo() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual bool listen(const sockaddr_in& addr) = 0;
+    //outcome through onConnected(), -1 when no socket could be made
+    virtual int connect(const sockaddr_in& addr) = 0;
+    virtual void send(const int fd, SharedBuffer buffer) = 0;
+    //bytes queued on fd and not written yet
+    virtual size_t queued(const int fd) const = 0;
+    virtual void close(const int fd) = 0;
+
+    virtual void run(Handler& handler, const volatile sig_atomic_t& running) = 0;
+
+    uint64_t syscalls() const
+    {
+        return syscallCount;
+    }
+
+    //io_uring where the kernel supports it, epoll otherwise or when
+    // preference is "epoll"
+    static std::unique_ptr<ProxyIo> create(const char* preference);
+
+protected:
+    uint64_t syscallCount {0};
+
+    static int timeoutMs(const Clock::time_point deadline);
+    //TCP_NODELAY, one syscall
+    void setNoDelay(const int fd);
+};
+
+#endif // PROXYIO_H
@@ -0,0 +1,490 @@
+#include "uringio.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+const unsigned SQ_ENTRIES {256};
+const unsigned CQ_ENTRIES {4096};
+const uint16_t BUFFER_GROUP {0};
+const unsigned BUFFER_COUNT {256};
+const unsigned BUFFER_SIZE {16384};
+const uint64_t OP_MASK {7};
+
+template<typename T>
+T loadAcquire(const T* p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+void storeRelease(T* p, const T value)
+{
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+}
+
+UringIo::UringIo()
+    : ringFd{-1}
+    , valid{false}
+    , sqRing{MAP_FAILED}
+    , sqRingSize{0}
+    , sqHead{nullptr}
+    , sqTail{nullptr}
+    , sqMask{0}
+    , sqEntries{0}
+    , sqLocalTail{0}
+    , sqes{nullptr}
+    , sqesSize{0}
+    , cqHead{nullptr}
+    , cqTail{nullptr}
+    , cqMask{0}
+    , cqes{nullptr}
+    , buffers{nullptr}
+    , parked{}
+    , reaping{}
+    , byFd{}
+    , live{}
+    , dirty{}
+{
+    valid = setup();
+}
+
+UringIo::~UringIo()
+{
+    //closing the ring cancels whatever is still in flight
+    if(-1 != ringFd) {
+        ::close(ringFd);
+    }
+    for(Connection* connection : live) {
+        if(!connection->closed) {
+            ::close(connection->fd);
+        }
+        delete connection;
+    }
+    if(sqes) {
+        munmap(sqes, sqesSize);
+    }
+    if(MAP_FAILED != sqRing) {
+        munmap(sqRing, sqRingSize);
+    }
+    delete[] buffers;
+}
+
+bool UringIo::isValid() const
+{
+    return valid;
+}
+
+const char* UringIo::name() const
+{
+    return "io_uring";
+}
+
+bool UringIo::setup()
+{
+    io_uring_params params {};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL |
+                   IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = CQ_ENTRIES;
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, SQ_ENTRIES, &params));
+    if(-1 == ringFd) {
+        return false;
+    }
+    const unsigned required {IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG};
+    if(required != (params.features & required)) {
+        return false;
+    }
+
+    //one mapping holds both rings
+    const size_t sqSize {params.sq_off.array + params.sq_entries * sizeof(unsigned)};
+    const size_t cqSize {params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe)};
+    sqRingSize = sqSize > cqSize ? sqSize : cqSize;
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if(MAP_FAILED == sqRing) {
+        return false;
+    }
+    char* const base {static_cast<char*>(sqRing)};
+    sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    sqLocalTail = *sqTail;
+    unsigned* const array {reinterpret_cast<unsigned*>(base + params.sq_off.array)};
+    for(unsigned i {0}; i < sqEntries; ++i) {
+        array[i] = i;
+    }
+    cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* const sqeMap {mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES)};
+    if(MAP_FAILED == sqeMap) {
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqeMap);
+
+    //handed to the kernel with the first submission
+    buffers = new char[static_cast<size_t>(BUFFER_COUNT) * BUFFER_SIZE];
+    io_uring_sqe* sqe {nextSqe()};
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(BUFFER_COUNT);
+    sqe->addr = reinterpret_cast<uint64_t>(buffers);
+    sqe->len = BUFFER_SIZE;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    return true;
+}
+
+bool UringIo::listen(const sockaddr_in& addr)
+{
+    const int fd {socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    const int one {1};
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if(-1 == bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) ||
+       -1 == ::listen(fd, SOMAXCONN)) {
+        perror("listen");
+        ::close(fd);
+        return false;
+    }
+    Connection* connection {add(fd)};
+    connection->listening = true;
+    armAccept(*connection);
+    return true;
+}
+
+int UringIo::connect(const sockaddr_in& addr)
+{
+    //blocking sockets, the ring waits for them without tying up a thread
+    const int fd {socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    ++syscallCount;
+    if(-1 == fd) {
+        return -1;
+    }
+    setNoDelay(fd);
+    Connection* connection {add(fd)};
+    connection->peer = addr;
+    io_uring_sqe* sqe {nextSqe()};
+    prepare(sqe, IORING_OP_CONNECT, *connection, Op::CONNECT);
+    sqe->addr = reinterpret_cast<uint64_t>(&connection->peer);
+    sqe->off = sizeof(connection->peer);
+    return fd;
+}
+
+void UringIo::send(const int fd, SharedBuffer buffer)
+{
+    Connection* connection {find(fd)};
+    if(!connection) {
+        return;
+    }
+    connection->out.push(std::move(buffer));
+    if(connection->connected) {
+        markDirty(*connection);
+    }
+}
+
+size_t UringIo::queued(const int fd) const
+{
+    const Connection* connection {find(fd)};
+    return connection ? connection->out.size() : 0;
+}
+
+void UringIo::close(const int fd)
+{
+    Connection* connection {find(fd)};
+    if(connection) {
+        shut(*connection);
+        release(connection);
+    }
+}
+
+void UringIo::run(Handler& handler, const volatile sig_atomic_t& running)
+{
+    while(running) {
+        const int timeout {timeoutMs(handler.onIdle())};
+        flushDirty();
+        enter(true, timeout);
+        reap(handler);
+    }
+}
+
+io_uring_sqe* UringIo::nextSqe()
+{
+    //full, hand what is there to the kernel now. It takes nothing while its
+    // completions are backed up, so make room in the completion ring and go
+    // again; the parked completions are handled by the next reap()
+    while(sqLocalTail - loadAcquire(sqHead) >= sqEntries) {
+        const int result {enter(false, 0)};
+        if(-EBUSY == result || -EAGAIN == result) {
+            park();
+        }
+    }
+    io_uring_sqe* sqe {&sqes[sqLocalTail & sqMask]};
+    memset(sqe, 0, sizeof(*sqe));
+    ++sqLocalTail;
+    return sqe;
+}
+
+int UringIo::enter(const bool wait, const int timeoutMs)
+{
+    storeRelease(sqTail, sqLocalTail);
+    const unsigned submit {sqLocalTail - loadAcquire(sqHead)};
+
+    __kernel_timespec ts {};
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+    io_uring_getevents_arg arg {};
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    const unsigned flags {IORING_ENTER_EXT_ARG | (wait ? static_cast<unsigned>(IORING_ENTER_GETEVENTS) : 0u)};
+    const long result {syscall(__NR_io_uring_enter, ringFd, submit, wait ? 1u : 0u, flags, &arg, sizeof(arg))};
+    ++syscallCount;
+    if(-1 != result) {
+        return static_cast<int>(result);
+    }
+    //ETIME and EINTR just end the wait, EBUSY and EAGAIN leave the
+    // submissions queued until completions are consumed. Anything else means
+    // the ring itself is broken and nothing queued would ever complete.
+    const int error {errno};
+    if(ETIME != error && EINTR != error && EBUSY != error && EAGAIN != error) {
+        perror("io_uring_enter");
+        abort();
+    }
+    return -error;
+}
+
+void UringIo::park()
+{
+    unsigned head {*cqHead};
+    const unsigned tail {loadAcquire(cqTail)};
+    while(head != tail) {
+        parked.push_back(cqes[head & cqMask]);
+        ++head;
+    }
+    storeRelease(cqHead, head);
+}
+
+void UringIo::reap(Handler& handler)
+{
+    //handlers may submit and so park more, those run in a later round
+    for(;;) {
+        park();
+        if(parked.empty()) {
+            break;
+        }
+        reaping.swap(parked);
+        for(const io_uring_cqe& cqe : reaping) {
+            complete(handler, cqe);
+        }
+        reaping.clear();
+    }
+}
+
+void UringIo::complete(Handler& handler, const io_uring_cqe& cqe)
+{
+    if(0 == cqe.user_data) {
+        return;
+    }
+    Connection* const connection {reinterpret_cast<Connection*>(cqe.user_data & ~OP_MASK)};
+    const Op op {static_cast<Op>(cqe.user_data & OP_MASK)};
+    const bool more {0 != (cqe.flags & IORING_CQE_F_MORE)};
+
+    //a final completion gives up its hold on the connection only after the
+    // handler calls below, any of which may close it
+    switch(op) {
+    case Op::ACCEPT:
+        if(cqe.res >= 0 && !connection->closed) {
+            setNoDelay(cqe.res);
+            Connection* client {add(cqe.res)};
+            client->connected = true;
+            armReceive(*client);
+            handler.onAccepted(cqe.res);
+        }
+        if(!more && !connection->closed) {
+            armAccept(*connection);
+        }
+        break;
+    case Op::CONNECT:
+        if(connection->closed) {
+            break;
+        }
+        if(cqe.res < 0) {
+            shut(*connection);
+            handler.onConnected(connection->fd, false);
+            break;
+        }
+        connection->connected = true;
+        armReceive(*connection);
+        if(!connection->out.isEmpty()) {
+            markDirty(*connection);
+        }
+        handler.onConnected(connection->fd, true);
+        break;
+    case Op::RECEIVE:
+        if(cqe.flags & IORING_CQE_F_BUFFER) {
+            const uint16_t id {static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT)};
+            if(cqe.res > 0 && !connection->closed) {
+                //the decoder reads the kernel's buffer in place
+                handler.onReceived(connection->fd, buffers + static_cast<size_t>(id) * BUFFER_SIZE,
+                                   static_cast<size_t>(cqe.res));
+            }
+            recycle(id);
+        }
+        if(connection->closed) {
+            break;
+        }
+        if(0 == cqe.res || (cqe.res < 0 && -ENOBUFS != cqe.res)) {
+            fail(handler, *connection);
+        }
+        else if(!more) {
+            //ran out of buffers or the kernel ended it, carry on
+            armReceive(*connection);
+        }
+        break;
+    case Op::SEND:
+        connection->sending = false;
+        if(connection->closed) {
+            break;
+        }
+        if(cqe.res < 0) {
+            fail(handler, *connection);
+            break;
+        }
+        connection->out.consume(static_cast<size_t>(cqe.res));
+        if(!connection->out.isEmpty()) {
+            markDirty(*connection);
+        }
+        break;
+    }
+    if(!more) {
+        --connection->inflight;
+    }
+    release(connection);
+}
+
+UringIo::Connection* UringIo::add(const int fd)
+{
+    Connection* connection {new Connection{fd, false, false, false, false, false, 0, OutputQueue{}, {}, {}}};
+    live.insert(connection);
+    if(static_cast<size_t>(fd) >= byFd.size()) {
+        byFd.resize(static_cast<size_t>(fd) + 1, nullptr);
+    }
+    byFd[static_cast<size_t>(fd)] = connection;
+    return connection;
+}
+
+UringIo::Connection* UringIo::find(const int fd) const
+{
+    if(fd < 0 || static_cast<size_t>(fd) >= byFd.size()) {
+        return nullptr;
+    }
+    return byFd[static_cast<size_t>(fd)];
+}
+
+void UringIo::prepare(io_uring_sqe* sqe, const uint8_t opcode, Connection& connection, const Op op)
+{
+    sqe->opcode = opcode;
+    sqe->fd = connection.fd;
+    sqe->user_data = reinterpret_cast<uint64_t>(&connection) | static_cast<uint64_t>(op);
+    ++connection.inflight;
+}
+
+void UringIo::armAccept(Connection& connection)
+{
+    io_uring_sqe* sqe {nextSqe()};
+    prepare(sqe, IORING_OP_ACCEPT, connection, Op::ACCEPT);
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+}
+
+void UringIo::armReceive(Connection& connection)
+{
+    io_uring_sqe* sqe {nextSqe()};
+    prepare(sqe, IORING_OP_RECV, connection, Op::RECEIVE);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+}
+
+void UringIo::markDirty(Connection& connection)
+{
+    if(!connection.dirty && !connection.sending) {
+        connection.dirty = true;
+        dirty.push_back(&connection);
+    }
+}
+
+void UringIo::flushDirty()
+{
+    for(Connection* connection : dirty) {
+        connection->dirty = false;
+        if(!connection->closed && !connection->sending && !connection->out.isEmpty()) {
+            const size_t count {connection->out.gather(connection->iov, MAX_IOV)};
+            io_uring_sqe* sqe {nextSqe()};
+            prepare(sqe, IORING_OP_WRITEV, *connection, Op::SEND);
+            sqe->addr = reinterpret_cast<uint64_t>(connection->iov);
+            sqe->len = static_cast<uint32_t>(count);
+            connection->sending = true;
+        }
+        release(connection);
+    }
+    dirty.clear();
+}
+
+void UringIo::recycle(const uint16_t id)
+{
+    //goes with the next submission, no syscall of its own
+    io_uring_sqe* sqe {nextSqe()};
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(buffers + static_cast<size_t>(id) * BUFFER_SIZE);
+    sqe->len = BUFFER_SIZE;
+    sqe->off = id;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+void UringIo::shut(Connection& connection)
+{
+    if(connection.closed) {
+        return;
+    }
+    connection.closed = true;
+    byFd[static_cast<size_t>(connection.fd)] = nullptr;
+
+    //cancel what is in flight, then close, without a syscall of its own
+    io_uring_sqe* cancel {nextSqe()};
+    cancel->opcode = IORING_OP_ASYNC_CANCEL;
+    cancel->fd = connection.fd;
+    cancel->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    cancel->flags = IOSQE_IO_HARDLINK;
+    io_uring_sqe* close {nextSqe()};
+    close->opcode = IORING_OP_CLOSE;
+    close->fd = connection.fd;
+    close->flags = IOSQE_CQE_SKIP_SUCCESS;
+}
+
+void UringIo::fail(Handler& handler, Connection& connection)
+{
+    shut(connection);
+    handler.onClosed(connection.fd);
+}
+
+void UringIo::release(Connection* connection)
+{
+    if(connection->closed && 0 == connection->inflight && !connection->dirty) {
+        live.erase(connection);
+        delete connection;
+    }
+}
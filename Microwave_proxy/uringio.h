@@ -0,0 +1,117 @@
+#ifndef URINGIO_H
+#define URINGIO_H
+
+#include "proxyio.h"
+
+#include <unordered_set>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// Completion based backend on io_uring, through the raw syscalls.
+//
+// Each socket has one multishot receive armed that picks its buffers from
+// a pool provided to the kernel, so data lands in a buffer the decoder
+// reads in place and the buffer goes back to the pool with the next
+// submission. Accepts are multishot too. Writes are queued as submissions
+// and everything gathered in one pass of the loop goes to the kernel with
+// the wait for the next completions, in a single io_uring_enter. A
+// broadcast to N apps costs one syscall instead of N writev calls. Needs
+// Linux 6.1 or later.
+class UringIo : public ProxyIo
+{
+public:
+    UringIo();
+    ~UringIo();
+
+    //false when the kernel lacks something this backend needs
+    bool isValid() const;
+
+    const char* name() const override;
+
+    bool listen(const sockaddr_in& addr) override;
+    int connect(const sockaddr_in& addr) override;
+    void send(const int fd, SharedBuffer buffer) override;
+    size_t queued(const int fd) const override;
+    void close(const int fd) override;
+
+    void run(Handler& handler, const volatile sig_atomic_t& running) override;
+
+private:
+    enum class Op : uint64_t {
+        ACCEPT = 1,
+        CONNECT,
+        RECEIVE,
+        SEND
+    };
+
+    // Lives until the last of its operations has completed, so late
+    // completions never touch freed memory and queued buffers stay valid
+    // while the kernel may still read them
+    struct alignas(8) Connection
+    {
+        int fd;
+        bool listening;
+        bool connected;
+        bool closed;
+        bool sending;
+        bool dirty;         // output waiting for the next submission
+        int inflight;
+        OutputQueue out;
+        iovec iov[MAX_IOV];
+        sockaddr_in peer;
+    };
+
+    int ringFd;
+    bool valid;
+
+    //submission queue
+    void* sqRing;
+    size_t sqRingSize;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned sqLocalTail;
+    io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    //completion queue, shares the mapping of the submission ring
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+
+    //provided receive buffers
+    char* buffers;
+
+    //completions taken off the ring but not handled yet, in order
+    std::vector<io_uring_cqe> parked;
+    std::vector<io_uring_cqe> reaping;
+
+    std::vector<Connection*> byFd;
+    std::unordered_set<Connection*> live;
+    std::vector<Connection*> dirty;
+
+    bool setup();
+    io_uring_sqe* nextSqe();
+    //submits and optionally waits, the syscall's result or -errno
+    int enter(const bool wait, const int timeoutMs);
+    void park();
+    void reap(Handler& handler);
+    void complete(Handler& handler, const io_uring_cqe& cqe);
+
+    Connection* add(const int fd);
+    Connection* find(const int fd) const;
+    void prepare(io_uring_sqe* sqe, const uint8_t opcode, Connection& connection, const Op op);
+    void armAccept(Connection& connection);
+    void armReceive(Connection& connection);
+    void markDirty(Connection& connection);
+    void flushDirty();
+    void recycle(const uint16_t id);
+    void shut(Connection& connection);
+    void fail(Handler& handler, Connection& connection);
+    void release(Connection* connection);
+};
+
+#endif // URINGIO_H
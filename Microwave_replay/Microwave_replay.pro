@@ -0,0 +1,19 @@
+# Headless replay of session captures, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveMessageDecoder.h \
+    ../MicrowaveFramingV2.h \
+    ../MicrowaveTimeDelta.h \
+    ../MicrowaveDisplay.h \
+    ../MicrowaveCapture.h \
+    ../MicrowaveProtocolCore.h
+
+INCLUDEPATH += \
+    ../
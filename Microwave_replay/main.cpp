@@ -0,0 +1,212 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveCapture.h"
+#include "MicrowaveDisplay.h"
+#include "MicrowaveProtocolCore.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Replays session captures through the protocol core and checks the
+// resulting display frames against golden files.
+//
+//   Microwave_replay [--update] capture...
+//   Microwave_replay --at <ms> [--at <ms>...] capture...
+//
+// The frames of capture X are compared with X.frames, one line per display
+// change ("<ms> [<glyphs>]"), with timeouts run up to the capture's last
+// record. --update rewrites the golden files instead. --at prints the frame
+// shown <ms> into each capture, starting from the nearest snapshot; the
+// snapshot index is built once per capture however many times are given.
+// Exits non-zero on any mismatch or unreadable capture.
+//
+// samples/ holds captures with their golden frames for each kind of link:
+// the original protocol, timer sync with binary time, and local blink
+// across a link drop.
+
+namespace {
+
+bool readFile(const std::string& path, std::vector<char>& data)
+{
+    std::ifstream in(path, std::ios::binary);
+    if(!in) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool writeFile(const std::string& path, const std::string& data)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(out);
+}
+
+void appendFrame(const uint64_t ms, const MicrowaveMsgFormat::DisplayFrame& frame, std::string& frames)
+{
+    char line[48];
+    const int size {snprintf(line, sizeof(line), "%" PRIu64 " [%.*s]\n",
+                             ms, static_cast<int>(MicrowaveMsgFormat::GlyphCount), frame.glyphs)};
+    frames.append(line, static_cast<size_t>(size));
+}
+
+bool replay(const std::vector<char>& data, std::string& frames)
+{
+    using namespace MicrowaveMsgFormat;
+
+    CaptureReader reader(data.data(), data.size());
+    if(!reader.isValid()) {
+        return false;
+    }
+
+    ProtocolCore core;
+    appendFrame(0, core.frame(), frames);
+
+    CaptureRecord record;
+    Message msg;
+    uint64_t due {};
+    uint64_t endMs {0};
+    while(reader.next(record)) {
+        endMs = record.timeUs / 1000;
+        const bool linkReset {CaptureKind::LINK_RESET == record.kind};
+        if(!linkReset && (CaptureKind::RX != record.kind || !DecodeCaptureMessage(record, msg))) {
+            continue;
+        }
+        const uint64_t nowMs {record.timeUs / 1000};
+        //timeouts show up at the time they fired, not at the next message
+        while(core.nextTimeout(due) && due <= nowMs) {
+            if(core.advance(due)) {
+                appendFrame(due, core.frame(), frames);
+            }
+        }
+        if(linkReset ? core.linkReset() : core.process(msg, nowMs)) {
+            appendFrame(nowMs, core.frame(), frames);
+        }
+    }
+    //up to the last record only, a local blink would run forever
+    while(core.nextTimeout(due) && due <= endMs) {
+        if(core.advance(due)) {
+            appendFrame(due, core.frame(), frames);
+        }
+    }
+    return true;
+}
+
+bool framesAt(const std::vector<char>& data, const std::vector<uint64_t>& times, std::string& frames)
+{
+    using namespace MicrowaveMsgFormat;
+
+    CaptureReader reader(data.data(), data.size());
+    if(!reader.isValid()) {
+        return false;
+    }
+    const CaptureIndex index(reader);
+    ProtocolCore core;
+    for(const uint64_t ms : times) {
+        if(!SeekCapture(reader, index, ms * 1000, core)) {
+            return false;
+        }
+        appendFrame(ms, core.frame(), frames);
+    }
+    return true;
+}
+
+//1-based number of the first line that differs
+size_t firstDifference(const std::string& a, const std::string& b)
+{
+    size_t line {1};
+    for(size_t i {0}; i < a.size() && i < b.size(); ++i) {
+        if(a[i] != b[i]) {
+            return line;
+        }
+        if('\n' == a[i]) {
+            ++line;
+        }
+    }
+    return line;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    bool update {false};
+    std::vector<uint64_t> seekMs;
+    std::vector<std::string> captures;
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--update")) {
+            update = true;
+        }
+        else if(0 == strcmp(argv[i], "--at") && i + 1 < argc) {
+            seekMs.push_back(strtoull(argv[++i], nullptr, 10));
+        }
+        else {
+            captures.emplace_back(argv[i]);
+        }
+    }
+    if(captures.empty()) {
+        fprintf(stderr, "usage: %s [--update | --at <ms>...] capture...\n", argv[0]);
+        return 2;
+    }
+
+    const auto start {std::chrono::steady_clock::now()};
+    size_t failed {0};
+    std::vector<char> data;
+    std::vector<char> golden;
+    std::string frames;
+    for(const std::string& path : captures) {
+        frames.clear();
+        if(!seekMs.empty()) {
+            if(!readFile(path, data) || !framesAt(data, seekMs, frames)) {
+                fprintf(stderr, "%s: not a readable capture\n", path.c_str());
+                ++failed;
+            }
+            else {
+                //one line per time, each ends in a newline
+                for(size_t begin {0}; begin < frames.size();) {
+                    const size_t end {frames.find('\n', begin)};
+                    printf("%s: %.*s\n", path.c_str(), static_cast<int>(end - begin), frames.data() + begin);
+                    begin = end + 1;
+                }
+            }
+            continue;
+        }
+        if(!readFile(path, data) || !replay(data, frames)) {
+            fprintf(stderr, "%s: not a readable capture\n", path.c_str());
+            ++failed;
+            continue;
+        }
+
+        const std::string goldenPath {path + ".frames"};
+        if(update) {
+            if(!writeFile(goldenPath, frames)) {
+                fprintf(stderr, "%s: unable to write\n", goldenPath.c_str());
+                ++failed;
+            }
+            continue;
+        }
+        if(!readFile(goldenPath, golden)) {
+            fprintf(stderr, "%s: no golden frames, run with --update\n", path.c_str());
+            ++failed;
+            continue;
+        }
+        const std::string expected(golden.begin(), golden.end());
+        if(expected != frames) {
+            fprintf(stderr, "%s: frames differ from %s at line %zu\n",
+                    path.c_str(), goldenPath.c_str(), firstDifference(expected, frames));
+            ++failed;
+        }
+    }
+
+    const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    printf("%zu sessions, %zu failed, %.0f sessions/s\n",
+           captures.size(), failed, seconds > 0 ? static_cast<double>(captures.size()) / seconds : 0.0);
+    return 0 == failed ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+# Device side of the shared-memory transport and its soak test, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a thread
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveShmRing.h
+
+INCLUDEPATH += \
+    ../
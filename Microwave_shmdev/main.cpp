@@ -0,0 +1,453 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveShmRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#include <poll.h>
+#include <sched.h>
+#include <sys/un.h>
+
+// Device side of the shared-memory transport, and a soak test for it.
+//
+//   Microwave_shmdev SOCKET
+//   Microwave_shmdev --soak SECONDS [--socket SOCKET]
+//
+// Serving, it listens on the unix socket SOCKET, the path the app takes
+// from MICROWAVE_SHM_SOCKET, and hands every app that connects a fresh
+// region the way a co-located device would. It then plays a plain device
+// on the original protocol: blink every 500 ms, the wall clock once a
+// minute, a State and the clock in reply to STATE_REQUEST and no
+// capabilities. Keys are not acted on, it is there to drive ShmTransport.
+//
+// The soak runs the same device in one thread and an app in another that
+// attaches over the socket exactly as ShmTransport does. The device floods
+// the app in bursts of random length, pausing now and then so the app goes
+// idle and the eventfd wakeup path is taken, while the app sends a
+// STATE_REQUEST every few thousand records and times the reply. Every
+// record carries its sequence number; reported are the rate, the wakeups,
+// the stalls on a full ring and the request round trip. Exits non-zero on
+// a record lost, repeated or out of order, on a missing reply and when the
+// app does not see the device hang up at the end.
+
+namespace {
+
+using namespace MicrowaveMsgFormat;
+
+const int BLINK_HALF_PERIOD_MS {500};
+const char* const DEFAULT_SOAK_SOCKET {"/tmp/microwave-shmdev-soak"};
+
+//soak
+const uint32_t MAX_BURST {8192};
+const uint32_t PAUSE_ONE_IN {16};    // bursts followed by a pause
+const int PAUSE_US {200};
+const uint32_t REQUEST_EVERY {4096}; // records between state requests
+const int WAIT_MS {100};
+
+Message makeMessage(const Destination dst, const uint32_t value)
+{
+    Message msg {};
+    msg.dst = dst;
+    msg.state = static_cast<State>(value);
+    return msg;
+}
+
+void putSequence(Message& msg, const uint32_t sequence)
+{
+    memcpy(msg.data, &sequence, sizeof(sequence));
+}
+
+uint32_t sequenceOf(const Message& msg)
+{
+    uint32_t sequence;
+    memcpy(&sequence, msg.data, sizeof(sequence));
+    return sequence;
+}
+
+uint64_t nowUs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+int listenOn(const char* path)
+{
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    const int sock {socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+    if(-1 == sock ||
+       -1 == bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+       -1 == listen(sock, 1)) {
+        perror(path);
+        if(-1 != sock) {
+            close(sock);
+        }
+        return -1;
+    }
+    return sock;
+}
+
+void closeFds(int (&fds)[SHM_FD_COUNT])
+{
+    for(int& fd : fds) {
+        if(-1 != fd) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+// One mapped region and its eventfds, either side of it
+struct ShmEnd
+{
+    int fds[SHM_FD_COUNT] {-1, -1, -1};
+    ShmRegion* region {nullptr};
+
+    bool map()
+    {
+        void* mapped {mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fds[SHM_FD_MEMORY], 0)};
+        if(MAP_FAILED == mapped) {
+            return false;
+        }
+        region = static_cast<ShmRegion*>(mapped);
+        return ShmMagic == region->magic && ShmVersion == region->version;
+    }
+
+    void release()
+    {
+        if(region) {
+            munmap(region, sizeof(ShmRegion));
+            region = nullptr;
+        }
+        closeFds(fds);
+    }
+};
+
+// Device side: a fresh region for the app on conn
+bool serveRegion(const int conn, ShmEnd& device)
+{
+    if(!CreateShmRegion(device.fds) || !device.map() || !SendShmFds(conn, device.fds)) {
+        device.release();
+        return false;
+    }
+    return true;
+}
+
+// App side, as ShmTransport::open()
+bool attachRegion(const char* path, int& sock, ShmEnd& app)
+{
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if(-1 == sock ||
+       -1 == connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) ||
+       !ReceiveShmFds(sock, app.fds) ||
+       !app.map()) {
+        app.release();
+        return false;
+    }
+    return true;
+}
+
+// Producer side of a ring, false when it is full
+bool put(ShmRing& ring, const int kickFd, const Message& msg)
+{
+    Message* slot {ring.claim()};
+    if(!slot) {
+        return false;
+    }
+    *slot = msg;
+    if(ring.publish()) {
+        KickEventFd(kickFd);
+    }
+    return true;
+}
+
+Message clockUpdate()
+{
+    const time_t now {::time(nullptr)};
+    tm local {};
+    localtime_r(&now, &local);
+    Message msg {makeMessage(Destination::APP, static_cast<uint32_t>(Update::CLOCK))};
+    msg.data[0] = static_cast<char>('0' + local.tm_hour / 10);
+    msg.data[1] = static_cast<char>('0' + local.tm_hour % 10);
+    msg.data[2] = static_cast<char>('0' + local.tm_min / 10);
+    msg.data[3] = static_cast<char>('0' + local.tm_min % 10);
+    return msg;
+}
+
+// Serves one app until it hangs up
+void runDevice(const int conn, ShmEnd& device)
+{
+    ShmRing& toApp {device.region->toApp};
+    ShmRing& toDev {device.region->toDev};
+    const int kickFd {device.fds[SHM_FD_TO_APP]};
+    bool blinkOn {false};
+    char lastMinute {};
+    uint64_t nextBlinkUs {nowUs()};
+    for(;;) {
+        const uint64_t now {nowUs()};
+        if(now >= nextBlinkUs) {
+            blinkOn = !blinkOn;
+            put(toApp, kickFd, makeMessage(Destination::APP, static_cast<uint32_t>(
+                blinkOn ? Signal::BLINK_ON : Signal::BLINK_OFF)));
+            nextBlinkUs = now + BLINK_HALF_PERIOD_MS * 1000u;
+            const Message clock {clockUpdate()};
+            if(clock.data[3] != lastMinute) {
+                lastMinute = clock.data[3];
+                put(toApp, kickFd, clock);
+            }
+        }
+
+        while(const Message* request {toDev.front()}) {
+            const Signal signal {request->signal};
+            toDev.pop();
+            if(Signal::STATE_REQUEST == signal) {
+                put(toApp, kickFd, makeMessage(Destination::APP, static_cast<uint32_t>(State::DISPLAY_CLOCK)));
+                put(toApp, kickFd, clockUpdate());
+            }
+            else if(Signal::CAPABILITIES == signal) {
+                Message reply {makeMessage(Destination::APP, static_cast<uint32_t>(Signal::CAPABILITIES))};
+                reply.data[1] = static_cast<char>(1); //original protocol, nothing extra
+                put(toApp, kickFd, reply);
+            }
+        }
+
+        pollfd fds[2] {{conn, POLLIN, 0}, {device.fds[SHM_FD_TO_DEV], POLLIN, 0}};
+        const int timeoutMs {static_cast<int>((nextBlinkUs - std::min(nextBlinkUs, nowUs())) / 1000) + 1};
+        if(poll(fds, 2, timeoutMs) < 0) {
+            return;
+        }
+        if(fds[0].revents) {
+            return; //the hand-off socket carries nothing after the fds
+        }
+        if(fds[1].revents) {
+            DrainEventFd(device.fds[SHM_FD_TO_DEV]);
+        }
+    }
+}
+
+int serve(const char* path)
+{
+    const int listener {listenOn(path)};
+    if(-1 == listener) {
+        return 1;
+    }
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    printf("serving %s\n", path);
+    for(;;) {
+        const int conn {accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)};
+        if(-1 == conn) {
+            perror("accept");
+            continue;
+        }
+        ShmEnd device;
+        if(serveRegion(conn, device)) {
+            printf("app attached\n");
+            runDevice(conn, device);
+            printf("app detached\n");
+        }
+        device.release();
+        close(conn);
+    }
+}
+
+struct SoakStats
+{
+    uint64_t records;
+    uint64_t outOfOrder;
+    uint64_t wakeups;
+    uint64_t fullStalls;
+    uint64_t requests;
+    uint64_t replies;
+    uint64_t roundTripUs;
+    uint64_t maxRoundTripUs;
+    bool sawHangup;
+};
+
+// Device half of the soak: bursts of sequenced updates, replies to requests
+void soakDevice(const int conn, ShmEnd& device, const uint64_t endUs, SoakStats& stats)
+{
+    ShmRing& toApp {device.region->toApp};
+    ShmRing& toDev {device.region->toDev};
+    const int kickFd {device.fds[SHM_FD_TO_APP]};
+    uint64_t random {0x9E3779B97F4A7C15ull};
+    uint32_t sequence {0};
+    while(nowUs() < endUs) {
+        random = random * 6364136223846793005u + 1442695040888963407u;
+        const uint32_t burst {1 + static_cast<uint32_t>(random >> 33) % MAX_BURST};
+        for(uint32_t i {0}; i < burst;) {
+            while(const Message* request {toDev.front()}) {
+                Message reply {makeMessage(Destination::APP, static_cast<uint32_t>(State::DISPLAY_CLOCK))};
+                memcpy(reply.data, request->data, sizeof(reply.data));
+                toDev.pop();
+                while(!put(toApp, kickFd, reply)) {
+                    sched_yield();
+                }
+            }
+            Message msg {makeMessage(Destination::APP, static_cast<uint32_t>(Update::CLOCK) + sequence % 3)};
+            putSequence(msg, sequence);
+            if(put(toApp, kickFd, msg)) {
+                ++sequence;
+                ++i;
+            }
+            else {
+                ++stats.fullStalls;
+                sched_yield();
+            }
+        }
+        if(0 == (random >> 40) % PAUSE_ONE_IN) {
+            std::this_thread::sleep_for(std::chrono::microseconds(PAUSE_US));
+        }
+    }
+    //let the app see the last records before hanging up
+    while(0 != toApp.size()) {
+        sched_yield();
+    }
+    shutdown(conn, SHUT_RDWR);
+}
+
+// App half of the soak, consuming as Microwave::onReadyRead() does
+void soakApp(const char* path, SoakStats& stats)
+{
+    int sock {-1};
+    ShmEnd app;
+    if(!attachRegion(path, sock, app)) {
+        fprintf(stderr, "app: unable to attach to %s\n", path);
+        if(-1 != sock) {
+            close(sock);
+        }
+        return;
+    }
+    ShmRing& toApp {app.region->toApp};
+    ShmRing& toDev {app.region->toDev};
+    uint32_t expected {0};
+    uint32_t pendingRequest {0};
+    uint64_t requestSentUs {0};
+    uint32_t sinceRequest {0};
+    for(;;) {
+        while(const Message* record {toApp.front()}) {
+            const Message msg {*record};
+            toApp.pop();
+            if(Type::STATE == static_cast<Type>(static_cast<uint32_t>(msg.state) >> 24)) {
+                if(0 != pendingRequest && sequenceOf(msg) == pendingRequest) {
+                    const uint64_t roundTrip {nowUs() - requestSentUs};
+                    stats.roundTripUs += roundTrip;
+                    stats.maxRoundTripUs = std::max(stats.maxRoundTripUs, roundTrip);
+                    ++stats.replies;
+                    pendingRequest = 0;
+                }
+                continue;
+            }
+            if(sequenceOf(msg) != expected) {
+                ++stats.outOfOrder;
+            }
+            expected = sequenceOf(msg) + 1;
+            ++stats.records;
+            if(++sinceRequest >= REQUEST_EVERY && 0 == pendingRequest) {
+                Message request {makeMessage(Destination::DEV, static_cast<uint32_t>(Signal::STATE_REQUEST))};
+                pendingRequest = static_cast<uint32_t>(++stats.requests);
+                putSequence(request, pendingRequest);
+                requestSentUs = nowUs();
+                put(toDev, app.fds[SHM_FD_TO_DEV], request);
+                sinceRequest = 0;
+            }
+        }
+
+        pollfd fds[2] {{app.fds[SHM_FD_TO_APP], POLLIN, 0}, {sock, POLLIN, 0}};
+        if(poll(fds, 2, WAIT_MS) < 0) {
+            break;
+        }
+        if(fds[0].revents) {
+            DrainEventFd(app.fds[SHM_FD_TO_APP]);
+            ++stats.wakeups;
+        }
+        if(fds[1].revents && !toApp.front()) {
+            stats.sawHangup = true;
+            break;
+        }
+    }
+    app.release();
+    close(sock);
+}
+
+int soak(const double seconds, const char* path)
+{
+    const int listener {listenOn(path)};
+    if(-1 == listener) {
+        return 1;
+    }
+    SoakStats stats {};
+    std::thread app(soakApp, path, std::ref(stats));
+    const int conn {accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)};
+    ShmEnd device;
+    if(-1 == conn || !serveRegion(conn, device)) {
+        fprintf(stderr, "device: unable to serve a region\n");
+        if(-1 != conn) {
+            close(conn);
+        }
+        app.join();
+        return 1;
+    }
+    const uint64_t start {nowUs()};
+    soakDevice(conn, device, start + static_cast<uint64_t>(seconds * 1e6), stats);
+    app.join();
+    const double elapsed {static_cast<double>(nowUs() - start) / 1e6};
+    device.release();
+    close(conn);
+    close(listener);
+    unlink(path);
+
+    const uint64_t missing {stats.requests - stats.replies};
+    printf("%" PRIu64 " records in %.1f s, %.1f Mmsg/s, %" PRIu64 " out of order\n",
+           stats.records, elapsed, static_cast<double>(stats.records) / elapsed / 1e6, stats.outOfOrder);
+    printf("%" PRIu64 " app wakeups, %" PRIu64 " stalls on a full ring\n", stats.wakeups, stats.fullStalls);
+    printf("%" PRIu64 " state requests, %" PRIu64 " unanswered, round trip %.1f us mean, %" PRIu64 " us max\n",
+           stats.requests, missing,
+           stats.replies ? static_cast<double>(stats.roundTripUs) / static_cast<double>(stats.replies) : 0.0,
+           stats.maxRoundTripUs);
+    printf("hangup %s\n", stats.sawHangup ? "seen" : "not seen");
+    //the last request may have crossed the hangup
+    return 0 == stats.outOfOrder && missing <= 1 && stats.sawHangup && 0 != stats.records ? 0 : 1;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    double soakSeconds {0};
+    const char* path {nullptr};
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--soak") && i + 1 < argc) {
+            soakSeconds = strtod(argv[++i], nullptr);
+        }
+        else if(0 == strcmp(argv[i], "--socket") && i + 1 < argc) {
+            path = argv[++i];
+        }
+        else if('-' != argv[i][0] && !path) {
+            path = argv[i];
+        }
+        else {
+            path = nullptr;
+            soakSeconds = -1;
+            break;
+        }
+    }
+    if(soakSeconds > 0) {
+        return soak(soakSeconds, path ? path : DEFAULT_SOAK_SOCKET);
+    }
+    if(0 != soakSeconds || !path) {
+        fprintf(stderr, "usage: %s SOCKET | --soak SECONDS [--socket SOCKET]\n", argv[0]);
+        return 2;
+    }
+    return serve(path);
+}
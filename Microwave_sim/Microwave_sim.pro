@@ -0,0 +1,22 @@
+# Discrete-event simulation of devices and apps on a virtual clock, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp \
+    ../Microwave_app/timingwheel.cpp
+
+HEADERS += \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveMessageDecoder.h \
+    ../MicrowaveFramingV2.h \
+    ../MicrowaveTimeDelta.h \
+    ../MicrowaveDisplay.h \
+    ../MicrowaveCapture.h \
+    ../MicrowaveProtocolCore.h \
+    ../Microwave_app/timingwheel.h
+
+INCLUDEPATH += \
+    ../ \
+    ../Microwave_app
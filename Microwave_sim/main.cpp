@@ -0,0 +1,1199 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveFramingV2.h"
+#include "MicrowaveMessageDecoder.h"
+#include "MicrowaveProtocolCore.h"
+#include "MicrowaveTimeDelta.h"
+#include "timingwheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Discrete-event simulation of devices and apps on a virtual clock.
+//
+//   Microwave_sim [--devices N] [--hours H] [--seed S]
+//
+// Each simulated pair is a device model, an app and a link with latency
+// between them. The app side is the protocol core behind the same wire
+// decoder as the real app, plus its 500 ms state request poll, its power
+// level overlay timeout and a user pressing keys. The device side runs the
+// blink cadence, the minute clock, countdowns and the key handling the app's
+// state machine expects. Links drop now and then, which the app recovers
+// from through state requests.
+//
+// Like the app, each connection starts with a CAPABILITIES offer. Every
+// device supports its own seeded mix of timer sync, local blink, binary
+// time and v2 framing and answers with the part of the offer it has; one
+// that has none is older firmware and never answers. From the reply on the
+// device stops sending blink frames, syncs the countdown every few seconds
+// only, sends its clock and timer as seconds and deltas, and both
+// directions switch to the compact framing, each as negotiated.
+//
+// All timers of all pairs sit on one TimingWheel, the one behind the app's
+// TimerService. Nothing waits for the wall clock: the wheel is advanced as
+// fast as it can fire what is due, so hours of traffic run in seconds.
+// Randomness comes from a seeded generator, so a seed always produces the
+// same run; the digest printed at the end covers every delivered message
+// and its delivery time.
+//
+// After each exchange, once nothing is in flight, the app must agree with
+// the device on the state, on what the display shows and on what was
+// negotiated. Between timer syncs the app's countdown second may fall on
+// either side of the device's by the phase and latency of the last sync.
+// Exits non-zero on any disagreement and on any device message the app has
+// no transition for.
+
+namespace {
+
+using namespace MicrowaveMsgFormat;
+
+//same granularity as the app's TimerService
+const uint32_t SIM_TICK_MS {10};
+
+//app
+const uint64_t STATE_REQUEST_INTERVAL_MS {500};
+
+//device
+const uint64_t BLINK_HALF_PERIOD_MS {500};
+const uint64_t CLOCK_MINUTE_MS {60000};
+const uint64_t COUNTDOWN_TICK_MS {1000};
+const uint32_t QUICK_START_SECONDS {30};
+const uint64_t SYNC_INTERVAL_MIN_S {2};
+
+//what a device may support, each with even odds
+const uint8_t DEVICE_CAPABILITIES[] {CAP_TIMER_SYNC, CAP_LOCAL_BLINK, CAP_BINARY_TIME, CAP_FRAMING_V2};
+const char* const CAPABILITY_NAMES[] {"timer sync", "local blink", "binary time", "v2 framing"};
+const size_t CAPABILITY_COUNT {sizeof(DEVICE_CAPABILITIES) / sizeof(DEVICE_CAPABILITIES[0])};
+
+//how far the app's local countdown second may drift from the device's on
+// top of the last sync's phase: latency jitter plus its tick estimate
+const uint64_t SYNC_TOLERANCE_MS {200};
+
+//link
+const uint64_t LINK_LATENCY_MIN_MS {2};
+const uint64_t LINK_LATENCY_MAX_MS {25};
+const uint64_t LINK_UP_MIN_MS {10 * 60000};
+const uint64_t LINK_UP_MAX_MS {90 * 60000};
+const uint64_t LINK_DOWN_MIN_MS {500};
+const uint64_t LINK_DOWN_MAX_MS {15000};
+
+//user
+const uint64_t KEY_GAP_MIN_MS {150};
+const uint64_t KEY_GAP_MAX_MS {900};
+
+const size_t MAX_REPORTED {10};
+
+// splitmix64, the same sequence on every platform
+class Random
+{
+public:
+    explicit Random(const uint64_t seed)
+        : state{seed}
+    {
+    }
+
+    uint64_t next()
+    {
+        uint64_t z {state += 0x9E3779B97F4A7C15ull};
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    //inclusive
+    uint64_t range(const uint64_t low, const uint64_t high)
+    {
+        return low + next() % (high - low + 1);
+    }
+
+    bool chance(const uint32_t percent)
+    {
+        return next() % 100 < percent;
+    }
+
+private:
+    uint64_t state;
+};
+
+struct Stats
+{
+    uint64_t toApp;             // messages delivered DEV->APP
+    uint64_t toDevice;          // messages delivered APP->DEV
+    uint64_t bytesToApp;        // their wire size
+    uint64_t bytesToDevice;
+    uint64_t keys;
+    uint64_t cooks;
+    uint64_t overlays;
+    uint64_t stateRequests;
+    uint64_t reconnects;
+    uint64_t checks;
+    uint64_t desyncs;
+    uint64_t mismatches;        // app and device disagree on what was negotiated
+    uint64_t devicesWith[CAPABILITY_COUNT];
+    uint64_t checksWith[CAPABILITY_COUNT];  // checks while it was in use
+    uint64_t olderFirmware;     // devices that never answer CAPABILITIES
+    uint64_t invalidTransitions;
+    uint64_t ignoredWhileInitial;   // before the State reply, as in the app
+    uint64_t ignoredOverlayRepeats; // POWER_LEVEL while the overlay shows
+};
+
+// Virtual clock and event scheduler shared by every simulated pair
+class Simulation
+{
+public:
+    Simulation()
+        : wheel{SIM_TICK_MS}
+        , hash{0xCBF29CE484222325ull}
+    {
+    }
+
+    uint64_t now() const
+    {
+        return wheel.now();
+    }
+
+    void start(TimingWheel::Timer& timer, const uint64_t ms, TimingWheel::Callback callback)
+    {
+        wheel.schedule(timer, ms, std::move(callback));
+    }
+
+    void startAt(TimingWheel::Timer& timer, const uint64_t whenMs, TimingWheel::Callback callback)
+    {
+        wheel.scheduleAt(timer, whenMs, std::move(callback));
+    }
+
+    void stop(TimingWheel::Timer& timer)
+    {
+        wheel.cancel(timer);
+    }
+
+    //fires everything due up to endMs without waiting in between
+    void run(const uint64_t endMs)
+    {
+        wheel.advance(endMs);
+    }
+
+    //FNV-1a over what was delivered where and when
+    void record(const uint32_t pair, const Message& msg)
+    {
+        const uint64_t ms {now()};
+        mix(&ms, sizeof(ms));
+        mix(&pair, sizeof(pair));
+        mix(&msg, sizeof(msg));
+    }
+
+    uint64_t digest() const
+    {
+        return hash;
+    }
+
+private:
+    TimingWheel wheel;
+    uint64_t hash;
+
+    void mix(const void* data, const size_t size)
+    {
+        const unsigned char* bytes {static_cast<const unsigned char*>(data)};
+        for(size_t i {0}; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+    }
+};
+
+Message makeMessage(const Destination dst, const uint32_t value)
+{
+    Message msg {};
+    msg.dst = dst;
+    msg.state = static_cast<State>(value);
+    return msg;
+}
+
+Message makeTimeUpdate(const Update update, const Time& time)
+{
+    Message msg {makeMessage(Destination::APP, static_cast<uint32_t>(update))};
+    msg.data[0] = static_cast<char>('0' + time.left_tens);
+    msg.data[1] = static_cast<char>('0' + time.left_ones);
+    msg.data[2] = static_cast<char>('0' + time.right_tens);
+    msg.data[3] = static_cast<char>('0' + time.right_ones);
+    return msg;
+}
+
+Time splitTime(const uint32_t left, const uint32_t right)
+{
+    Time time {};
+    time.left_tens = (left / 10) % 10;
+    time.left_ones = left % 10;
+    time.right_tens = (right / 10) % 10;
+    time.right_ones = right % 10;
+    return time;
+}
+
+uint32_t leftOf(const Time& time)
+{
+    return time.left_tens * 10 + time.left_ones;
+}
+
+uint32_t rightOf(const Time& time)
+{
+    return time.right_tens * 10 + time.right_ones;
+}
+
+// One direction of a connection: wire frames in order, each after a random
+// latency, through the real decoder. A new connection starts on v1 framing,
+// the sender switches to v2 right after the CAPABILITIES reply and the
+// receiver once it has decoded the reply, as the app's transports do.
+class Link
+{
+public:
+    typedef std::function<void(const Message&)> Receiver;
+
+    Link(Simulation& sim, Random& random, const Destination dst, uint64_t& bytes, Receiver receiver)
+        : sim(sim)
+        , random(random)
+        , dst{dst}
+        , bytes(bytes)
+        , receiver{std::move(receiver)}
+        , decoder{dst}
+        , up{false}
+        , sendV2{false}
+        , lastDueMs{0}
+    {
+    }
+
+    void send(Message msg)
+    {
+        if(!up) {
+            return;
+        }
+        msg.dst = dst;
+        InFlight entry {};
+        const uint64_t due {sim.now() + random.range(LINK_LATENCY_MIN_MS, LINK_LATENCY_MAX_MS)};
+        //a stream never reorders
+        entry.dueMs = due > lastDueMs ? due : lastDueMs;
+        lastDueMs = entry.dueMs;
+        if(sendV2) {
+            entry.size = EncodeV2(msg, entry.wire);
+        }
+        else {
+            const Message wire {ByteSwapMessage(msg)};
+            memcpy(entry.wire, &wire, WireMessageSize);
+            entry.size = WireMessageSize;
+        }
+        queue.push_back(entry);
+        if(!timer.isActive()) {
+            arm();
+        }
+    }
+
+    void setUp(const bool flag)
+    {
+        up = flag;
+        if(!up) {
+            queue.clear();
+            sim.stop(timer);
+            decoder.reset();
+            sendV2 = false;
+        }
+    }
+
+    void setSendV2(const bool enabled)
+    {
+        sendV2 = enabled;
+    }
+
+    void setReceiveV2(const bool enabled)
+    {
+        decoder.setFramingV2(enabled);
+    }
+
+    //nothing in flight, including frames decoded in the same delivery
+    bool isIdle() const
+    {
+        return queue.empty() && 0 == decoder.buffered();
+    }
+
+private:
+    struct InFlight
+    {
+        uint64_t dueMs;
+        size_t size;
+        char wire[WireMessageSize];
+    };
+
+    Simulation& sim;
+    Random& random;
+    Destination dst;
+    uint64_t& bytes;
+    Receiver receiver;
+    MessageDecoder decoder;
+    std::deque<InFlight> queue;
+    TimingWheel::Timer timer;
+    bool up;
+    bool sendV2;
+    uint64_t lastDueMs;
+
+    void arm()
+    {
+        sim.startAt(timer, queue.front().dueMs, [this]() {
+            deliver();
+        });
+    }
+
+    void deliver()
+    {
+        while(!queue.empty() && queue.front().dueMs <= sim.now()) {
+            decoder.append(queue.front().wire, queue.front().size);
+            bytes += queue.front().size;
+            queue.pop_front();
+        }
+        //the receiver may switch the framing between two messages
+        Message msg;
+        while(decoder.next(msg)) {
+            receiver(msg);
+        }
+        if(!queue.empty() && !timer.isActive()) {
+            arm();
+        }
+    }
+};
+
+// The device side of the protocol: owns the clock, the timers and the
+// current state, and tells the app about every change in the way it
+// negotiated with the app
+class SimDevice
+{
+public:
+    SimDevice(Simulation& sim, Random& random)
+        : sim(sim)
+        , current{State::DISPLAY_CLOCK}
+        , minutes{static_cast<uint32_t>(random.range(0, 24 * 60 - 1))}
+        , edit{}
+        , timerSeconds{0}
+        , level{10}
+        , blinkOn{true}
+        , supported{0}
+        , preferredSyncS{static_cast<uint32_t>(random.range(SYNC_INTERVAL_MIN_S, TimerSyncOfferS))}
+        , enabled{0}
+        , syncIntervalS{1}
+        , sinceSync{0}
+        , lastTickMs{0}
+        , syncPhaseMs{0}
+        , toApp{nullptr}
+        , fromApp{nullptr}
+    {
+        for(const uint8_t capability : DEVICE_CAPABILITIES) {
+            if(random.chance(50)) {
+                supported |= capability;
+            }
+        }
+        sim.start(blinkTimer, BLINK_HALF_PERIOD_MS, [this]() {
+            blink();
+        });
+        sim.start(clockTimer, CLOCK_MINUTE_MS, [this]() {
+            tickClock();
+        });
+    }
+
+    void attach(Link* out, Link* in)
+    {
+        toApp = out;
+        fromApp = in;
+    }
+
+    //the link went down, the next connection negotiates anew
+    void disconnect()
+    {
+        enabled = 0;
+        syncIntervalS = 1;
+    }
+
+    State state() const
+    {
+        return current;
+    }
+
+    //what this device could enable, 0 for older firmware
+    uint8_t capabilities() const
+    {
+        return supported;
+    }
+
+    //what it enabled for the current connection
+    uint8_t negotiated() const
+    {
+        return enabled;
+    }
+
+    uint32_t syncInterval() const
+    {
+        return syncIntervalS;
+    }
+
+    uint32_t powerLevel() const
+    {
+        return level;
+    }
+
+    // What the app should show for the current state
+    Time shownTime() const
+    {
+        switch(current) {
+        case State::DISPLAY_CLOCK:
+            return clockTime();
+        case State::DISPLAY_TIMER:
+            return splitTime(timerSeconds / 60, timerSeconds % 60);
+        default:
+            return edit;
+        }
+    }
+
+    // The countdown as the app may show it. Between timer syncs the app
+    // counts on its own from the last one, so it lags by that sync's phase
+    // and latency and drifts by its estimate of the device second.
+    bool agreesOnTimer(const Time& shown) const
+    {
+        const uint32_t seconds {TimeToSeconds(TimeStream::DISPLAY_TIMER, shown)};
+        if(seconds == timerSeconds || syncIntervalS < 2) {
+            return seconds == timerSeconds;
+        }
+        //seconds the device counted within the window behind and ahead
+        const uint64_t since {sim.now() - lastTickMs};
+        const uint64_t lag {syncPhaseMs + SYNC_TOLERANCE_MS};
+        const uint32_t behind {static_cast<uint32_t>(since < lag ? (lag - since - 1) / COUNTDOWN_TICK_MS + 1 : 0)};
+        const uint32_t ahead {since + SYNC_TOLERANCE_MS >= COUNTDOWN_TICK_MS ? 1u : 0u};
+        return seconds <= timerSeconds + behind && seconds + ahead >= timerSeconds;
+    }
+
+    void receive(const Message& msg)
+    {
+        const Signal signal {msg.signal};
+        if(signal >= Signal::DIGIT_0 && signal <= Signal::DIGIT_9) {
+            digit(static_cast<uint32_t>(signal) - static_cast<uint32_t>(Signal::DIGIT_0));
+            return;
+        }
+
+        switch(signal) {
+        case Signal::CAPABILITIES:
+            negotiate(msg);
+            break;
+        case Signal::STATE_REQUEST:
+            send(static_cast<uint32_t>(current));
+            sendShown();
+            break;
+        case Signal::CLOCK:
+            if(State::DISPLAY_CLOCK == current) {
+                send(signal);
+                edit = clockTime();
+                current = State::CLOCK_SELECT_HOUR_TENS;
+                send(Signal::MOD_LEFT_TENS);
+                sendShown();
+            }
+            else if(inClockSelect()) {
+                minutes = (leftOf(edit) % 24) * 60 + rightOf(edit) % 60;
+                send(signal);
+                showClock();
+            }
+            else if(State::DISPLAY_TIMER == current) {
+                send(signal);
+                showClock();
+            }
+            break;
+        case Signal::COOK_TIME:
+            if(State::DISPLAY_CLOCK == current || State::SET_POWER_LEVEL == current) {
+                if(State::DISPLAY_CLOCK == current) {
+                    edit.clear();
+                }
+                send(signal);
+                current = State::SET_COOK_TIMER;
+                sendShown();
+            }
+            break;
+        case Signal::POWER_LEVEL:
+            if(State::SET_COOK_TIMER == current) {
+                send(signal);
+                current = State::SET_POWER_LEVEL;
+                sendShown();
+            }
+            else if(State::DISPLAY_TIMER == current) {
+                //the app overlays the level for a while
+                send(signal);
+            }
+            break;
+        case Signal::KITCHEN_TIMER:
+            if(State::DISPLAY_CLOCK == current) {
+                send(signal);
+                edit.clear();
+                current = State::KITCHEN_SELECT_HOUR_TENS;
+                send(Signal::MOD_LEFT_TENS);
+                sendShown();
+            }
+            break;
+        case Signal::STOP:
+            if(State::DISPLAY_CLOCK != current) {
+                send(signal);
+                showClock();
+            }
+            break;
+        case Signal::START:
+            if(State::DISPLAY_CLOCK == current || inKitchenSelect() ||
+               State::SET_COOK_TIMER == current || State::SET_POWER_LEVEL == current) {
+                const uint32_t seconds {State::DISPLAY_CLOCK == current ? 0 : leftOf(edit) * 60 + rightOf(edit)};
+                timerSeconds = seconds ? seconds : QUICK_START_SECONDS;
+                lastTickMs = sim.now();
+                send(signal);
+                current = State::DISPLAY_TIMER;
+                sendShown();
+                sim.start(countdownTimer, COUNTDOWN_TICK_MS, [this]() {
+                    countdown();
+                });
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+private:
+    Simulation& sim;
+    State current;
+    uint32_t minutes;
+    Time edit;
+    uint32_t timerSeconds;
+    uint32_t level;
+    bool blinkOn;
+    uint8_t supported;
+    uint32_t preferredSyncS;
+    uint8_t enabled;
+    uint32_t syncIntervalS;
+    uint32_t sinceSync;         // countdown seconds since the last timer sent
+    uint64_t lastTickMs;
+    uint64_t syncPhaseMs;       // how long after a tick the last one went out
+    TimeDeltaEncoder encoder;
+    Link* toApp;
+    Link* fromApp;
+    TimingWheel::Timer blinkTimer;
+    TimingWheel::Timer clockTimer;
+    TimingWheel::Timer countdownTimer;
+
+    Time clockTime() const
+    {
+        return splitTime(minutes / 60, minutes % 60);
+    }
+
+    bool inClockSelect() const
+    {
+        return current >= State::CLOCK_SELECT_HOUR_TENS && current <= State::CLOCK_SELECT_MINUTE_ONES;
+    }
+
+    bool inKitchenSelect() const
+    {
+        return current >= State::KITCHEN_SELECT_HOUR_TENS && current <= State::KITCHEN_SELECT_MINUTE_ONES;
+    }
+
+    void send(const uint32_t value)
+    {
+        toApp->send(makeMessage(Destination::APP, value));
+    }
+
+    void send(const Signal signal)
+    {
+        send(static_cast<uint32_t>(signal));
+    }
+
+    void sendShown()
+    {
+        if(State::SET_POWER_LEVEL == current) {
+            Message msg {makeMessage(Destination::APP, static_cast<uint32_t>(Update::POWER_LEVEL))};
+            msg.data[0] = static_cast<char>('0' + (level / 10) % 10);
+            msg.data[1] = static_cast<char>('0' + level % 10);
+            toApp->send(msg);
+        }
+        else {
+            const bool clock {State::DISPLAY_CLOCK == current || inClockSelect()};
+            const TimeStream stream {clock ? TimeStream::CLOCK : TimeStream::DISPLAY_TIMER};
+            const Time shown {shownTime()};
+            const uint32_t seconds {TimeToSeconds(stream, shown)};
+            Time carried;
+            SecondsToTime(stream, seconds, carried);
+            //an edit the binary stream cannot carry, minutes past 59, goes
+            // out as digits
+            if((enabled & CAP_BINARY_TIME) && carried == shown) {
+                Message msg {};
+                encoder.encode(stream, seconds, msg);
+                toApp->send(msg);
+            }
+            else {
+                toApp->send(makeTimeUpdate(clock ? Update::CLOCK : Update::DISPLAY_TIMER, shown));
+            }
+            if(State::DISPLAY_TIMER == current) {
+                sinceSync = 0;
+                syncPhaseMs = sim.now() - lastTickMs;
+            }
+        }
+    }
+
+    // The app's offer. Answers with the part of it this device supports and
+    // speaks that from the reply on; older firmware never answers.
+    void negotiate(const Message& offer)
+    {
+        if(0 == supported) {
+            return;
+        }
+        const uint8_t version {supported & CAP_FRAMING_V2 ? ProtocolVersion : uint8_t{1}};
+        enabled = static_cast<uint8_t>(offer.data[0]) & supported;
+        if(version < 2 || static_cast<uint8_t>(offer.data[1]) < 2) {
+            enabled &= static_cast<uint8_t>(~CAP_FRAMING_V2);
+        }
+        syncIntervalS = 1;
+        if(enabled & CAP_TIMER_SYNC) {
+            //never longer than offered
+            const uint32_t offered {static_cast<uint8_t>(offer.data[2])};
+            syncIntervalS = std::max(1u, std::min(offered, preferredSyncS));
+        }
+        encoder.reset();
+
+        Message reply {makeMessage(Destination::APP, static_cast<uint32_t>(Signal::CAPABILITIES))};
+        reply.data[0] = static_cast<char>(enabled);
+        reply.data[1] = static_cast<char>(version);
+        reply.data[2] = static_cast<char>(syncIntervalS);
+        toApp->send(reply);
+        if(enabled & CAP_FRAMING_V2) {
+            toApp->setSendV2(true);
+            fromApp->setReceiveV2(true);
+        }
+    }
+
+    void showClock()
+    {
+        sim.stop(countdownTimer);
+        current = State::DISPLAY_CLOCK;
+        sendShown();
+    }
+
+    void digit(const uint32_t value)
+    {
+        switch(current) {
+        case State::CLOCK_SELECT_HOUR_TENS:
+        case State::KITCHEN_SELECT_HOUR_TENS:
+            edit.left_tens = value;
+            break;
+        case State::CLOCK_SELECT_HOUR_ONES:
+        case State::KITCHEN_SELECT_HOUR_ONES:
+            edit.left_ones = value;
+            break;
+        case State::CLOCK_SELECT_MINUTE_TENS:
+        case State::KITCHEN_SELECT_MINUTE_TENS:
+            edit.right_tens = value;
+            break;
+        case State::CLOCK_SELECT_MINUTE_ONES:
+        case State::KITCHEN_SELECT_MINUTE_ONES:
+            edit.right_ones = value;
+            break;
+        case State::SET_COOK_TIMER:
+            edit.left_tens = edit.left_ones;
+            edit.left_ones = edit.right_tens;
+            edit.right_tens = edit.right_ones;
+            edit.right_ones = value;
+            sendShown();
+            return;
+        case State::SET_POWER_LEVEL:
+            level = value ? value : 10;
+            sendShown();
+            return;
+        default:
+            return;
+        }
+
+        //a select state moves on to the next position
+        sendShown();
+        static const Signal NEXT[] {Signal::MOD_LEFT_ONES, Signal::MOD_RIGHT_TENS,
+                                    Signal::MOD_RIGHT_ONES, Signal::MOD_LEFT_TENS};
+        const bool clock {inClockSelect()};
+        const uint32_t first {static_cast<uint32_t>(clock ? State::CLOCK_SELECT_HOUR_TENS
+                                                          : State::KITCHEN_SELECT_HOUR_TENS)};
+        const uint32_t position {static_cast<uint32_t>(current) - first};
+        current = static_cast<State>(first + (position + 1) % 4);
+        send(NEXT[position]);
+    }
+
+    void blink()
+    {
+        blinkOn = !blinkOn;
+        //with local blink the app keeps the phase
+        if(!(enabled & CAP_LOCAL_BLINK) &&
+           (State::DISPLAY_CLOCK == current || inClockSelect() || inKitchenSelect() ||
+            State::SET_POWER_LEVEL == current)) {
+            send(blinkOn ? Signal::BLINK_ON : Signal::BLINK_OFF);
+        }
+        sim.start(blinkTimer, BLINK_HALF_PERIOD_MS, [this]() {
+            blink();
+        });
+    }
+
+    void tickClock()
+    {
+        minutes = (minutes + 1) % (24 * 60);
+        if(State::DISPLAY_CLOCK == current) {
+            sendShown();
+        }
+        sim.start(clockTimer, CLOCK_MINUTE_MS, [this]() {
+            tickClock();
+        });
+    }
+
+    void countdown()
+    {
+        --timerSeconds;
+        lastTickMs = sim.now();
+        //with timer sync only every sync interval, the app ticks in between
+        if(++sinceSync >= syncIntervalS) {
+            sendShown();
+        }
+        if(0 == timerSeconds) {
+            send(Signal::STOP);
+            showClock();
+            return;
+        }
+        sim.start(countdownTimer, COUNTDOWN_TICK_MS, [this]() {
+            countdown();
+        });
+    }
+};
+
+// The app side: the protocol core fed by the link, the state request poll,
+// the overlay timeout and somebody at the keypad
+class SimApp
+{
+public:
+    SimApp(Simulation& sim, Random& random, Stats& stats)
+        : sim(sim)
+        , random(random)
+        , stats(stats)
+        , toDevice{nullptr}
+        , fromDevice{nullptr}
+    {
+    }
+
+    void attach(Link* out, Link* in)
+    {
+        toDevice = out;
+        fromDevice = in;
+    }
+
+    const ProtocolCore& protocol() const
+    {
+        return core;
+    }
+
+    void connect()
+    {
+        core.reset();
+        keys.clear();
+        offer();
+        poll();
+        think();
+    }
+
+    void disconnect()
+    {
+        sim.stop(pollTimer);
+        sim.stop(coreTimer);
+        sim.stop(userTimer);
+    }
+
+    void receive(const Message& msg)
+    {
+        const CoreState before {core.state()};
+        const uint64_t invalid {core.invalidTransitions()};
+        core.process(msg, sim.now());
+        if(core.invalidTransitions() != invalid) {
+            if(CoreState::INITIAL == before) {
+                ++stats.ignoredWhileInitial;
+            }
+            else if(CoreState::DISPLAY_TIMER == before && Signal::POWER_LEVEL == msg.signal) {
+                ++stats.ignoredOverlayRepeats;
+            }
+            else if(stats.invalidTransitions++ < MAX_REPORTED) {
+                fprintf(stderr, "%" PRIu64 " ms: no transition for 0x%08" PRIx32 " in core state %d\n",
+                        sim.now(), static_cast<uint32_t>(msg.state), static_cast<int>(before));
+            }
+        }
+        else if(CoreState::DISPLAY_TIMER == core.state() && Signal::POWER_LEVEL == msg.signal) {
+            ++stats.overlays;
+        }
+
+        //the core took local blink and timer sync from the reply, the
+        // framing is the transport's
+        if(Signal::CAPABILITIES == msg.signal && (msg.data[0] & CAP_FRAMING_V2) &&
+           static_cast<uint8_t>(msg.data[1]) >= 2) {
+            fromDevice->setReceiveV2(true);
+            toDevice->setSendV2(true);
+        }
+
+        armTimeout();
+    }
+
+private:
+    Simulation& sim;
+    Random& random;
+    Stats& stats;
+    Link* toDevice;
+    Link* fromDevice;
+    ProtocolCore core;
+    std::deque<Signal> keys;
+    TimingWheel::Timer pollTimer;
+    TimingWheel::Timer coreTimer;
+    TimingWheel::Timer userTimer;
+
+    void send(const Signal signal)
+    {
+        toDevice->send(makeMessage(Destination::DEV, static_cast<uint32_t>(signal)));
+    }
+
+    //everything the core supports and the longest timer sync it accepts
+    void offer()
+    {
+        Message msg {makeMessage(Destination::DEV, static_cast<uint32_t>(Signal::CAPABILITIES))};
+        msg.data[0] = static_cast<char>(CoreCapabilities);
+        msg.data[1] = static_cast<char>(ProtocolVersion);
+        msg.data[2] = static_cast<char>(TimerSyncOfferS);
+        toDevice->send(msg);
+    }
+
+    //the overlay expiry, with local blink the blink edges and with timer
+    // sync the countdown ticks
+    void armTimeout()
+    {
+        uint64_t due {};
+        if(core.nextTimeout(due)) {
+            sim.startAt(coreTimer, due, [this]() {
+                core.advance(sim.now());
+                armTimeout();
+            });
+        }
+        else {
+            sim.stop(coreTimer);
+        }
+    }
+
+    //until a State reply has confirmed the display
+    void poll()
+    {
+        if(CoreState::INITIAL != core.state()) {
+            return;
+        }
+        ++stats.stateRequests;
+        send(Signal::STATE_REQUEST);
+        sim.start(pollTimer, STATE_REQUEST_INTERVAL_MS, [this]() {
+            poll();
+        });
+    }
+
+    void think()
+    {
+        uint64_t delay {random.range(KEY_GAP_MIN_MS, KEY_GAP_MAX_MS)};
+        if(!keys.empty()) {
+            ++stats.keys;
+            send(keys.front());
+            keys.pop_front();
+        }
+        else {
+            delay = plan();
+        }
+        sim.start(userTimer, delay, [this]() {
+            think();
+        });
+    }
+
+    void pushDigits(const uint32_t left, const uint32_t right)
+    {
+        const Time time {splitTime(left, right)};
+        for(const uint32_t digit : {time.left_tens, time.left_ones, time.right_tens, time.right_ones}) {
+            keys.push_back(static_cast<Signal>(static_cast<uint32_t>(Signal::DIGIT_0) + digit));
+        }
+    }
+
+    //queues what to press next by what the display shows, returns how long
+    // to look at it first
+    uint64_t plan()
+    {
+        //now and then anything at all
+        if(random.chance(3)) {
+            keys.push_back(static_cast<Signal>(random.range(static_cast<uint32_t>(Signal::CLOCK),
+                                                            static_cast<uint32_t>(Signal::DIGIT_9))));
+            return random.range(KEY_GAP_MIN_MS, KEY_GAP_MAX_MS);
+        }
+
+        switch(core.state()) {
+        case CoreState::INITIAL:
+            return 1000;
+        case CoreState::DISPLAY_CLOCK: {
+            const uint64_t pick {random.range(0, 99)};
+            if(pick < 55) {
+                ++stats.cooks;
+                keys.push_back(Signal::COOK_TIME);
+                pushDigits(static_cast<uint32_t>(random.range(0, 30)), static_cast<uint32_t>(random.range(0, 59)));
+                if(random.chance(30)) {
+                    keys.push_back(Signal::POWER_LEVEL);
+                    keys.push_back(static_cast<Signal>(random.range(static_cast<uint32_t>(Signal::DIGIT_0),
+                                                                    static_cast<uint32_t>(Signal::DIGIT_9))));
+                }
+                keys.push_back(Signal::START);
+            }
+            else if(pick < 70) {
+                keys.push_back(Signal::KITCHEN_TIMER);
+                pushDigits(static_cast<uint32_t>(random.range(0, 15)), static_cast<uint32_t>(random.range(0, 59)));
+                keys.push_back(Signal::START);
+            }
+            else if(pick < 78) {
+                keys.push_back(Signal::CLOCK);
+                pushDigits(static_cast<uint32_t>(random.range(0, 23)), static_cast<uint32_t>(random.range(0, 59)));
+                keys.push_back(Signal::CLOCK);
+            }
+            else if(pick < 80) {
+                keys.push_back(Signal::START);
+            }
+            else {
+                return random.range(10000, 30 * 60000);
+            }
+            return random.range(1000, 5000);
+        }
+        case CoreState::DISPLAY_TIMER:
+            if(random.chance(5)) {
+                keys.push_back(Signal::STOP);
+            }
+            else if(random.chance(20)) {
+                keys.push_back(Signal::POWER_LEVEL);
+            }
+            return random.range(1000, 120000);
+        default:
+            //walked away half way through
+            keys.push_back(Signal::STOP);
+            return random.range(1000, 10000);
+        }
+    }
+};
+
+State deviceStateOf(const CoreState state)
+{
+    switch(state) {
+    case CoreState::DISPLAY_CLOCK:
+        return State::DISPLAY_CLOCK;
+    case CoreState::CLOCK_SELECT_HOUR_TENS:
+        return State::CLOCK_SELECT_HOUR_TENS;
+    case CoreState::CLOCK_SELECT_HOUR_ONES:
+        return State::CLOCK_SELECT_HOUR_ONES;
+    case CoreState::CLOCK_SELECT_MINUTE_TENS:
+        return State::CLOCK_SELECT_MINUTE_TENS;
+    case CoreState::CLOCK_SELECT_MINUTE_ONES:
+        return State::CLOCK_SELECT_MINUTE_ONES;
+    case CoreState::SET_COOK_TIMER:
+        return State::SET_COOK_TIMER;
+    case CoreState::SET_POWER_LEVEL:
+        return State::SET_POWER_LEVEL;
+    case CoreState::KITCHEN_SELECT_MINUTE_TENS:
+        return State::KITCHEN_SELECT_HOUR_TENS;
+    case CoreState::KITCHEN_SELECT_MINUTE_ONES:
+        return State::KITCHEN_SELECT_HOUR_ONES;
+    case CoreState::KITCHEN_SELECT_SECOND_TENS:
+        return State::KITCHEN_SELECT_MINUTE_TENS;
+    case CoreState::KITCHEN_SELECT_SECOND_ONES:
+        return State::KITCHEN_SELECT_MINUTE_ONES;
+    case CoreState::DISPLAY_TIMER:
+        return State::DISPLAY_TIMER;
+    default:
+        //SetClockInit/SetKitchenTimerInit only last until MOD_LEFT_TENS
+        return State::NONE;
+    }
+}
+
+// A device, an app and the connection between them
+class SimPair
+{
+public:
+    SimPair(Simulation& sim, const uint32_t id, const uint64_t seed, Stats& stats)
+        : sim(sim)
+        , id{id}
+        , random{seed}
+        , stats(stats)
+        , device{sim, random}
+        , app{sim, random, stats}
+        , toApp{sim, random, Destination::APP, stats.bytesToApp, [this](const Message& msg) {
+            ++this->stats.toApp;
+            this->sim.record(this->id, msg);
+            app.receive(msg);
+            check();
+        }}
+        , toDevice{sim, random, Destination::DEV, stats.bytesToDevice, [this](const Message& msg) {
+            ++this->stats.toDevice;
+            this->sim.record(this->id, msg);
+            device.receive(msg);
+            check();
+        }}
+    {
+        device.attach(&toApp, &toDevice);
+        app.attach(&toDevice, &toApp);
+        for(size_t i {0}; i < CAPABILITY_COUNT; ++i) {
+            if(device.capabilities() & DEVICE_CAPABILITIES[i]) {
+                ++stats.devicesWith[i];
+            }
+        }
+        if(0 == device.capabilities()) {
+            ++stats.olderFirmware;
+        }
+        //apps start up at different moments
+        sim.start(linkTimer, random.range(0, 5000), [this]() {
+            linkUp();
+        });
+    }
+
+private:
+    Simulation& sim;
+    uint32_t id;
+    Random random;
+    Stats& stats;
+    SimDevice device;
+    SimApp app;
+    Link toApp;
+    Link toDevice;
+    TimingWheel::Timer linkTimer;
+
+    void linkUp()
+    {
+        toApp.setUp(true);
+        toDevice.setUp(true);
+        app.connect();
+        sim.start(linkTimer, random.range(LINK_UP_MIN_MS, LINK_UP_MAX_MS), [this]() {
+            linkDown();
+        });
+    }
+
+    void linkDown()
+    {
+        ++stats.reconnects;
+        toApp.setUp(false);
+        toDevice.setUp(false);
+        device.disconnect();
+        app.disconnect();
+        sim.start(linkTimer, random.range(LINK_DOWN_MIN_MS, LINK_DOWN_MAX_MS), [this]() {
+            linkUp();
+        });
+    }
+
+    //with nothing in flight both sides must agree
+    void check()
+    {
+        const ProtocolCore& core {app.protocol()};
+        if(!toApp.isIdle() || !toDevice.isIdle() || CoreState::INITIAL == core.state()) {
+            return;
+        }
+        ++stats.checks;
+        const uint8_t negotiated {device.negotiated()};
+        for(size_t i {0}; i < CAPABILITY_COUNT; ++i) {
+            if(negotiated & DEVICE_CAPABILITIES[i]) {
+                ++stats.checksWith[i];
+            }
+        }
+
+        if((core.isLocalBlink() != (0 != (negotiated & CAP_LOCAL_BLINK)) ||
+            core.syncInterval() != device.syncInterval()) && stats.mismatches++ < MAX_REPORTED) {
+            fprintf(stderr, "%" PRIu64 " ms, device %" PRIu32 ": app on %s blink with timer sync every %" PRIu32
+                    " s, device enabled 0x%02x with timer sync every %" PRIu32 " s\n",
+                    sim.now(), id, core.isLocalBlink() ? "local" : "device", core.syncInterval(),
+                    static_cast<unsigned>(negotiated), device.syncInterval());
+        }
+
+        const State expected {device.state()};
+        bool agree {deviceStateOf(core.state()) == expected};
+        if(agree && State::SET_POWER_LEVEL == expected) {
+            agree = core.powerLevel() == device.powerLevel();
+        }
+        else if(agree && State::DISPLAY_TIMER == expected) {
+            agree = device.agreesOnTimer(core.displayedTime());
+        }
+        else if(agree) {
+            Time shown {core.displayedTime()};
+            agree = shown == device.shownTime();
+        }
+        if(!agree && stats.desyncs++ < MAX_REPORTED) {
+            const Time shown {core.displayedTime()};
+            const Time wanted {device.shownTime()};
+            fprintf(stderr, "%" PRIu64 " ms, device %" PRIu32 ": app in core state %d showing %u%u:%u%u, "
+                    "device in 0x%08" PRIx32 " showing %u%u:%u%u\n",
+                    sim.now(), id, static_cast<int>(core.state()),
+                    shown.left_tens, shown.left_ones, shown.right_tens, shown.right_ones,
+                    static_cast<uint32_t>(expected),
+                    wanted.left_tens, wanted.left_ones, wanted.right_tens, wanted.right_ones);
+        }
+    }
+};
+
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t devices {8};
+    double hours {24.0};
+    uint64_t seed {1};
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--devices") && i + 1 < argc) {
+            devices = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--hours") && i + 1 < argc) {
+            hours = strtod(argv[++i], nullptr);
+        }
+        else if(0 == strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            fprintf(stderr, "usage: %s [--devices N] [--hours H] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(0 == devices || hours <= 0.0) {
+        fprintf(stderr, "nothing to simulate\n");
+        return 2;
+    }
+
+    const auto start {std::chrono::steady_clock::now()};
+
+    Simulation sim;
+    Stats stats {};
+    std::vector<std::unique_ptr<SimPair>> pairs;
+    Random seeds {seed};
+    for(uint32_t i {0}; i < devices; ++i) {
+        pairs.push_back(std::make_unique<SimPair>(sim, i, seeds.next(), stats));
+    }
+    const uint64_t endMs {static_cast<uint64_t>(hours * 3600000.0)};
+    sim.run(endMs);
+
+    const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    printf("simulated %.2f h on %" PRIu32 " devices in %.3f s (%.0fx real time)\n",
+           static_cast<double>(endMs) / 3600000.0, devices, seconds,
+           static_cast<double>(endMs) / 1000.0 / (seconds > 0.0 ? seconds : 1e-9));
+    printf("messages: %" PRIu64 " to apps, %" PRIu64 " to devices; %" PRIu64 " keys, %" PRIu64 " cooks, "
+           "%" PRIu64 " power level overlays\n",
+           stats.toApp, stats.toDevice, stats.keys, stats.cooks, stats.overlays);
+    printf("links: %" PRIu64 " drops, %" PRIu64 " state requests, %" PRIu64 " messages ignored before "
+           "the State reply, %" PRIu64 " repeated POWER_LEVEL during an overlay\n",
+           stats.reconnects, stats.stateRequests, stats.ignoredWhileInitial, stats.ignoredOverlayRepeats);
+    printf("wire: %" PRIu64 " bytes to apps, %" PRIu64 " bytes to devices\n",
+           stats.bytesToApp, stats.bytesToDevice);
+    printf("capabilities:");
+    for(size_t i {0}; i < CAPABILITY_COUNT; ++i) {
+        printf(" %s on %" PRIu64 " (%" PRIu64 " checks),", CAPABILITY_NAMES[i], stats.devicesWith[i], stats.checksWith[i]);
+    }
+    printf(" %" PRIu64 " older firmware\n", stats.olderFirmware);
+    printf("checks: %" PRIu64 ", desyncs: %" PRIu64 ", negotiation mismatches: %" PRIu64 ", "
+           "invalid transitions: %" PRIu64 "\n",
+           stats.checks, stats.desyncs, stats.mismatches, stats.invalidTransitions);
+    printf("digest: %016" PRIx64 "\n", sim.digest());
+    return 0 == stats.desyncs && 0 == stats.mismatches && 0 == stats.invalidTransitions ? 0 : 1;
+}
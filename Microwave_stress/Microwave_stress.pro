@@ -0,0 +1,14 @@
+# Loss and duplication stress of the rx stream decoder, no Qt needed
+TEMPLATE = app
+CONFIG += console c++2a
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    main.cpp
+
+HEADERS += \
+    ../MicrowaveMessageFormat.h \
+    ../MicrowaveMessageDecoder.h
+
+INCLUDEPATH += \
+    ../
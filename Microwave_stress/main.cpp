@@ -0,0 +1,212 @@
+#include "MicrowaveMessageFormat.h"
+#include "MicrowaveMessageDecoder.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Loss and duplication stress of the rx stream decoder.
+//
+//   Microwave_stress [--messages N] [--loss P] [--dup P] [--junk P] [--seed S]
+//
+// Generates N valid DEV->APP frames (default 10000000), each carrying its
+// sequence number in data, and damages the byte stream on the way: every
+// frame loses a random byte with probability --loss (default 0.001), has a
+// random span repeated with --dup (0.001) and is followed by random junk
+// with --junk (0.001). The result is fed to MessageDecoder in random sized
+// chunks, as reads off a socket would arrive.
+//
+// Every decoded message is checked against the frame its sequence number
+// names. Reported are the decoder's own resync counters, how many frames
+// came through intact, how many undamaged frames were lost next to damage,
+// how many damaged frames came out with wrong contents, and the decode
+// rate. Exits non-zero when an undamaged frame that is not next to damage
+// is lost, which would mean alignment took longer than one frame to recover.
+
+namespace {
+
+using namespace MicrowaveMsgFormat;
+
+const size_t DEFAULT_MESSAGES {10000000};
+const double DEFAULT_RATE {0.001};
+const size_t MAX_JUNK {24};
+const size_t MAX_CHUNK {4096};
+
+struct Frame
+{
+    Message msg;
+    bool damaged;
+    bool afterJunk;
+};
+
+uint32_t sequenceOf(const Message& msg)
+{
+    const uint8_t* p {reinterpret_cast<const uint8_t*>(msg.data)};
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+Message makeFrame(const uint32_t sequence, std::mt19937& rng)
+{
+    static const uint32_t firsts[3] {static_cast<uint32_t>(State::DISPLAY_CLOCK), static_cast<uint32_t>(Signal::CLOCK),
+                                     static_cast<uint32_t>(Update::CLOCK)};
+    static const uint32_t lasts[3] {static_cast<uint32_t>(State::DISPLAY_TIMER), static_cast<uint32_t>(Signal::CAPABILITIES),
+                                    static_cast<uint32_t>(Update::DISPLAY_TIMER_DELTA)};
+    const size_t type {rng() % 3};
+    Message msg {};
+    msg.dst = Destination::APP;
+    msg.state = static_cast<State>(firsts[type] + rng() % (lasts[type] - firsts[type] + 1));
+    msg.data[0] = static_cast<char>((sequence >> 24) & 0xFF);
+    msg.data[1] = static_cast<char>((sequence >> 16) & 0xFF);
+    msg.data[2] = static_cast<char>((sequence >> 8) & 0xFF);
+    msg.data[3] = static_cast<char>(sequence & 0xFF);
+    return msg;
+}
+
+double parseRate(const char* text)
+{
+    const double rate {strtod(text, nullptr)};
+    return rate < 0 ? 0 : rate > 1 ? 1 : rate;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    size_t messages {DEFAULT_MESSAGES};
+    double loss {DEFAULT_RATE};
+    double dup {DEFAULT_RATE};
+    double junk {DEFAULT_RATE};
+    uint32_t seed {1};
+    for(int i {1}; i < argc; ++i) {
+        if(0 == strcmp(argv[i], "--messages") && i + 1 < argc) {
+            messages = static_cast<size_t>(strtoull(argv[++i], nullptr, 10));
+        }
+        else if(0 == strcmp(argv[i], "--loss") && i + 1 < argc) {
+            loss = parseRate(argv[++i]);
+        }
+        else if(0 == strcmp(argv[i], "--dup") && i + 1 < argc) {
+            dup = parseRate(argv[++i]);
+        }
+        else if(0 == strcmp(argv[i], "--junk") && i + 1 < argc) {
+            junk = parseRate(argv[++i]);
+        }
+        else if(0 == strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else {
+            fprintf(stderr, "usage: %s [--messages N] [--loss P] [--dup P] [--junk P] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    //build the damaged stream up front so only decoding is timed
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::vector<Frame> frames;
+    frames.reserve(messages);
+    std::vector<char> stream;
+    stream.reserve(messages * WireMessageSize + messages / 8);
+    uint64_t lostBytes {0};
+    uint64_t duplicatedSpans {0};
+    uint64_t junkRuns {0};
+    bool afterJunk {false};
+    for(size_t i {0}; i < messages; ++i) {
+        Frame frame {makeFrame(static_cast<uint32_t>(i), rng), false, afterJunk};
+        const Message swapped {ByteSwapMessage(frame.msg)};
+        std::vector<char> bytes(reinterpret_cast<const char*>(&swapped),
+                                reinterpret_cast<const char*>(&swapped) + WireMessageSize);
+        if(chance(rng) < loss) {
+            bytes.erase(bytes.begin() + static_cast<long>(rng() % bytes.size()));
+            frame.damaged = true;
+            ++lostBytes;
+        }
+        if(chance(rng) < dup) {
+            const size_t at {rng() % bytes.size()};
+            const size_t length {1 + rng() % (bytes.size() - at)};
+            const std::vector<char> span(bytes.begin() + static_cast<long>(at),
+                                         bytes.begin() + static_cast<long>(at + length));
+            bytes.insert(bytes.begin() + static_cast<long>(at + length), span.begin(), span.end());
+            frame.damaged = true;
+            ++duplicatedSpans;
+        }
+        stream.insert(stream.end(), bytes.begin(), bytes.end());
+        afterJunk = chance(rng) < junk;
+        if(afterJunk) {
+            const size_t length {1 + rng() % MAX_JUNK};
+            for(size_t j {0}; j < length; ++j) {
+                stream.push_back(static_cast<char>(rng()));
+            }
+            ++junkRuns;
+        }
+        frames.push_back(frame);
+    }
+
+    MessageDecoder decoder(Destination::APP);
+    std::vector<uint8_t> delivered(messages, 0);
+    uint64_t intact {0};
+    uint64_t wrong {0};
+    uint64_t duplicates {0};
+    Message msg;
+    size_t chunkSeed {rng()};
+    const auto start {std::chrono::steady_clock::now()};
+    for(size_t offset {0}; offset < stream.size();) {
+        //cheap LCG for chunk sizes, the generator is too slow for the timed loop
+        chunkSeed = chunkSeed * 6364136223846793005u + 1442695040888963407u;
+        const size_t chunk {std::min(1 + (chunkSeed >> 33) % MAX_CHUNK, stream.size() - offset)};
+        decoder.append(stream.data() + offset, chunk);
+        offset += chunk;
+        while(decoder.next(msg)) {
+            const uint32_t sequence {sequenceOf(msg)};
+            if(sequence >= messages || 0 != memcmp(&msg, &frames[sequence].msg, sizeof(Message))) {
+                ++wrong;
+            }
+            else if(delivered[sequence]) {
+                ++duplicates;
+            }
+            else {
+                delivered[sequence] = 1;
+                ++intact;
+            }
+        }
+    }
+    const double seconds {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    //an undamaged frame may only be lost right after damage: a short frame
+    // swallows the next header, a repeat or junk can end in the middle of a
+    // header lookalike that takes the real one with it
+    uint64_t damaged {0};
+    uint64_t lostNextToDamage {0};
+    uint64_t lostClean {0};
+    for(size_t i {0}; i < messages; ++i) {
+        if(frames[i].damaged) {
+            ++damaged;
+            continue;
+        }
+        if(!delivered[i]) {
+            if(frames[i].afterJunk || (i > 0 && frames[i - 1].damaged)) {
+                ++lostNextToDamage;
+            }
+            else {
+                ++lostClean;
+            }
+        }
+    }
+    const MessageDecoder::Stats& stats {decoder.stats()};
+    printf("%zu frames, %" PRIu64 " damaged (%" PRIu64 " bytes lost, %" PRIu64 " spans repeated), "
+           "%" PRIu64 " junk runs, seed %u\n",
+           messages, damaged, lostBytes, duplicatedSpans, junkRuns, seed);
+    printf("decoder: %" PRIu64 " bytes in, %" PRIu64 " messages, %" PRIu64 " resyncs, "
+           "%" PRIu64 " bytes discarded, %" PRIu64 " headers rejected\n",
+           stats.bytesIn, stats.messages, stats.resyncs, stats.bytesDiscarded, stats.rejectedHeaders);
+    printf("%" PRIu64 " intact, %" PRIu64 " with wrong contents, %" PRIu64 " repeated, "
+           "%" PRIu64 " undamaged lost next to damage, %" PRIu64 " undamaged lost otherwise\n",
+           intact, wrong, duplicates, lostNextToDamage, lostClean);
+    printf("%.3f s, %.1f Mmsg/s, %.1f MB/s\n", seconds, static_cast<double>(messages) / seconds / 1e6,
+           static_cast<double>(stream.size()) / seconds / 1e6);
+    return 0 == lostClean ? 0 : 1;
+}